@@ -27,6 +27,17 @@ add_test(
         --input-format yuv
 )
 
+add_test(
+    NAME chroma-ntsc-float
+    COMMAND ${SCRIPTS_DIR}/test-chroma
+        --build ${CMAKE_BINARY_DIR}
+        --system ntsc
+        --expect-psnr 25
+        --expect-psnr-range 0.5
+        --compare-option=--ntsc-float
+        --expect-compare-delta 0.1
+)
+
 add_test(
     NAME chroma-pal-rgb
     COMMAND ${SCRIPTS_DIR}/test-chroma
@@ -36,6 +47,17 @@ add_test(
         --expect-psnr-range 0.5
 )
 
+add_test(
+    NAME chroma-pal-transform-float
+    COMMAND ${SCRIPTS_DIR}/test-chroma
+        --build ${CMAKE_BINARY_DIR}
+        --system pal
+        --expect-psnr 25
+        --expect-psnr-range 0.5
+        --compare-option=--transform-float
+        --expect-compare-delta 0.1
+)
+
 add_test(
     NAME chroma-pal-ycbcr
     COMMAND ${SCRIPTS_DIR}/test-chroma
@@ -46,6 +68,26 @@ add_test(
         --input-format yuv
 )
 
+add_test(
+    NAME chroma-pal-yuv420p10
+    COMMAND ${SCRIPTS_DIR}/test-chroma
+        --build ${CMAKE_BINARY_DIR}
+        --system pal
+        --expect-psnr 25
+        --expect-psnr-range 1
+        --yuv-format yuv420p10
+)
+
+add_test(
+    NAME chroma-pal-stdin
+    COMMAND ${SCRIPTS_DIR}/test-chroma
+        --build ${CMAKE_BINARY_DIR}
+        --system pal
+        --expect-psnr 25
+        --expect-psnr-range 0.5
+        --stdin
+)
+
 add_test(
     NAME ld-cut-ntsc
     COMMAND ${SCRIPTS_DIR}/test-decode
@@ -537,7 +537,7 @@ TbcSource::ScanLineData TbcSource::getScanLineData(qint32 scanLine)
                                 && (frameLine -1) < videoParameters.lastActiveFrameLine;
 
     // Get the field video and dropout data
-    const SourceVideo::Data &fieldData = isFirstField ? inputFields[inputStartIndex].data : inputFields[inputStartIndex + 1].data;
+    const SourceVideo::DataView &fieldData = isFirstField ? inputFields[inputStartIndex].data : inputFields[inputStartIndex + 1].data;
     const ComponentFrame &componentFrame = getComponentFrame();
     DropOuts &dropouts = isFirstField ? firstField.dropOuts : secondField.dropOuts;
 
@@ -552,12 +552,7 @@ TbcSource::ScanLineData TbcSource::getScanLineData(qint32 scanLine)
         // Get the decoded luma value for the current pixel (only computed in the active region)
         scanLineData.luma[xPosition] = static_cast<qint32>(componentFrame.y(frameLine - 1)[xPosition]);
 
-        scanLineData.isDropout[xPosition] = false;
-        for (qint32 doCount = 0; doCount < dropouts.size(); doCount++) {
-            if (dropouts.fieldLine(doCount) == lineNumber.field1()) {
-                if (xPosition >= dropouts.startx(doCount) && xPosition <= dropouts.endx(doCount)) scanLineData.isDropout[xPosition] = true;
-            }
-        }
+        scanLineData.isDropout[xPosition] = dropouts.isDropout(xPosition, lineNumber.field1());
     }
 
     return scanLineData;
@@ -809,13 +804,15 @@ void TbcSource::loadInputFields()
 
         // Add chroma to luma, removing the offset
         for (qint32 fieldIndex = inputStartIndex; fieldIndex < inputEndIndex; fieldIndex++) {
-            auto &sourceData = inputFields[fieldIndex].data;
+            SourceVideo::Data sourceData = inputFields[fieldIndex].data.toData();
             const auto &chromaData = chromaInputFields[fieldIndex].data;
 
             for (qint32 i = 0; i < sourceData.size(); i++) {
                 qint32 sum = static_cast<qint32>(sourceData[i]) + static_cast<qint32>(chromaData[i]) - CHROMA_OFFSET;
                 sourceData[i] = static_cast<quint16>(qBound(0, sum, 65535));
             }
+
+            inputFields[fieldIndex].data = sourceData;
         }
     }
 
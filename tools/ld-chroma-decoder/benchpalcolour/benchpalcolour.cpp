@@ -0,0 +1,141 @@
+/************************************************************************
+
+    benchpalcolour.cpp
+
+    Micro-benchmark for the PALcolour decoder
+    Copyright (C) 2026 agent
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+// Usage: benchpalcolour [ITERATIONS [DECODER]]
+//
+// Decodes the same PAL frame ITERATIONS times (default 200) with DECODER
+// (pal2d or transform2d; default pal2d), and reports the time taken per
+// active sample.
+
+#include <QElapsedTimer>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "componentframe.h"
+#include "palcolour.h"
+#include "sourcefield.h"
+
+// Make video parameters for a 4fSC PAL source
+static LdDecodeMetaData::VideoParameters makeVideoParameters()
+{
+    LdDecodeMetaData::VideoParameters videoParameters;
+    videoParameters.system = PAL;
+    videoParameters.isValid = true;
+    videoParameters.fieldWidth = 1135;
+    videoParameters.fieldHeight = 313;
+    videoParameters.fSC = 283.75 * 15625 + 25;
+    videoParameters.sampleRate = 4 * videoParameters.fSC;
+    videoParameters.colourBurstStart = 98;
+    videoParameters.colourBurstEnd = 138;
+    videoParameters.activeVideoStart = 185;
+    videoParameters.activeVideoEnd = 1107;
+    videoParameters.firstActiveFrameLine = 44;
+    videoParameters.lastActiveFrameLine = 620;
+    videoParameters.white16bIre = 54016;
+    videoParameters.black16bIre = 16384;
+    return videoParameters;
+}
+
+// Generate a frame containing luma ramps and a subcarrier with varying
+// amplitude, plus noise
+static QVector<SourceField> makeFields(const LdDecodeMetaData::VideoParameters &videoParameters)
+{
+    QVector<SourceField> fields(2);
+    quint32 seed = 12345;
+
+    for (qint32 i = 0; i < fields.size(); i++) {
+        SourceVideo::Data data(videoParameters.fieldWidth * videoParameters.fieldHeight);
+
+        for (qint32 y = 0; y < videoParameters.fieldHeight; y++) {
+            for (qint32 x = 0; x < videoParameters.fieldWidth; x++) {
+                seed = (seed * 1103515245) + 12345;
+                const qint32 noise = static_cast<qint32>((seed >> 16) % 400);
+
+                const qint32 luma = 20000 + (((x * 3) + (y * 5)) % 200) * 80;
+                static constexpr qint32 carrier[4] = {0, 1, 0, -1};
+                const qint32 chroma = carrier[(x + y) % 4] * (2000 + ((x * 7) % 5000));
+
+                data[(y * videoParameters.fieldWidth) + x] = static_cast<quint16>(qBound(0, luma + chroma + noise, 65535));
+            }
+        }
+
+        fields[i].data = data;
+        fields[i].field.seqNo = i + 1;
+        fields[i].field.isFirstField = (i % 2) == 0;
+        fields[i].field.fieldPhaseID = i + 1;
+    }
+
+    return fields;
+}
+
+int main(int argc, char *argv[])
+{
+    const qint32 iterations = (argc > 1) ? atoi(argv[1]) : 200;
+    const char *decoderName = (argc > 2) ? argv[2] : "pal2d";
+
+    PalColour::Configuration configuration;
+    if (strcmp(decoderName, "pal2d") == 0) {
+        configuration.chromaFilter = PalColour::palColourFilter;
+    } else if (strcmp(decoderName, "transform2d") == 0) {
+        configuration.chromaFilter = PalColour::transform2DFilter;
+    } else {
+        fprintf(stderr, "Unknown decoder %s\n", decoderName);
+        return 1;
+    }
+    if (iterations < 1) {
+        fprintf(stderr, "Iterations must be at least 1\n");
+        return 1;
+    }
+
+    const LdDecodeMetaData::VideoParameters videoParameters = makeVideoParameters();
+    const QVector<SourceField> fields = makeFields(videoParameters);
+
+    PalColour palColour;
+    palColour.updateConfiguration(videoParameters, configuration);
+    QVector<ComponentFrame> componentFrames(1);
+
+    // Decode once before timing, so everything is allocated
+    palColour.decodeFrames(fields, 0, 2, componentFrames);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (qint32 i = 0; i < iterations; i++) {
+        palColour.decodeFrames(fields, 0, 2, componentFrames);
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    // Count the active samples in both fields
+    qint64 samples = 0;
+    for (const SourceField &field : fields) {
+        samples += static_cast<qint64>(field.getLastActiveLine(videoParameters) - field.getFirstActiveLine(videoParameters))
+                   * (videoParameters.activeVideoEnd - videoParameters.activeVideoStart);
+    }
+    samples *= iterations;
+
+    printf("%s: %d frames in %.3f s, %.2f ns/sample\n", decoderName, iterations,
+           elapsed / 1e9, static_cast<double>(elapsed) / samples);
+
+    return 0;
+}
@@ -31,10 +31,13 @@
 
 #include "deemp.h"
 #include "firfilter.h"
+#include "simddispatch.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <memory>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -78,6 +81,355 @@ constexpr double cos4fsc(const qint32 i) {
     return sin4fsc(i + 1);
 }
 
+// Filter kernels for a single line -----------------------------------------------------------------------------------
+
+namespace {
+    // 1D bandpass filter (see split1D)
+    template <typename T>
+    Q_ALWAYS_INLINE void split1DKernel(const quint16 *line, T *out, qint32 start, qint32 end)
+    {
+        for (qint32 h = start; h < end; h++) {
+            out[h] = (line[h] - ((line[h - 2] + line[h + 2]) / T(2))) / T(2);
+        }
+    }
+
+    // 2D 3-line adaptive filter (see split2D).
+    //
+    // This is written without branches, and in two passes, so the compiler
+    // can vectorise it.
+    template <typename T>
+    Q_ALWAYS_INLINE void split2DKernel(const T *previousLine, const T *currentLine, const T *nextLine, T *out,
+                                       qint32 start, qint32 end, T kRange)
+    {
+        T kpLine[Comb::MAX_WIDTH];
+        T knLine[Comb::MAX_WIDTH];
+
+        for (qint32 h = start; h < end; h++) {
+            T kp, kn;
+
+            // Summing the differences of the *absolute* values of the 1D chroma samples
+            // will give us a low value if the two lines are nearly in phase (strong Y)
+            // or nearly 180 degrees out of phase (strong C) -- i.e. the two cases where
+            // the 2D filter is probably usable. Also give a small bonus if
+            // there's a large signal (we think).
+            kp  = std::fabs(std::fabs(currentLine[h]) - std::fabs(previousLine[h]));
+            kp += std::fabs(std::fabs(currentLine[h - 1]) - std::fabs(previousLine[h - 1]));
+            kp -= (std::fabs(currentLine[h]) + std::fabs(previousLine[h - 1])) * T(.10);
+            kn  = std::fabs(std::fabs(currentLine[h]) - std::fabs(nextLine[h]));
+            kn += std::fabs(std::fabs(currentLine[h - 1]) - std::fabs(nextLine[h - 1]));
+            kn -= (std::fabs(currentLine[h]) + std::fabs(nextLine[h - 1])) * T(.10);
+
+            // Map the difference into a weighting 0-1.
+            // This is qBound(0, x, 1), written so that it vectorises.
+            kp = 1 - (kp / kRange);
+            kp = (T(1) < kp) ? T(1) : kp;
+            kp = (T(0) < kp) ? kp : T(0);
+            kn = 1 - (kn / kRange);
+            kn = (T(1) < kn) ? T(1) : kn;
+            kn = (T(0) < kn) ? kn : T(0);
+
+            kpLine[h] = kp;
+            knLine[h] = kn;
+        }
+
+        for (qint32 h = start; h < end; h++) {
+            // If at least one of the next/previous lines has a good phase
+            // relationship, and one of them is much better than the other,
+            // only use that one. (kp and kn are in the range 0-1, so their
+            // sum is only 0 if both of them are.)
+            const bool anyGood = (knLine[h] + kpLine[h]) > 0;
+            const bool nextBetter = knLine[h] > (3 * kpLine[h]);
+            const bool previousBetter = !nextBetter & (kpLine[h] > (3 * knLine[h]));
+            const T goodKp = nextBetter ? T(0) : kpLine[h];
+            const T goodKn = previousBetter ? T(0) : knLine[h];
+            T goodSc = T(2) / (goodKn + goodKp);
+            goodSc = (goodSc < T(1)) ? T(1) : goodSc;
+
+            // If neither line has a good phase relationship, are they
+            // similar to each other? If so, we can use both of them!
+            // Else kn = kp = 0, so we won't extract any chroma for this sample.
+            // (Some NTSC decoders fall back to the 1D chroma in this situation.)
+            const bool similar = (std::fabs(std::fabs(previousLine[h]) - std::fabs(nextLine[h]))
+                                  - std::fabs((nextLine[h] + previousLine[h]) * T(.2))) <= 0;
+            const T similarK = similar ? T(1) : T(0);
+
+            const T kp = anyGood ? goodKp : similarK;
+            const T kn = anyGood ? goodKn : similarK;
+            const T sc = anyGood ? goodSc : T(1);
+
+            // Compute the weighted sum of differences, giving the 2D chroma value
+            T tc1;
+            tc1  = ((currentLine[h] - previousLine[h]) * kp * sc);
+            tc1 += ((currentLine[h] - nextLine[h]) * kn * sc);
+            tc1 /= 4;
+
+            out[h] = tc1;
+        }
+    }
+
+    // The double-precision versions are compiled for the baseline instruction
+    // set only, so that their output is the same on every CPU
+    inline void split1DLine(const quint16 *line, double *out, qint32 start, qint32 end)
+    {
+        split1DKernel(line, out, start, end);
+    }
+    inline void split2DLine(const double *previousLine, const double *currentLine, const double *nextLine, double *out,
+                            qint32 start, qint32 end, double kRange)
+    {
+        split2DKernel(previousLine, currentLine, nextLine, out, start, end, kRange);
+    }
+
+    // The single-precision versions are compiled for each SIMD instruction set
+    SIMD_DISPATCH void split1DLine(const quint16 *line, float *out, qint32 start, qint32 end)
+    {
+        split1DKernel(line, out, start, end);
+    }
+    SIMD_DISPATCH void split2DLine(const float *previousLine, const float *currentLine, const float *nextLine, float *out,
+                                   qint32 start, qint32 end, float kRange)
+    {
+        split2DKernel(previousLine, currentLine, nextLine, out, start, end, kRange);
+    }
+
+    // Penalty for a 3D candidate at each sample of a line (see getBestCandidates).
+    //
+    // refY and refC are the reference line's luma and chroma, and candidateLine
+    // and candidateC the candidate's baseband and 2D chroma samples, offset so
+    // they line up with the reference; all four must be valid from start - 1 to
+    // end + 1.
+    template <typename T>
+    Q_ALWAYS_INLINE void candidatePenaltyKernel(const T *refY, const T *refC,
+                                                const quint16 *candidateLine, const T *candidateC, T *penalty,
+                                                qint32 start, qint32 end, T irescale, T adjustPenalty)
+    {
+        T yDiff[Comb::MAX_WIDTH];
+        T cDiff[Comb::MAX_WIDTH];
+
+        // Luma and chroma differences for each sample. Each of these is used
+        // for three output samples below.
+        for (qint32 h = start - 1; h < end + 1; h++) {
+            const T c = candidateC[h];
+            yDiff[h] = std::fabs(refY[h] - (candidateLine[h] - c));
+
+            // The reference and candidate are 180 degrees out of phase here, so negate one
+            cDiff[h] = std::fabs(refC[h] + c);
+        }
+
+        for (qint32 h = start; h < end; h++) {
+            // Penalty based on mean luma difference in IRE over surrounding three samples
+            const T yPenalty = (yDiff[h - 1] + yDiff[h] + yDiff[h + 1]) / 3 / irescale;
+
+            // Penalty based on mean I/Q difference in IRE over surrounding three samples.
+            // I and Q samples alternate, so weight the two channels equally.
+            // Weaken this relative to luma, to avoid spurious colour in the 2D result from showing through.
+            const T iqPenalty = (((cDiff[h - 1] * T(0.5)) + (cDiff[h] * T(1.0)) + (cDiff[h + 1] * T(0.5))) / 2 / irescale) * T(0.28);
+
+            penalty[h] = yPenalty + iqPenalty + adjustPenalty;
+        }
+    }
+
+    // Choose the 3D candidate with the lowest penalty for each sample, or the
+    // first if there's a tie (see getBestCandidates). The running best is
+    // kept in registers and each output is written once, so the compiler
+    // can vectorise this as a series of selects.
+    template <typename T>
+    Q_ALWAYS_INLINE void chooseBestKernel(const T (*penalties)[Comb::MAX_WIDTH], const T *const *candidateSamples,
+                                          qint32 *bestIndex, T *bestSample, qint32 start, qint32 end)
+    {
+        for (qint32 h = start; h < end; h++) {
+            T bestPenalty = penalties[0][h];
+            qint32 index = 0;
+            T sample = candidateSamples[0][h];
+
+#pragma GCC unroll 8
+            for (qint32 i = 1; i < NUM_CANDIDATES; i++) {
+                const T penalty = penalties[i][h];
+                const T candidateSample = candidateSamples[i][h];
+                const bool better = penalty < bestPenalty;
+                bestPenalty = better ? penalty : bestPenalty;
+                index = better ? i : index;
+                sample = better ? candidateSample : sample;
+            }
+
+            bestIndex[h] = index;
+            bestSample[h] = sample;
+        }
+    }
+
+    // Combine the 3D candidates chosen for a line into 3D chroma (see split3D)
+    template <typename T>
+    Q_ALWAYS_INLINE void split3DKernel(const T *line1D, const T *line2D, const qint32 *bestIndex, const T *bestSample,
+                                       T *out, qint32 start, qint32 end)
+    {
+        // Compute a 3D result for every sample. This sample is Y + C; the
+        // candidate is (ideally) Y - C. So compute C as ((Y + C) - (Y - C)) / 2.
+        for (qint32 h = start; h < end; h++) {
+            out[h] = (line1D[h] - bestSample[h]) / 2;
+        }
+
+        // If a 1D or 2D candidate was best, use split2D's output instead, to
+        // save duplicating the line-blending heuristics here. (This is a
+        // separate pass so that both loops are free of branches.)
+        for (qint32 h = start; h < end; h++) {
+            const T value2D = line2D[h];
+            const T value3D = out[h];
+            out[h] = (bestIndex[h] < CAND_PREV_FIELD) ? value2D : value3D;
+        }
+    }
+
+    inline void candidatePenaltyLine(const double *refY, const double *refC,
+                                     const quint16 *candidateLine, const double *candidateC, double *penalty,
+                                     qint32 start, qint32 end, double irescale, double adjustPenalty)
+    {
+        candidatePenaltyKernel(refY, refC, candidateLine, candidateC, penalty, start, end, irescale, adjustPenalty);
+    }
+    inline void chooseBestLine(const double (*penalties)[Comb::MAX_WIDTH], const double *const *candidateSamples,
+                               qint32 *bestIndex, double *bestSample, qint32 start, qint32 end)
+    {
+        chooseBestKernel(penalties, candidateSamples, bestIndex, bestSample, start, end);
+    }
+    inline void split3DLine(const double *line1D, const double *line2D, const qint32 *bestIndex,
+                            const double *bestSample, double *out, qint32 start, qint32 end)
+    {
+        split3DKernel(line1D, line2D, bestIndex, bestSample, out, start, end);
+    }
+
+    SIMD_DISPATCH void candidatePenaltyLine(const float *refY, const float *refC,
+                                            const quint16 *candidateLine, const float *candidateC, float *penalty,
+                                            qint32 start, qint32 end, float irescale, float adjustPenalty)
+    {
+        candidatePenaltyKernel(refY, refC, candidateLine, candidateC, penalty, start, end, irescale, adjustPenalty);
+    }
+    SIMD_DISPATCH void chooseBestLine(const float (*penalties)[Comb::MAX_WIDTH], const float *const *candidateSamples,
+                                      qint32 *bestIndex, float *bestSample, qint32 start, qint32 end)
+    {
+        chooseBestKernel(penalties, candidateSamples, bestIndex, bestSample, start, end);
+    }
+    SIMD_DISPATCH void split3DLine(const float *line1D, const float *line2D, const qint32 *bestIndex,
+                                   const float *bestSample, float *out, qint32 start, qint32 end)
+    {
+        split3DKernel(line1D, line2D, bestIndex, bestSample, out, start, end);
+    }
+
+    // Single-precision demodulation, filtering and noise reduction for a
+    // line (see demodulateFloat). These all work on line buffers that are
+    // zero outside the active area.
+
+    // Split I and Q, with the chroma samples negated if linePhase is set, and
+    // remove the chroma from Y (see splitIQ and adjustY)
+    SIMD_DISPATCH void splitIQLine(const quint16 *line, const float *chroma, bool linePhase,
+                                   float *Y, float *I, float *Q, qint32 start, qint32 end)
+    {
+        const float sign = linePhase ? -1.0f : 1.0f;
+
+        // I and Q are each taken from alternate samples, and held until the
+        // next one
+        const auto splitSample = [&](qint32 h, float previous) {
+            const float current = chroma[h] * sign;
+            const qint32 phase = h % 4;
+
+            Y[h] = line[h] - chroma[h];
+            I[h] = (phase == 0) ? previous : (phase == 1) ? -current : (phase == 2) ? -previous : current;
+            Q[h] = (phase == 0) ? current : (phase == 1) ? previous : (phase == 2) ? -current : -previous;
+        };
+
+        // There's nothing to hold for the first sample, so do it separately
+        // to keep the main loop free of branches
+        if (start < end) splitSample(start, 0.0f);
+        for (qint32 h = start + 1; h < end; h++) {
+            splitSample(h, chroma[h - 1] * sign);
+        }
+    }
+
+    // Split I and Q, rotating the demodulated vector by rotateI/rotateQ, and
+    // remove the chroma from Y (see splitIQlocked)
+    SIMD_DISPATCH void splitIQLockedLine(const quint16 *line, const float *chroma, float rotateI, float rotateQ,
+                                         float *Y, float *I, float *Q, qint32 start, qint32 end)
+    {
+        const auto splitSample = [&](qint32 h, float value) {
+            Y[h] = line[h] - chroma[h];
+
+            const qint32 phase = (h + 3) % 4;
+            const float lsin = (phase == 0) ? value : (phase == 2) ? -value : 0.0f;
+            const float lcos = (phase == 1) ? -value : (phase == 3) ? value : 0.0f;
+
+            I[h] = (lsin * rotateI) + (lcos * rotateQ);
+            Q[h] = (lsin * rotateQ) - (lcos * rotateI);
+        };
+
+        // The chroma is shifted one sample to the right, as in splitIQlocked,
+        // so the first sample has no chroma
+        if (start < end) splitSample(start, 0.0f);
+        for (qint32 h = start + 1; h < end; h++) {
+            splitSample(h, chroma[h - 1] * 2);
+        }
+    }
+
+    // Apply a FIR filter with numTaps taps to a line
+    template <size_t numTaps>
+    Q_ALWAYS_INLINE void firKernel(const float *in, const std::array<float, numTaps> &coeffs, float *out,
+                                   qint32 start, qint32 end)
+    {
+        constexpr qint32 overlap = numTaps / 2;
+
+        // Accumulate a tap at a time along the whole line, so the inner loop
+        // runs along the samples. Each output still sums its taps in order.
+        std::fill(out + start, out + end, 0.0f);
+        for (qint32 i = 0; i < static_cast<qint32>(numTaps); i++) {
+            const float coeff = coeffs[i];
+            const float *tapIn = in - overlap + i;
+            for (qint32 h = start; h < end; h++) {
+                out[h] += coeff * tapIn[h];
+            }
+        }
+    }
+
+    SIMD_DISPATCH void firLine(const float *in, const std::array<float, 17> &coeffs, float *out,
+                               qint32 start, qint32 end)
+    {
+        firKernel(in, coeffs, out, start, end);
+    }
+    SIMD_DISPATCH void firLine(const float *in, const std::array<float, 25> &coeffs, float *out,
+                               qint32 start, qint32 end)
+    {
+        firKernel(in, coeffs, out, start, end);
+    }
+
+    // Subtract the high-pass filtered signal, clipped to +/- level, from a
+    // line (see doCNR and doYNR)
+    SIMD_DISPATCH void coreLine(const float *highPass, float level, float *out, qint32 start, qint32 end)
+    {
+        for (qint32 h = start; h < end; h++) {
+            float a = highPass[h];
+            a = (a < level) ? a : level;
+            a = (a > -level) ? a : -level;
+            out[h] -= a;
+        }
+    }
+
+    // Transform I/Q into U/V, and write the line to the component frame (see transformIQ)
+    SIMD_DISPATCH void transformIQLine(const float *Y, const float *I, const float *Q, float bp, float bq,
+                                       double *outY, double *outU, double *outV, qint32 start, qint32 end)
+    {
+        for (qint32 h = start; h < end; h++) {
+            outY[h] = Y[h];
+            outU[h] = (-bp * I[h]) + (bq * Q[h]);
+            outV[h] = ( bq * I[h]) + (bp * Q[h]);
+        }
+    }
+
+    // Single-precision copies of the I/Q and noise reduction filters' coefficients
+    template <size_t numTaps>
+    std::array<float, numTaps> toFloatCoeffs(const std::array<double, numTaps> &coeffs)
+    {
+        std::array<float, numTaps> floatCoeffs;
+        std::copy(coeffs.begin(), coeffs.end(), floatCoeffs.begin());
+        return floatCoeffs;
+    }
+    const std::array<float, 17> colorLPCoeffsFloat = toFloatCoeffs(c_colorlp_b);
+    const std::array<float, 17> nrcCoeffsFloat = toFloatCoeffs(c_nrc_b);
+    const std::array<float, 25> nrCoeffsFloat = toFloatCoeffs(c_nr_b);
+}
+
 // Public methods -----------------------------------------------------------------------------------------------------
 
 Comb::Comb()
@@ -103,6 +455,21 @@ qint32 Comb::Configuration::getLookAhead() const {
     return 0;
 }
 
+void Comb::Configuration::getRegionMargin(qint32 &xMargin, qint32 &yMargin,
+                                          qint32 &xAlignment, qint32 &yAlignment) const {
+    // split2D looks two frame lines above and below, and split3D looks two
+    // lines further at split2D's output; both treat lines outside the active
+    // area as missing
+    yMargin = 2 * (dimensions - 1);
+
+    // split3D and splitIQ look up to three samples to the side, and the I/Q
+    // and noise reduction filters treat samples outside the active area as zero
+    xMargin = 6 + (c_colorlp_b.size() / 2) + (c_nrc_b.size() / 2) + (c_nr_b.size() / 2);
+
+    xAlignment = 1;
+    yAlignment = 1;
+}
+
 // Return the current configuration
 const Comb::Configuration &Comb::getConfiguration() const {
     return configuration;
@@ -130,6 +497,10 @@ void Comb::updateConfiguration(const LdDecodeMetaData::VideoParameters &_videoPa
         qCritical() << "Data is not in 4fsc sample rate, color decoding will not work properly!";
     }
 
+    // Discard any existing frame buffers, since they depend on the configuration
+    doubleFrameBuffers.reset();
+    floatFrameBuffers.reset();
+
     configurationSet = true;
 }
 
@@ -139,12 +510,32 @@ void Comb::decodeFrames(const QVector<SourceField> &inputFields, qint32 startInd
     assert(configurationSet);
     assert((componentFrames.size() * 2) == (endIndex - startIndex));
 
+    if (configuration.singlePrecision) {
+        decodeFramesUsing(floatFrameBuffers, inputFields, startIndex, endIndex, componentFrames);
+    } else {
+        decodeFramesUsing(doubleFrameBuffers, inputFields, startIndex, endIndex, componentFrames);
+    }
+}
+
+// Private methods ----------------------------------------------------------------------------------------------------
+
+template <typename SampleType>
+void Comb::decodeFramesUsing(FrameBuffers<SampleType> &frameBuffers,
+                             const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
+                             QVector<ComponentFrame> &componentFrames)
+{
+    auto &nextFrameBuffer = frameBuffers.next;
+    auto &currentFrameBuffer = frameBuffers.current;
+    auto &previousFrameBuffer = frameBuffers.previous;
+
     // Buffers for the next, current and previous frame.
-    // Because we only need three of these, we allocate them upfront then
-    // rotate the pointers below.
-    auto nextFrameBuffer = std::make_unique<FrameBuffer>(videoParameters, configuration);
-    auto currentFrameBuffer = std::make_unique<FrameBuffer>(videoParameters, configuration);
-    auto previousFrameBuffer = std::make_unique<FrameBuffer>(videoParameters, configuration);
+    // Because we only need three of these, we allocate them on the first call
+    // then rotate the pointers below.
+    if (!nextFrameBuffer) {
+        nextFrameBuffer = std::make_unique<FrameBuffer<SampleType>>(videoParameters, configuration);
+        currentFrameBuffer = std::make_unique<FrameBuffer<SampleType>>(videoParameters, configuration);
+        previousFrameBuffer = std::make_unique<FrameBuffer<SampleType>>(videoParameters, configuration);
+    }
 
     // Decode each pair of fields into a frame.
     // To support 3D operation, where we need to see three input frames at a time,
@@ -164,8 +555,23 @@ void Comb::decodeFrames(const QVector<SourceField> &inputFields, qint32 startInd
 
         // If there's another input field, bring it into nextFrameBuffer
         if (fieldIndex + 3 < inputFields.size()) {
+            const SourceField &firstField = inputFields[fieldIndex + 2];
+            const SourceField &secondField = inputFields[fieldIndex + 3];
+
+            // If this is a look-behind frame (or the first real frame) and
+            // the previous batch finished with it, use that rather than
+            // decoding it again. After the rotation above, the previous
+            // batch's last two frames are in previousFrameBuffer on
+            // successive iterations. previousFrameBuffer is recycled on the
+            // next iteration, so it's safe to swap it out. currentFrameBuffer
+            // is still needed, so it can't be reused here.
+            if (fieldIndex + 2 <= startIndex && previousFrameBuffer->hasFields(firstField, secondField)) {
+                std::swap(nextFrameBuffer, previousFrameBuffer);
+                continue;
+            }
+
             // Load fields into the buffer
-            nextFrameBuffer->loadFields(inputFields[fieldIndex + 2], inputFields[fieldIndex + 3]);
+            nextFrameBuffer->loadFields(firstField, secondField);
 
             // Extract chroma using 1D filter
             nextFrameBuffer->split1D();
@@ -188,22 +594,27 @@ void Comb::decodeFrames(const QVector<SourceField> &inputFields, qint32 startInd
         componentFrames[frameIndex].init(videoParameters);
         currentFrameBuffer->setComponentFrame(componentFrames[frameIndex]);
 
-        // Demodulate chroma giving I/Q
-        if (configuration.phaseCompensation) {
-            currentFrameBuffer->splitIQlocked();
+        if constexpr (std::is_same<SampleType, float>::value) {
+            // Demodulate, filter and transform chroma a line at a time
+            currentFrameBuffer->demodulateFloat(configuration.chromaGain, configuration.chromaPhase);
         } else {
-            currentFrameBuffer->splitIQ();
-            // Extract Y from baseband and I/Q
-            currentFrameBuffer->adjustY();
-        }
-        currentFrameBuffer->filterIQ();
+            // Demodulate chroma giving I/Q
+            if (configuration.phaseCompensation) {
+                currentFrameBuffer->splitIQlocked();
+            } else {
+                currentFrameBuffer->splitIQ();
+                // Extract Y from baseband and I/Q
+                currentFrameBuffer->adjustY();
+            }
+            currentFrameBuffer->filterIQ();
 
-        // Apply noise reduction
-        currentFrameBuffer->doCNR();
-        currentFrameBuffer->doYNR();
+            // Apply noise reduction
+            currentFrameBuffer->doCNR();
+            currentFrameBuffer->doYNR();
 
-        // Transform I/Q to U/V
-        currentFrameBuffer->transformIQ(configuration.chromaGain, configuration.chromaPhase);
+            // Transform I/Q to U/V
+            currentFrameBuffer->transformIQ(configuration.chromaGain, configuration.chromaPhase);
+        }
 
         // Overlay the map if required
         if (configuration.dimensions == 3 && configuration.showMap) {
@@ -212,10 +623,9 @@ void Comb::decodeFrames(const QVector<SourceField> &inputFields, qint32 startInd
     }
 }
 
-// Private methods ----------------------------------------------------------------------------------------------------
-
-Comb::FrameBuffer::FrameBuffer(const LdDecodeMetaData::VideoParameters &videoParameters_,
-                               const Configuration &configuration_)
+template <typename SampleType>
+Comb::FrameBuffer<SampleType>::FrameBuffer(const LdDecodeMetaData::VideoParameters &videoParameters_,
+                                           const Configuration &configuration_)
     : videoParameters(videoParameters_), configuration(configuration_)
 {
     // Set the frame height
@@ -223,6 +633,20 @@ Comb::FrameBuffer::FrameBuffer(const LdDecodeMetaData::VideoParameters &videoPar
 
     // Set the IRE scale
     irescale = (videoParameters.white16bIre - videoParameters.black16bIre) / 100;
+
+    // Clear clpbuffer.
+    // The filters only write to the active region, which is the same for
+    // every frame, so anything outside it stays zero after this.
+    for (qint32 buf = 0; buf < 3; buf++) {
+        for (qint32 y = 0; y < MAX_HEIGHT; y++) {
+            for (qint32 x = 0; x < MAX_WIDTH; x++) {
+                clpbuffer[buf].pixel[y][x] = 0.0;
+            }
+        }
+    }
+
+    // No component frame yet
+    componentFrame = nullptr;
 }
 
 /*
@@ -238,7 +662,17 @@ Comb::FrameBuffer::FrameBuffer(const LdDecodeMetaData::VideoParameters &videoPar
  * getLinePhase returns true if the color burst is rising at the leading edge.
  */
 
-inline qint32 Comb::FrameBuffer::getFieldID(qint32 lineNumber) const
+// Get a pointer to the baseband samples for a frame line
+template <typename SampleType>
+inline const quint16 *Comb::FrameBuffer<SampleType>::getLine(qint32 lineNumber) const
+{
+    const SourceVideo::DataView &fieldData = ((lineNumber % 2) == 0) ? firstFieldData : secondFieldData;
+
+    return fieldData.data() + ((lineNumber / 2) * videoParameters.fieldWidth);
+}
+
+template <typename SampleType>
+inline qint32 Comb::FrameBuffer<SampleType>::getFieldID(qint32 lineNumber) const
 {
     bool isFirstField = ((lineNumber % 2) == 0);
 
@@ -246,7 +680,8 @@ inline qint32 Comb::FrameBuffer::getFieldID(qint32 lineNumber) const
 }
 
 // NOTE:  lineNumber is presumed to be starting at 1.  (This lines up with how splitIQ calls it)
-inline bool Comb::FrameBuffer::getLinePhase(qint32 lineNumber) const
+template <typename SampleType>
+inline bool Comb::FrameBuffer<SampleType>::getLinePhase(qint32 lineNumber) const
 {
     qint32 fieldID = getFieldID(lineNumber);
     bool isPositivePhaseOnEvenLines = (fieldID == 1) || (fieldID == 4);
@@ -257,35 +692,40 @@ inline bool Comb::FrameBuffer::getLinePhase(qint32 lineNumber) const
     return isEvenLine ? isPositivePhaseOnEvenLines : !isPositivePhaseOnEvenLines;
 }
 
-// Interlace two source fields into the framebuffer.
-void Comb::FrameBuffer::loadFields(const SourceField &firstField, const SourceField &secondField)
+// Load two source fields into the framebuffer.
+// The fields are interlaced on access by getLine, rather than being copied.
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::loadFields(const SourceField &firstField, const SourceField &secondField)
 {
-    // Interlace the input fields and place in the frame buffer
-    qint32 fieldLine = 0;
-    rawbuffer.clear();
-    for (qint32 frameLine = 0; frameLine < frameHeight; frameLine += 2) {
-        rawbuffer.append(firstField.data.mid(fieldLine * videoParameters.fieldWidth, videoParameters.fieldWidth));
-        rawbuffer.append(secondField.data.mid(fieldLine * videoParameters.fieldWidth, videoParameters.fieldWidth));
-        fieldLine++;
-    }
+    firstFieldData = firstField.data;
+    secondFieldData = secondField.data;
 
     // Set the phase IDs for the frame
     firstFieldPhaseID = firstField.field.fieldPhaseID;
     secondFieldPhaseID = secondField.field.fieldPhaseID;
 
-    // Clear clpbuffer
-    for (qint32 buf = 0; buf < 3; buf++) {
-        for (qint32 y = 0; y < MAX_HEIGHT; y++) {
-            for (qint32 x = 0; x < MAX_WIDTH; x++) {
-                clpbuffer[buf].pixel[y][x] = 0.0;
-            }
-        }
-    }
+    // There's no need to clear clpbuffer, as the filters will overwrite all
+    // of the active region
 
     // No component frame yet
     componentFrame = nullptr;
 }
 
+// Return true if the framebuffer already contains the given fields.
+// The input data is never modified once loaded, so it's enough to check
+// that the samples are at the same address.
+template <typename SampleType>
+bool Comb::FrameBuffer<SampleType>::hasFields(const SourceField &firstField, const SourceField &secondField) const
+{
+    return !firstFieldData.empty()
+        && firstFieldData.data() == firstField.data.data()
+        && firstFieldData.size() == firstField.data.size()
+        && secondFieldData.data() == secondField.data.data()
+        && secondFieldData.size() == secondField.data.size()
+        && firstFieldPhaseID == firstField.field.fieldPhaseID
+        && secondFieldPhaseID == secondField.field.fieldPhaseID;
+}
+
 // Extract chroma into clpbuffer[0] using a 1D bandpass filter.
 //
 // The filter is [-0.25, 0, 0.5, 0, -0.25], a gentle bandpass centred on fSC.
@@ -294,18 +734,16 @@ void Comb::FrameBuffer::loadFields(const SourceField &firstField, const SourceFi
 //
 // This also acts as an alias removal pre-filter for the quadrature detector in
 // splitIQ, so we use its result for split2D rather than the raw signal.
-void Comb::FrameBuffer::split1D()
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::split1D()
 {
     for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
         // Get a pointer to the line's data
-        const quint16 *line = rawbuffer.data() + (lineNumber * videoParameters.fieldWidth);
+        const quint16 *line = getLine(lineNumber);
 
-        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            double tc1 = (line[h] - ((line[h - 2] + line[h + 2]) / 2.0)) / 2.0;
-
-            // Record the 1D C value
-            clpbuffer[0].pixel[lineNumber][h] = tc1;
-        }
+        // Record the 1D C values
+        split1DLine(line, clpbuffer[0].pixel[lineNumber],
+                    videoParameters.activeVideoStart, videoParameters.activeVideoEnd);
     }
 }
 
@@ -319,76 +757,31 @@ void Comb::FrameBuffer::split1D()
 // The "3-line adaptive" part means that we look at both surrounding lines to
 // estimate how similar they are to this one. We can then compute the 2D chroma
 // value as a blend of the two differences, weighted by similarity.
-void Comb::FrameBuffer::split2D()
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::split2D()
 {
     // Dummy black line
-    static constexpr double blackLine[MAX_WIDTH] = {0};
+    static constexpr SampleType blackLine[MAX_WIDTH] = {0};
+
+    // Map the difference into a weighting 0-1.
+    // 1 means in phase or unknown; 0 means out of phase (more than kRange difference).
+    const SampleType kRange = 45 * irescale;
 
     for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
         // Get pointers to the surrounding lines of 1D chroma.
         // If a line we need is outside the active area, use blackLine instead.
-        const double *previousLine = blackLine;
+        const SampleType *previousLine = blackLine;
         if (lineNumber - 2 >= videoParameters.firstActiveFrameLine) {
             previousLine = clpbuffer[0].pixel[lineNumber - 2];
         }
-        const double *currentLine = clpbuffer[0].pixel[lineNumber];
-        const double *nextLine = blackLine;
+        const SampleType *currentLine = clpbuffer[0].pixel[lineNumber];
+        const SampleType *nextLine = blackLine;
         if (lineNumber + 2 < videoParameters.lastActiveFrameLine) {
             nextLine = clpbuffer[0].pixel[lineNumber + 2];
         }
 
-        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            double kp, kn;
-
-            // Summing the differences of the *absolute* values of the 1D chroma samples
-            // will give us a low value if the two lines are nearly in phase (strong Y)
-            // or nearly 180 degrees out of phase (strong C) -- i.e. the two cases where
-            // the 2D filter is probably usable. Also give a small bonus if
-            // there's a large signal (we think).
-            kp  = fabs(fabs(currentLine[h]) - fabs(previousLine[h]));
-            kp += fabs(fabs(currentLine[h - 1]) - fabs(previousLine[h - 1]));
-            kp -= (fabs(currentLine[h]) + fabs(previousLine[h - 1])) * .10;
-            kn  = fabs(fabs(currentLine[h]) - fabs(nextLine[h]));
-            kn += fabs(fabs(currentLine[h - 1]) - fabs(nextLine[h - 1]));
-            kn -= (fabs(currentLine[h]) + fabs(nextLine[h - 1])) * .10;
-
-            // Map the difference into a weighting 0-1.
-            // 1 means in phase or unknown; 0 means out of phase (more than kRange difference).
-            const double kRange = 45 * irescale;
-            kp = qBound(0.0, 1 - (kp / kRange), 1.0);
-            kn = qBound(0.0, 1 - (kn / kRange), 1.0);
-
-            double sc = 1.0;
-
-            if ((kn > 0) || (kp > 0)) {
-                // At least one of the next/previous lines has a good phase relationship.
-
-                // If one of them is much better than the other, only use that one
-                if (kn > (3 * kp)) kp = 0;
-                else if (kp > (3 * kn)) kn = 0;
-
-                sc = (2.0 / (kn + kp));
-                if (sc < 1.0) sc = 1.0;
-            } else {
-                // Neither line has a good phase relationship.
-
-                // But are they similar to each other? If so, we can use both of them!
-                if ((fabs(fabs(previousLine[h]) - fabs(nextLine[h])) - fabs((nextLine[h] + previousLine[h]) * .2)) <= 0) {
-                    kn = kp = 1;
-                }
-
-                // Else kn = kp = 0, so we won't extract any chroma for this sample.
-                // (Some NTSC decoders fall back to the 1D chroma in this situation.)
-            }
-
-            // Compute the weighted sum of differences, giving the 2D chroma value
-            double tc1;
-            tc1  = ((currentLine[h] - previousLine[h]) * kp * sc);
-            tc1 += ((currentLine[h] - nextLine[h]) * kn * sc);
-            tc1 /= 4;
-
-            clpbuffer[1].pixel[lineNumber][h] = tc1;
-        }
+        split2DLine(previousLine, currentLine, nextLine, clpbuffer[1].pixel[lineNumber],
+                    videoParameters.activeVideoStart, videoParameters.activeVideoEnd, kRange);
     }
 }
 
@@ -398,131 +791,119 @@ void Comb::FrameBuffer::split2D()
 // should have a 180 degree phase relationship to the current sample, and look
 // like they have similar luma/chroma content. It then picks the most similar
 // candidate.
-void Comb::FrameBuffer::split3D(const FrameBuffer &previousFrame, const FrameBuffer &nextFrame)
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::split3D(const FrameBuffer &previousFrame, const FrameBuffer &nextFrame)
 {
+    qint32 bestIndex[MAX_WIDTH];
+    SampleType bestSample[MAX_WIDTH];
+
     for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
-        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            // Select the best candidate
-            qint32 bestIndex;
-            double bestSample;
-            getBestCandidate(lineNumber, h, previousFrame, nextFrame, bestIndex, bestSample);
-
-            if (bestIndex < CAND_PREV_FIELD) {
-                // A 1D or 2D candidate was best.
-                // Use split2D's output, to save duplicating the line-blending heuristics here.
-                clpbuffer[2].pixel[lineNumber][h] = clpbuffer[1].pixel[lineNumber][h];
-            } else {
-                // Compute a 3D result.
-                // This sample is Y + C; the candidate is (ideally) Y - C. So compute C as ((Y + C) - (Y - C)) / 2.
-                clpbuffer[2].pixel[lineNumber][h] = (clpbuffer[0].pixel[lineNumber][h] - bestSample) / 2;
-            }
-        }
+        // Select the best candidate for each sample
+        getBestCandidates(lineNumber, previousFrame, nextFrame, bestIndex, bestSample);
+
+        split3DLine(clpbuffer[0].pixel[lineNumber], clpbuffer[1].pixel[lineNumber], bestIndex, bestSample,
+                    clpbuffer[2].pixel[lineNumber], videoParameters.activeVideoStart, videoParameters.activeVideoEnd);
     }
 }
 
-// Evaluate all candidates for 3D decoding for a given position, and return the best one
-void Comb::FrameBuffer::getBestCandidate(qint32 lineNumber, qint32 h,
-                                         const FrameBuffer &previousFrame, const FrameBuffer &nextFrame,
-                                         qint32 &bestIndex, double &bestSample) const
+// Evaluate all candidates for 3D decoding for each sample in a line, and
+// return the index and 1D chroma sample of the best one in bestIndex[h] and
+// bestSample[h].
+//
+// Each candidate is the same displacement from the reference sample right
+// along the line, so this works a candidate at a time rather than a sample at
+// a time. The reference samples' luma and chroma are only computed once, and
+// whether a candidate's phase is viable only needs checking once per line.
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::getBestCandidates(qint32 lineNumber,
+                                                      const FrameBuffer &previousFrame, const FrameBuffer &nextFrame,
+                                                      qint32 *bestIndex, SampleType *bestSample) const
 {
-    Candidate candidates[8];
+    const qint32 start = videoParameters.activeVideoStart;
+    const qint32 end = videoParameters.activeVideoEnd;
+
+    if (!configuration.adaptive) {
+        // Adaptive mode is disabled - do 3D against the previous frame
+        const SampleType *candidateSamples = previousFrame.clpbuffer[0].pixel[lineNumber];
+        for (qint32 h = start; h < end; h++) {
+            bestIndex[h] = CAND_PREV_FRAME;
+            bestSample[h] = candidateSamples[h];
+        }
+        return;
+    }
 
     // Bias the comparison so that we prefer 3D results, then 2D, then 1D
     static constexpr double LINE_BONUS = -2.0;
     static constexpr double FIELD_BONUS = LINE_BONUS - 2.0;
     static constexpr double FRAME_BONUS = FIELD_BONUS - 2.0;
 
+    // A candidate: a line in a frame, displaced horizontally by offset samples
+    struct Candidate {
+        const FrameBuffer *frameBuffer;
+        qint32 lineNumber;
+        qint32 offset;
+        double adjustPenalty;
+    };
+    Candidate candidates[NUM_CANDIDATES];
+
     // 1D: Same line, 2 samples left and right
-    candidates[CAND_LEFT]  = getCandidate(lineNumber, h, *this, lineNumber, h - 2, 0);
-    candidates[CAND_RIGHT] = getCandidate(lineNumber, h, *this, lineNumber, h + 2, 0);
+    candidates[CAND_LEFT]  = {this, lineNumber, -2, 0};
+    candidates[CAND_RIGHT] = {this, lineNumber, 2, 0};
 
     // 2D: Same field, 1 line up and down
-    candidates[CAND_UP]   = getCandidate(lineNumber, h, *this, lineNumber - 2, h, LINE_BONUS);
-    candidates[CAND_DOWN] = getCandidate(lineNumber, h, *this, lineNumber + 2, h, LINE_BONUS);
+    candidates[CAND_UP]   = {this, lineNumber - 2, 0, LINE_BONUS};
+    candidates[CAND_DOWN] = {this, lineNumber + 2, 0, LINE_BONUS};
 
     // Immediately adjacent lines in previous/next field
     if (getLinePhase(lineNumber) == getLinePhase(lineNumber - 1)) {
-        candidates[CAND_PREV_FIELD] = getCandidate(lineNumber, h, previousFrame, lineNumber - 1, h, FIELD_BONUS);
-        candidates[CAND_NEXT_FIELD] = getCandidate(lineNumber, h, *this, lineNumber + 1, h, FIELD_BONUS);
+        candidates[CAND_PREV_FIELD] = {&previousFrame, lineNumber - 1, 0, FIELD_BONUS};
+        candidates[CAND_NEXT_FIELD] = {this, lineNumber + 1, 0, FIELD_BONUS};
     } else {
-        candidates[CAND_PREV_FIELD] = getCandidate(lineNumber, h, *this, lineNumber - 1, h, FIELD_BONUS);
-        candidates[CAND_NEXT_FIELD] = getCandidate(lineNumber, h, nextFrame, lineNumber + 1, h, FIELD_BONUS);
+        candidates[CAND_PREV_FIELD] = {this, lineNumber - 1, 0, FIELD_BONUS};
+        candidates[CAND_NEXT_FIELD] = {&nextFrame, lineNumber + 1, 0, FIELD_BONUS};
     }
 
     // Previous/next frame, same position
-    candidates[CAND_PREV_FRAME] = getCandidate(lineNumber, h, previousFrame, lineNumber, h, FRAME_BONUS);
-    candidates[CAND_NEXT_FRAME] = getCandidate(lineNumber, h, nextFrame, lineNumber, h, FRAME_BONUS);
-
-    if (configuration.adaptive) {
-        // Find the candidate with the lowest penalty
-        bestIndex = 0;
-        for (qint32 i = 1; i < NUM_CANDIDATES; i++) {
-            if (candidates[i].penalty < candidates[bestIndex].penalty) bestIndex = i;
-        }
-    } else {
-        // Adaptive mode is disabled - do 3D against the previous frame
-        bestIndex = CAND_PREV_FRAME;
+    candidates[CAND_PREV_FRAME] = {&previousFrame, lineNumber, 0, FRAME_BONUS};
+    candidates[CAND_NEXT_FRAME] = {&nextFrame, lineNumber, 0, FRAME_BONUS};
+
+    // Compute the reference samples' luma, including one sample either side
+    const quint16 *refLine = getLine(lineNumber);
+    const SampleType *refC = clpbuffer[1].pixel[lineNumber];
+    SampleType refY[MAX_WIDTH];
+    for (qint32 h = start - 1; h < end + 1; h++) {
+        refY[h] = refLine[h] - refC[h];
     }
 
-    bestSample = candidates[bestIndex].sample;
-}
-
-// Evaluate a candidate for 3D decoding
-Comb::FrameBuffer::Candidate Comb::FrameBuffer::getCandidate(qint32 refLineNumber, qint32 refH,
-                                                             const FrameBuffer &frameBuffer, qint32 lineNumber, qint32 h,
-                                                             double adjustPenalty) const
-{
-    Candidate result;
-    result.sample = frameBuffer.clpbuffer[0].pixel[lineNumber][h];
-
-    // If the candidate is outside the active region (vertically), it's not viable
-    if (lineNumber < videoParameters.firstActiveFrameLine || lineNumber >= videoParameters.lastActiveFrameLine) {
-        result.penalty = 1000.0;
-        return result;
-    }
-
-    // The target sample should have 180 degrees phase difference from the reference.
-    // If it doesn't (e.g. because it's a blank frame or the player skipped), it's not viable.
-    const qint32 wantPhase = (2 + (getLinePhase(refLineNumber) ? 2 : 0) + refH) % 4;
-    const qint32 havePhase = ((frameBuffer.getLinePhase(lineNumber) ? 2 : 0) + h) % 4;
-    if (wantPhase != havePhase) {
-        result.penalty = 1000.0;
-        return result;
-    }
-
-    // Pointers to the baseband data
-    const quint16 *refLine = rawbuffer.data() + (refLineNumber * videoParameters.fieldWidth);
-    const quint16 *candidateLine = frameBuffer.rawbuffer.data() + (lineNumber * videoParameters.fieldWidth);
-
-    // Penalty based on mean luma difference in IRE over surrounding three samples
-    double yPenalty = 0.0;
-    for (qint32 offset = -1; offset < 2; offset++) {
-        const double refC = clpbuffer[1].pixel[refLineNumber][refH + offset];
-        const double refY = refLine[refH + offset] - refC;
-
-        const double candidateC = frameBuffer.clpbuffer[1].pixel[lineNumber][h + offset];
-        const double candidateY = candidateLine[h + offset] - candidateC;
-
-        yPenalty += fabs(refY - candidateY);
-    }
-    yPenalty = yPenalty / 3 / irescale;
-
-    // Penalty based on mean I/Q difference in IRE over surrounding three samples
-    double iqPenalty = 0.0;
-    for (qint32 offset = -1; offset < 2; offset++) {
-        // The reference and candidate are 180 degrees out of phase here, so negate one
-        const double refC = clpbuffer[1].pixel[refLineNumber][refH + offset];
-        const double candidateC = -frameBuffer.clpbuffer[1].pixel[lineNumber][h + offset];
+    // Compute the penalty for every candidate, then choose the best
+    SampleType penalties[NUM_CANDIDATES][MAX_WIDTH];
+    const SampleType *candidateSamples[NUM_CANDIDATES];
+    for (qint32 i = 0; i < NUM_CANDIDATES; i++) {
+        const FrameBuffer &frameBuffer = *candidates[i].frameBuffer;
+        const qint32 candidateLineNumber = candidates[i].lineNumber;
+        const qint32 offset = candidates[i].offset;
+        SampleType *penalty = penalties[i];
+
+        if (candidateLineNumber < videoParameters.firstActiveFrameLine
+            || candidateLineNumber >= videoParameters.lastActiveFrameLine) {
+            // The candidate is outside the active region (vertically), so it's not viable
+            std::fill(penalty + start, penalty + end, SampleType(1000.0));
+        } else if (((2 + (getLinePhase(lineNumber) ? 2 : 0) - (frameBuffer.getLinePhase(candidateLineNumber) ? 2 : 0) - offset) % 4) != 0) {
+            // The target sample should have 180 degrees phase difference from the reference.
+            // If it doesn't (e.g. because it's a blank frame or the player skipped), it's not viable.
+            std::fill(penalty + start, penalty + end, SampleType(1000.0));
+        } else {
+            candidatePenaltyLine(refY, refC,
+                                 frameBuffer.getLine(candidateLineNumber) + offset,
+                                 frameBuffer.clpbuffer[1].pixel[candidateLineNumber] + offset,
+                                 penalty, start, end, irescale, candidates[i].adjustPenalty);
+        }
 
-        // I and Q samples alternate, so weight the two channels equally
-        static constexpr double weights[] = {0.5, 1.0, 0.5};
-        iqPenalty += fabs(refC - candidateC) * weights[offset + 1];
+        candidateSamples[i] = frameBuffer.clpbuffer[0].pixel[candidateLineNumber] + offset;
     }
-    // Weaken this relative to luma, to avoid spurious colour in the 2D result from showing through
-    iqPenalty = (iqPenalty / 2 / irescale) * 0.28;
 
-    result.penalty = yPenalty + iqPenalty + adjustPenalty;
-    return result;
+    // Keep the candidate with the lowest penalty (or the first, if there's a tie)
+    chooseBestLine(penalties, candidateSamples, bestIndex, bestSample, start, end);
 }
 
 namespace {
@@ -566,11 +947,12 @@ namespace {
 }
 
 // Split I and Q, taking burst phase into account.
-void Comb::FrameBuffer::splitIQlocked()
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::splitIQlocked()
 {
     for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
         // Get a pointer to the line's data
-        const quint16 *line = rawbuffer.data() + (lineNumber * videoParameters.fieldWidth);
+        const quint16 *line = getLine(lineNumber);
         // Calculate burst phase
         const auto info = detectBurst(line, videoParameters);
 
@@ -600,11 +982,12 @@ void Comb::FrameBuffer::splitIQlocked()
 }
 
 // Spilt the I and Q
-void Comb::FrameBuffer::splitIQ()
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::splitIQ()
 {
     for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
         // Get a pointer to the line's data
-        const quint16 *line = rawbuffer.data() + (lineNumber * videoParameters.fieldWidth);
+        const quint16 *line = getLine(lineNumber);
 
         double *Y = componentFrame->y(lineNumber);
         double *I = componentFrame->u(lineNumber);
@@ -636,7 +1019,8 @@ void Comb::FrameBuffer::splitIQ()
 }
 
 // Filter the IQ from the component frame
-void Comb::FrameBuffer::filterIQ()
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::filterIQ()
 {
     auto iqFilter = makeFIRFilter(c_colorlp_b);
 
@@ -659,7 +1043,8 @@ void Comb::FrameBuffer::filterIQ()
 }
 
 // Remove the colour data from the baseband (Y)
-void Comb::FrameBuffer::adjustY()
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::adjustY()
 {
     // remove color data from baseband (Y)
     for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
@@ -695,7 +1080,8 @@ void Comb::FrameBuffer::adjustY()
  * which removes small high frequency noise.
  */
 
-void Comb::FrameBuffer::doCNR()
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::doCNR()
 {
     if (configuration.cNRLevel == 0) return;
 
@@ -752,7 +1138,8 @@ void Comb::FrameBuffer::doCNR()
     }
 }
 
-void Comb::FrameBuffer::doYNR()
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::doYNR()
 {
     if (configuration.yNRLevel == 0) return;
 
@@ -797,7 +1184,8 @@ void Comb::FrameBuffer::doYNR()
 }
 
 // Transform I/Q into U/V, and apply chroma gain
-void Comb::FrameBuffer::transformIQ(double chromaGain, double chromaPhase)
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::transformIQ(double chromaGain, double chromaPhase)
 {
     // Compute components for the rotation vector
     const double theta = ((33 + chromaPhase) * M_PI) / 180;
@@ -819,8 +1207,84 @@ void Comb::FrameBuffer::transformIQ(double chromaGain, double chromaPhase)
     }
 }
 
+// Demodulate, filter and noise-reduce the chroma in single precision, and
+// write the result to the component frame. This does the same job as
+// splitIQ/splitIQlocked through transformIQ above. All of those only look
+// along the line, so each line can be processed in float buffers and
+// converted to double once at the end.
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::demodulateFloat(double chromaGain, double chromaPhase)
+{
+    const qint32 start = videoParameters.activeVideoStart;
+    const qint32 end = videoParameters.activeVideoEnd;
+
+    // Line buffers, with room for the filters to read zeros either side of
+    // the active area. Only the active area is ever written, so the rest
+    // stays zero.
+    static constexpr qint32 PAD = 16;
+    float yBuffer[PAD + MAX_WIDTH + PAD] = {};
+    float iBuffer[PAD + MAX_WIDTH + PAD] = {};
+    float qBuffer[PAD + MAX_WIDTH + PAD] = {};
+    float filteredIBuffer[PAD + MAX_WIDTH + PAD] = {};
+    float filteredQBuffer[PAD + MAX_WIDTH + PAD] = {};
+    float highPass[MAX_WIDTH];
+    float *Y = yBuffer + PAD;
+    float *I = iBuffer + PAD;
+    float *Q = qBuffer + PAD;
+    float *filteredI = filteredIBuffer + PAD;
+    float *filteredQ = filteredQBuffer + PAD;
+
+    // Coring levels for noise reduction
+    const float nr_c = configuration.cNRLevel * irescale;
+    const float nr_y = configuration.yNRLevel * irescale;
+
+    // Components for the rotation vector
+    const double theta = ((33 + chromaPhase) * M_PI) / 180;
+    const float bp = sin(theta) * chromaGain;
+    const float bq = cos(theta) * chromaGain;
+
+    for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
+        const quint16 *line = getLine(lineNumber);
+        const SampleType *chroma = clpbuffer[configuration.dimensions - 1].pixel[lineNumber];
+
+        // Demodulate chroma giving I/Q, and extract Y
+        if (configuration.phaseCompensation) {
+            // Combine the rotation by the burst phase with the 33 degree
+            // rotation in splitIQlocked
+            const auto info = detectBurst(line, videoParameters);
+            const float rotateI = (info.bcos * ROTATE_COS) + (info.bsin * ROTATE_SIN);
+            const float rotateQ = (info.bcos * ROTATE_SIN) - (info.bsin * ROTATE_COS);
+            splitIQLockedLine(line, chroma, rotateI, rotateQ, Y, I, Q, start, end);
+        } else {
+            splitIQLine(line, chroma, getLinePhase(lineNumber), Y, I, Q, start, end);
+        }
+
+        // Low-pass filter I/Q
+        firLine(I, colorLPCoeffsFloat, filteredI, start, end);
+        firLine(Q, colorLPCoeffsFloat, filteredQ, start, end);
+
+        // Apply noise reduction
+        if (configuration.cNRLevel != 0) {
+            firLine(filteredI, nrcCoeffsFloat, highPass, start, end);
+            coreLine(highPass, nr_c, filteredI, start, end);
+            firLine(filteredQ, nrcCoeffsFloat, highPass, start, end);
+            coreLine(highPass, nr_c, filteredQ, start, end);
+        }
+        if (configuration.yNRLevel != 0) {
+            firLine(Y, nrCoeffsFloat, highPass, start, end);
+            coreLine(highPass, nr_y, Y, start, end);
+        }
+
+        // Transform I/Q to U/V
+        transformIQLine(Y, filteredI, filteredQ, bp, bq,
+                        componentFrame->y(lineNumber), componentFrame->u(lineNumber), componentFrame->v(lineNumber),
+                        start, end);
+    }
+}
+
 // Overlay the 3D filter map onto the output
-void Comb::FrameBuffer::overlayMap(const FrameBuffer &previousFrame, const FrameBuffer &nextFrame)
+template <typename SampleType>
+void Comb::FrameBuffer<SampleType>::overlayMap(const FrameBuffer &previousFrame, const FrameBuffer &nextFrame)
 {
     qDebug() << "Comb::FrameBuffer::overlayMap(): Overlaying map onto output";
 
@@ -839,20 +1303,20 @@ void Comb::FrameBuffer::overlayMap(const FrameBuffer &previousFrame, const Frame
     }
 
     // For each sample in the frame...
+    qint32 bestIndex[MAX_WIDTH];
+    SampleType bestSample[MAX_WIDTH];
     for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
         double *U = componentFrame->u(lineNumber);
         double *V = componentFrame->v(lineNumber);
 
+        // Select the best candidate for each sample
+        getBestCandidates(lineNumber, previousFrame, nextFrame, bestIndex, bestSample);
+
         // Fill the output frame with the RGB values
         for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            // Select the best candidate
-            qint32 bestIndex;
-            double bestSample;
-            getBestCandidate(lineNumber, h, previousFrame, nextFrame, bestIndex, bestSample);
-
             // Leave Y' the same, but replace UV with the appropriate shade
-            U[h] = shades[bestIndex].u;
-            V[h] = shades[bestIndex].v;
+            U[h] = shades[bestIndex[h]].u;
+            V[h] = shades[bestIndex[h]].v;
         }
     }
 }
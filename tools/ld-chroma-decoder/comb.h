@@ -32,6 +32,7 @@
 #include <QDebug>
 #include <QFile>
 #include <QtMath>
+#include <memory>
 
 #include "lddecodemetadata.h"
 
@@ -53,11 +54,16 @@ public:
         bool showMap = false;
         bool phaseCompensation = false;
 
+        // Use single-precision arithmetic for chroma separation.
+        // This is faster, but the output isn't bit-identical to the default.
+        bool singlePrecision = false;
+
         double cNRLevel = 0.0;
         double yNRLevel = 1.0;
 
         qint32 getLookBehind() const;
         qint32 getLookAhead() const;
+        void getRegionMargin(qint32 &xMargin, qint32 &yMargin, qint32 &xAlignment, qint32 &yAlignment) const;
     };
 
     const Configuration &getConfiguration() const;
@@ -80,12 +86,15 @@ private:
     Configuration configuration;
     LdDecodeMetaData::VideoParameters videoParameters;
 
-    // An input frame in the process of being decoded
+    // An input frame in the process of being decoded.
+    // SampleType is the type used for the filtered chroma samples.
+    template <typename SampleType>
     class FrameBuffer {
     public:
         FrameBuffer(const LdDecodeMetaData::VideoParameters &videoParameters_, const Configuration &configuration_);
 
         void loadFields(const SourceField &firstField, const SourceField &secondField);
+        bool hasFields(const SourceField &firstField, const SourceField &secondField) const;
 
         void split1D();
         void split2D();
@@ -103,6 +112,7 @@ private:
         void doCNR();
         void doYNR();
         void transformIQ(double chromaGain, double chromaPhase);
+        void demodulateFloat(double chromaGain, double chromaPhase);
 
         void overlayMap(const FrameBuffer &previousFrame, const FrameBuffer &nextFrame);
 
@@ -116,8 +126,10 @@ private:
         // IRE scaling
         double irescale;
 
-        // Baseband samples (interlaced to form a complete frame)
-        SourceVideo::Data rawbuffer;
+        // Baseband samples for the frame's two fields.
+        // These are views of the input, so loading a frame doesn't copy the samples.
+        SourceVideo::DataView firstFieldData;
+        SourceVideo::DataView secondFieldData;
 
         // Chroma phase of the frame's two fields
         qint32 firstFieldPhaseID;
@@ -125,27 +137,43 @@ private:
 
         // 1D, 2D and 3D-filtered chroma samples
         struct Sample {
-            double pixel[MAX_HEIGHT][MAX_WIDTH];
+            SampleType pixel[MAX_HEIGHT][MAX_WIDTH];
         } clpbuffer[3];
 
-        // Result of evaluating a 3D candidate
-        struct Candidate {
-            double penalty;
-            double sample;
-        };
-
         // The component frame for output (if there is one)
         ComponentFrame *componentFrame;
 
+        inline const quint16 *getLine(qint32 lineNumber) const;
         inline qint32 getFieldID(qint32 lineNumber) const;
         inline bool getLinePhase(qint32 lineNumber) const;
-        void getBestCandidate(qint32 lineNumber, qint32 h,
-                              const FrameBuffer &previousFrame, const FrameBuffer &nextFrame,
-                              qint32 &bestIndex, double &bestSample) const;
-        Candidate getCandidate(qint32 refLineNumber, qint32 refH,
-                               const FrameBuffer &frameBuffer, qint32 lineNumber, qint32 h,
-                               double adjustPenalty) const;
+        void getBestCandidates(qint32 lineNumber,
+                               const FrameBuffer &previousFrame, const FrameBuffer &nextFrame,
+                               qint32 *bestIndex, SampleType *bestSample) const;
+    };
+
+    // Buffers for the previous, current and next frame.
+    // These are kept between calls to decodeFrames, so they're only allocated
+    // once, and so the last frames of one batch can be reused as the
+    // look-behind frames of the next.
+    template <typename SampleType>
+    struct FrameBuffers {
+        std::unique_ptr<FrameBuffer<SampleType>> previous;
+        std::unique_ptr<FrameBuffer<SampleType>> current;
+        std::unique_ptr<FrameBuffer<SampleType>> next;
+
+        void reset() {
+            previous.reset();
+            current.reset();
+            next.reset();
+        }
     };
+    FrameBuffers<double> doubleFrameBuffers;
+    FrameBuffers<float> floatFrameBuffers;
+
+    template <typename SampleType>
+    void decodeFramesUsing(FrameBuffers<SampleType> &frameBuffers,
+                           const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
+                           QVector<ComponentFrame> &componentFrames);
 };
 
 #endif // COMB_H
@@ -25,7 +25,7 @@
 #include "componentframe.h"
 
 ComponentFrame::ComponentFrame()
-    : width(-1), height(-1)
+    : width(-1), height(-1), lineSink(nullptr), streaming(false)
 {
 }
 
@@ -34,7 +34,9 @@ void ComponentFrame::init(const LdDecodeMetaData::VideoParameters &videoParamete
     width = videoParameters.fieldWidth;
     height = (videoParameters.fieldHeight * 2) - 1;
 
-    const qint32 size = width * height;
+    // A streaming frame only needs space for one line
+    streaming = (lineSink != nullptr);
+    const qint32 size = streaming ? width : width * height;
 
     yData.resize(size);
     yData.fill(0.0);
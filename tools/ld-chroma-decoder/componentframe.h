@@ -36,18 +36,48 @@
 // The luma and chroma samples have the same scaling as in the original
 // composite signal (i.e. they're not in Y'CbCr form yet). You can recover the
 // chroma signal by subtracting Y from the composite signal.
+//
+// If the frame has a LineSink, it only stores one line at a time: the decoder
+// calls finishLine once it has written each line, and the line is passed
+// straight on to the sink rather than being kept until the frame is complete.
 class ComponentFrame
 {
 public:
     ComponentFrame();
 
+    // Receiver for lines from a streaming frame
+    class LineSink {
+    public:
+        virtual ~LineSink() = default;
+
+        // Accept one finished line. u and v are nullptr if the frame is mono.
+        virtual void putLine(qint32 line, const double *y, const double *u, const double *v) = 0;
+    };
+
     // Set the frame's size and clear it to black
     // If mono is true, only Y set to black, while U and V are cleared.
     void init(const LdDecodeMetaData::VideoParameters &videoParameters, bool mono=false);
 
+    // Set the sink that finished lines are passed to, or nullptr to store the
+    // whole frame. This takes effect at the next init.
+    void setLineSink(LineSink *sink) {
+        lineSink = sink;
+    }
+
+    // For decoders: the given line has been completely written.
+    // Lines within each field must be finished in ascending order.
+    void finishLine(qint32 line) {
+        if (lineSink != nullptr) {
+            lineSink->putLine(line, y(line), uData.isEmpty() ? nullptr : u(line),
+                              vData.isEmpty() ? nullptr : v(line));
+        }
+    }
+
     // Get a pointer to a line of samples. Line numbers are 0-based within the frame.
-    // Lines are stored in a contiguous array, so it's safe to get a pointer to
-    // line 0 and use it to refer to later lines.
+    // Unless the frame has a LineSink, lines are stored in a contiguous array,
+    // so it's safe to get a pointer to line 0 and use it to refer to later lines.
+    // If it does, all lines share the same storage, which the decoder must
+    // not use again after calling finishLine.
     double *y(qint32 line) {
         return yData.data() + getLineOffset(line);
     }
@@ -77,20 +107,26 @@ public:
 private:
     qint32 getLineOffset(qint32 line) const {
         assert(line >= 0);
-        assert(line < yData.size());
-        return line * width;
+        assert(line < height);
+        return streaming ? 0 : line * width;
     }
 
     qint32 getLineOffsetUV(qint32 line) const {
         assert(line >= 0);
-        assert(line < uData.size());
-        return line * width;
+        assert(line < height);
+        assert(!uData.isEmpty());
+        return streaming ? 0 : line * width;
     }
 
     // Size of the frame
     qint32 width;
     qint32 height;
 
+    // Where finished lines go, and whether the frame was initialised to
+    // store only one line
+    LineSink *lineSink;
+    bool streaming;
+
     // Samples for Y, U and V
     QVector<double> yData;
     QVector<double> uData;
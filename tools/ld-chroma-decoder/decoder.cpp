@@ -36,8 +36,27 @@ qint32 Decoder::getLookAhead() const
     return 0;
 }
 
+qint32 Decoder::getBatchAlignment() const
+{
+    return 1;
+}
+
+void Decoder::getRegionMargin(qint32 &xMargin, qint32 &yMargin, qint32 &xAlignment, qint32 &yAlignment) const
+{
+    xMargin = 0;
+    yMargin = 0;
+    xAlignment = 1;
+    yAlignment = 1;
+}
+
+bool DecoderThread::streamsLines() const
+{
+    return false;
+}
+
 DecoderThread::DecoderThread(QAtomicInt& _abort, DecoderPool& _decoderPool, QObject *parent)
-    : QThread(parent), abort(_abort), decoderPool(_decoderPool), outputWriter(_decoderPool.getOutputWriter())
+    : QThread(parent), abort(_abort), decoderPool(_decoderPool),
+      workerNumber(_decoderPool.addWorker()), outputWriters(_decoderPool.getOutputWriters())
 {
 }
 
@@ -46,12 +65,17 @@ void DecoderThread::run()
     // Input and output data
     QVector<SourceField> inputFields;
     QVector<ComponentFrame> componentFrames;
-    QVector<OutputFrame> outputFrames;
+    QVector<FrameConverter> frameConverters;
+    QVector<QVector<OutputFrame>> outputFrames(outputWriters.size());
+
+    // If the decoder can, have it pass each line straight to the output
+    // writer, rather than storing complete component frames
+    const bool streaming = streamsLines();
 
     while (!abort) {
         // Get the next batch of fields to process
         qint32 startFrameNumber, startIndex, endIndex;
-        if (!decoderPool.getInputFrames(startFrameNumber, inputFields, startIndex, endIndex)) {
+        if (!decoderPool.getInputFrames(workerNumber, startFrameNumber, inputFields, startIndex, endIndex)) {
             // No more input frames -- exit
             break;
         }
@@ -59,20 +83,67 @@ void DecoderThread::run()
         // Adjust the temporary arrays to the right size
         const qint32 numFrames = (endIndex - startIndex) / 2;
         componentFrames.resize(numFrames);
-        outputFrames.resize(numFrames);
+        for (QVector<OutputFrame> &frames : outputFrames) {
+            frames.resize(numFrames);
+        }
 
-        // Decode the fields to component frames
-        decodeFrames(inputFields, startIndex, endIndex, componentFrames);
+        if (streaming) {
+            frameConverters.resize(numFrames);
+        }
 
-        // Convert the component frames to the output format
-        for (qint32 i = 0; i < numFrames; i++) {
-            outputWriter.convert(componentFrames[i], outputFrames[i]);
+        // Decode the fields and convert them to each output format, measuring how long it takes
+        QElapsedTimer decodeTimer;
+        decodeTimer.start();
+
+        if (streaming) {
+            // Decode the fields, converting each line as it's finished
+            for (qint32 i = 0; i < numFrames; i++) {
+                frameConverters[i].begin(outputWriters, outputFrames, i);
+                componentFrames[i].setLineSink(&frameConverters[i]);
+            }
+            decodeFrames(inputFields, startIndex, endIndex, componentFrames);
+            for (qint32 i = 0; i < numFrames; i++) {
+                frameConverters[i].finish();
+            }
+        } else {
+            // Decode the fields to component frames, then convert them
+            decodeFrames(inputFields, startIndex, endIndex, componentFrames);
+            for (qint32 j = 0; j < outputWriters.size(); j++) {
+                for (qint32 i = 0; i < numFrames; i++) {
+                    outputWriters[j].convert(componentFrames[i], outputFrames[j][i]);
+                }
+            }
         }
 
-        // Write the frames to the output file
+        decoderPool.reportDecodeTime(numFrames, decodeTimer.nsecsElapsed());
+
+        // Write the frames to the output files
         if (!decoderPool.putOutputFrames(startFrameNumber, outputFrames)) {
             abort = true;
             break;
         }
     }
 }
+
+void DecoderThread::FrameConverter::begin(const QVector<OutputWriter> &outputWriters,
+                                          QVector<QVector<OutputFrame>> &outputFrames, qint32 frameIndex)
+{
+    converters.resize(outputWriters.size());
+    for (qint32 i = 0; i < outputWriters.size(); i++) {
+        converters[i].begin(outputWriters[i], outputFrames[i][frameIndex]);
+    }
+}
+
+void DecoderThread::FrameConverter::putLine(qint32 line, const double *y, const double *u, const double *v)
+{
+    for (OutputWriter::LineConverter &converter : converters) {
+        converter.putLine(line, y, u, v);
+    }
+}
+
+void DecoderThread::FrameConverter::finish()
+{
+    for (OutputWriter::LineConverter &converter : converters) {
+        converter.finish();
+    }
+}
@@ -28,6 +28,7 @@
 #include <QAtomicInt>
 #include <QByteArray>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QThread>
 #include <cassert>
 
@@ -75,6 +76,22 @@ public:
     // The default implementation returns 0, which is appropriate for 1D/2D decoders.
     virtual qint32 getLookAhead() const;
 
+    // After configuration, return the number of frames that batches of input
+    // should be a multiple of, for the decoder's output not to depend on how
+    // the input is divided into batches. (The last batch may be shorter.)
+    // The default implementation returns 1.
+    virtual qint32 getBatchAlignment() const;
+
+    // Return the margin, in samples horizontally and frame lines vertically,
+    // that the decoder needs around a region of interest, so that decoding
+    // only the region plus the margin gives the same output within the region
+    // as decoding the whole active area. The start of the decoded area must
+    // also be a multiple of xAlignment/yAlignment from the start of the full
+    // active area. Unlike the methods above, this is called before
+    // configuration. The default implementation returns no margin, which is
+    // appropriate for decoders that treat each sample independently.
+    virtual void getRegionMargin(qint32 &xMargin, qint32 &yMargin, qint32 &xAlignment, qint32 &yAlignment) const;
+
     // Construct a new worker thread
     virtual QThread *makeThread(QAtomicInt& abort, DecoderPool& decoderPool) = 0;
 
@@ -98,12 +115,31 @@ protected:
     virtual void decodeFrames(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
                               QVector<ComponentFrame> &componentFrames) = 0;
 
+    // Return true if decodeFrames calls ComponentFrame::finishLine for each
+    // line it decodes, so the frames can be streamed to the OutputWriter
+    // rather than stored. The default implementation returns false.
+    virtual bool streamsLines() const;
+
     // Decoder pool
     QAtomicInt &abort;
     DecoderPool &decoderPool;
-
-    // Output writer
-    OutputWriter &outputWriter;
+    const qint32 workerNumber;
+
+    // Output writers, one for each output
+    const QVector<OutputWriter> &outputWriters;
+
+private:
+    // Passes each line of a ComponentFrame to a LineConverter for every output
+    class FrameConverter : public ComponentFrame::LineSink {
+    public:
+        void begin(const QVector<OutputWriter> &outputWriters, QVector<QVector<OutputFrame>> &outputFrames,
+                   qint32 frameIndex);
+        void putLine(qint32 line, const double *y, const double *u, const double *v) override;
+        void finish();
+
+    private:
+        QVector<OutputWriter::LineConverter> converters;
+    };
 };
 
 #endif
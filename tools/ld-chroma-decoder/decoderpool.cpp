@@ -26,24 +26,89 @@
 
 #include "decoderpool.h"
 
+#include <cassert>
+#include <cmath>
+
 DecoderPool::DecoderPool(Decoder &_decoder, QString _inputFileName,
-                         LdDecodeMetaData &_ldDecodeMetaData,
-                         OutputWriter::Configuration &_outputConfig, QString _outputFileName,
-                         qint32 _startFrame, qint32 _length, qint32 _maxThreads)
-    : decoder(_decoder), inputFileName(_inputFileName),
-      outputConfig(_outputConfig), outputFileName(_outputFileName),
-      startFrame(_startFrame), length(_length), maxThreads(_maxThreads),
+                         LdDecodeMetaData &_ldDecodeMetaData, const QVector<Output> &_outputs,
+                         qint32 _startFrame, qint32 _length, qint32 _frameStep, const QRect &_region,
+                         qint32 _maxThreads)
+    : decoder(_decoder), inputFileName(_inputFileName), outputs(_outputs),
+      startFrame(_startFrame), length(_length), frameStep(_frameStep), region(_region),
+      maxThreads(_maxThreads),
       abort(false), ldDecodeMetaData(_ldDecodeMetaData)
 {
 }
 
+// Thread that writes frames from the output ring to the output file
+class DecoderPool::WriterThread : public QThread
+{
+public:
+    explicit WriterThread(DecoderPool &_decoderPool)
+        : decoderPool(_decoderPool) {}
+
+protected:
+    void run() override {
+        decoderPool.runWriter();
+    }
+
+private:
+    DecoderPool &decoderPool;
+};
+
+qint32 DecoderPool::addWorker()
+{
+    QMutexLocker locker(&inputMutex);
+
+    workers.append(Worker());
+    return workers.size() - 1;
+}
+
 bool DecoderPool::process()
 {
-    LdDecodeMetaData::VideoParameters videoParameters = ldDecodeMetaData.getVideoParameters();
+    const LdDecodeMetaData::VideoParameters inputVideoParameters = ldDecodeMetaData.getVideoParameters();
 
-    // Configure the OutputWriter, adjusting videoParameters
-    outputWriter.updateConfiguration(videoParameters, outputConfig);
-    outputWriter.printOutputInfo();
+    // Narrow the active area to the region of interest, if there is one
+    LdDecodeMetaData::VideoParameters regionVideoParameters = inputVideoParameters;
+    if (!setRegion(regionVideoParameters)) {
+        return false;
+    }
+
+    // Configure the OutputWriters. Each may widen the active area to suit its
+    // padding, so the decoder needs to decode the widest of them.
+    LdDecodeMetaData::VideoParameters videoParameters = regionVideoParameters;
+    LdDecodeMetaData::VideoParameters fullVideoParameters = inputVideoParameters;
+    outputWriters.resize(outputs.size());
+    for (qint32 i = 0; i < outputs.size(); i++) {
+        LdDecodeMetaData::VideoParameters outputVideoParameters = regionVideoParameters;
+        outputWriters[i].updateConfiguration(outputVideoParameters, outputs[i].config);
+        outputWriters[i].printOutputInfo();
+
+        videoParameters.activeVideoStart = qMin(videoParameters.activeVideoStart,
+                                                outputVideoParameters.activeVideoStart);
+        videoParameters.activeVideoEnd = qMax(videoParameters.activeVideoEnd,
+                                              outputVideoParameters.activeVideoEnd);
+
+        if (!region.isNull()) {
+            // Also work out what would be decoded without a region
+            OutputWriter fullOutputWriter;
+            outputVideoParameters = inputVideoParameters;
+            fullOutputWriter.updateConfiguration(outputVideoParameters, outputs[i].config);
+
+            fullVideoParameters.activeVideoStart = qMin(fullVideoParameters.activeVideoStart,
+                                                        outputVideoParameters.activeVideoStart);
+            fullVideoParameters.activeVideoEnd = qMax(fullVideoParameters.activeVideoEnd,
+                                                      outputVideoParameters.activeVideoEnd);
+        }
+    }
+
+    // The decoder needs to decode a margin around the region, so the output
+    // within it is the same as if the whole frame had been decoded
+    if (!region.isNull()) {
+        addRegionMargin(fullVideoParameters, videoParameters);
+        qInfo() << "Decoding samples" << videoParameters.activeVideoStart << "to" << videoParameters.activeVideoEnd
+                << "of frame lines" << videoParameters.firstActiveFrameLine << "to" << videoParameters.lastActiveFrameLine;
+    }
 
     // Configure the decoder, and check that it can accept this video
     if (!decoder.configure(videoParameters)) {
@@ -53,6 +118,19 @@ bool DecoderPool::process()
     // Get the decoder's lookbehind/lookahead requirements
     decoderLookBehind = decoder.getLookBehind();
     decoderLookAhead = decoder.getLookAhead();
+    decoderBatchAlignment = decoder.getBatchAlignment();
+
+    if (frameStep == 1) {
+        // Read ahead far enough to cover the next batch of frames, including the
+        // decoder's lookahead. (loadBatches keeps the lookbehind frames itself.)
+        sourceVideo.setReadAhead(2 * (MAX_BATCH_SIZE + decoderLookAhead));
+    } else {
+        // Each frame is decoded on its own (see getBatchSize), so alignment
+        // doesn't matter -- and reading ahead would mostly read frames that
+        // are skipped
+        decoderBatchAlignment = 1;
+        sourceVideo.setReadAhead(0);
+    }
 
     // Open the source video file
     if (!sourceVideo.open(inputFileName, videoParameters.fieldWidth * videoParameters.fieldHeight)) {
@@ -79,168 +157,611 @@ bool DecoderPool::process()
         }
     }
 
-    // Open the output file
-    if (outputFileName == "-") {
-        // No output filename, use stdout instead
-        if (!targetVideo.open(stdout, QIODevice::WriteOnly)) {
-            // Failed to open stdout
-            qCritical() << "Could not open stdout for output";
+    // Open the output files, and write their stream headers (if they have them)
+    outputFiles.clear();
+    frameHeaders.resize(outputs.size());
+    for (qint32 i = 0; i < outputs.size(); i++) {
+        const QString &outputFileName = outputs[i].fileName;
+        outputFiles.push_back(std::make_unique<OutputFile>());
+        OutputFile &outputFile = *outputFiles.back();
+
+        if (!outputFile.open(outputFileName, outputs[i].config.useVmsplice)) {
+            if (outputFileName == "-") {
+                qCritical() << "Could not open stdout for output";
+            } else {
+                qCritical() << "Could not open" << outputFileName << "for output";
+            }
             sourceVideo.close();
+            closeOutputs();
             return false;
         }
-        qInfo() << "Writing output to stdout";
-    } else {
-        // Open output file
-        targetVideo.setFileName(outputFileName);
-        if (!targetVideo.open(QIODevice::WriteOnly)) {
-            // Failed to open output file
-            qCritical() << "Could not open" << outputFileName << "for output";
+        if (outputFileName == "-") {
+            qInfo() << "Writing output to stdout";
+        }
+
+        const QByteArray streamHeader = outputWriters[i].getStreamHeader();
+        if (streamHeader.size() != 0 && !outputFile.write(streamHeader, QByteArray())) {
+            qCritical() << "Writing to the output video file failed";
             sourceVideo.close();
+            closeOutputs();
             return false;
         }
-    }
 
-    // Write the stream header (if there is one)
-    const QByteArray streamHeader = outputWriter.getStreamHeader();
-    if (streamHeader.size() != 0 && targetVideo.write(streamHeader) == -1) {
-        qCritical() << "Writing to the output video file failed";
-        return false;
+        frameHeaders[i] = outputWriters[i].getFrameHeader();
     }
 
     qInfo() << "Using" << maxThreads << "threads";
     qInfo() << "Processing from start frame #" << startFrame << "with a length of" << length << "frames";
+    if (frameStep != 1) {
+        qInfo() << "Decoding every" << frameStep << "frames";
+    }
 
     // Initialise processing state
+    const qint32 numOutputFrames = (length + frameStep - 1) / frameStep;
     inputFrameNumber = startFrame;
     outputFrameNumber = startFrame;
-    lastFrameNumber = length + (startFrame - 1);
+    outputFailed = false;
+    lastFrameNumber = numOutputFrames + (startFrame - 1);
+    inputFinished = false;
+    workers.clear();
+    costBatches = 0;
+    costSumFrames = 0;
+    costSumFramesSquared = 0;
+    costSumNsecs = 0;
+    costSumFramesNsecs = 0;
     totalTimer.start();
 
-    // Start a vector of filtering threads to process the video
+    // Size the output ring from a per-thread budget, and limit batches to
+    // each thread's share of it, so the memory used for pending output grows
+    // slowly with the thread count. (With few threads, the minimum ring size
+    // still allows full-size batches.)
+    outputRingSize = qMax(MIN_OUTPUT_RING_SIZE, maxThreads * OUTPUT_FRAMES_PER_THREAD);
+    maxBatchSize = qMin(MAX_BATCH_SIZE, outputRingSize / maxThreads);
+    maxBatchSize = qMax(decoderBatchAlignment, (maxBatchSize / decoderBatchAlignment) * decoderBatchAlignment);
+    outputRing.clear();
+    outputRing.resize(outputRingSize);
+    for (QVector<OutputFrame> &slotFrames : outputRing) {
+        slotFrames.resize(outputs.size());
+    }
+    outputRingFull.fill(false, outputRingSize);
+
+    // Start the thread to write the output
+    WriterThread writerThread(*this);
+    writerThread.start();
+
+    // Start a vector of filtering threads to process the video.
+    // (Each thread registers itself as a worker when it's made, so make them
+    // all before starting any of them.)
     QVector<QThread *> threads;
     threads.resize(maxThreads);
     for (qint32 i = 0; i < maxThreads; i++) {
         threads[i] = decoder.makeThread(abort, *this);
+    }
+    for (qint32 i = 0; i < maxThreads; i++) {
         threads[i]->start(QThread::LowPriority);
     }
 
+    // Load input for the workers until we reach the end
+    loadBatches();
+
     // Wait for the workers to finish
     for (qint32 i = 0; i < maxThreads; i++) {
         threads[i]->wait();
         delete threads[i];
     }
 
+    // Wait for the writer to finish
+    writerThread.wait();
+
     // Did any of the threads abort?
     if (abort) {
         sourceVideo.close();
-        targetVideo.close();
+        closeOutputs();
         return false;
     }
 
     // Check we've processed all the frames, now the workers have finished
-    if (inputFrameNumber != (lastFrameNumber + 1) || outputFrameNumber != (lastFrameNumber + 1)
-        || !pendingOutputFrames.empty()) {
+    if (inputFrameNumber != (lastFrameNumber + 1) || outputFrameNumber != (lastFrameNumber + 1)) {
         qCritical() << "Incorrect state at end of processing";
         sourceVideo.close();
-        targetVideo.close();
+        closeOutputs();
         return false;
     }
 
     double totalSecs = (static_cast<double>(totalTimer.elapsed()) / 1000.0);
-    qInfo() << "Processing complete -" << length << "frames in" << totalSecs << "seconds (" <<
-               length / totalSecs << "FPS )";
+    qInfo() << "Processing complete -" << numOutputFrames << "frames in" << totalSecs << "seconds (" <<
+               numOutputFrames / totalSecs << "FPS )";
+    printOutputStatistics(totalSecs);
+    printWorkerStatistics();
 
     // Close the source video
     sourceVideo.close();
 
-    // Close the target video
-    targetVideo.close();
+    // Close the output files
+    closeOutputs();
+
+    return true;
+}
+
+// If there's a region of interest, narrow the active area in videoParameters
+// to cover just that region.
+//
+// Returns true on success; if the region isn't within the active area, prints
+// a message and returns false.
+bool DecoderPool::setRegion(LdDecodeMetaData::VideoParameters &videoParameters) const
+{
+    if (region.isNull()) {
+        return true;
+    }
+
+    if (region.x() < videoParameters.activeVideoStart || region.x() + region.width() > videoParameters.activeVideoEnd
+        || region.y() < videoParameters.firstActiveFrameLine
+        || region.y() + region.height() > videoParameters.lastActiveFrameLine
+        || region.width() < 1 || region.height() < 1) {
+        qCritical() << "The region must be within the active area, which is samples"
+                    << videoParameters.activeVideoStart << "to" << videoParameters.activeVideoEnd
+                    << "of frame lines" << videoParameters.firstActiveFrameLine << "to"
+                    << videoParameters.lastActiveFrameLine;
+        return false;
+    }
+
+    videoParameters.activeVideoStart = region.x();
+    videoParameters.activeVideoEnd = region.x() + region.width();
+    videoParameters.firstActiveFrameLine = region.y();
+    videoParameters.lastActiveFrameLine = region.y() + region.height();
 
     return true;
 }
 
-bool DecoderPool::getInputFrames(qint32 &startFrameNumber, QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex)
+// Widen the range from start to end by margin either side, keeping start a
+// multiple of alignment from fullStart, but not going outside the range from
+// fullStart to fullEnd.
+static void addMargin(qint32 fullStart, qint32 fullEnd, qint32 margin, qint32 alignment, qint32 &start, qint32 &end)
 {
+    const qint32 alignedStart = fullStart + (((start - margin - fullStart) / alignment) * alignment);
+    start = qMin(start, qMax(alignedStart, fullStart));
+    end = qMax(end, qMin(end + margin, fullEnd));
+}
+
+// Widen the active area in videoParameters, which covers the region of
+// interest, by the margin the decoder needs around it -- but not beyond
+// fullVideoParameters, the area that would be decoded without a region.
+void DecoderPool::addRegionMargin(const LdDecodeMetaData::VideoParameters &fullVideoParameters,
+                                  LdDecodeMetaData::VideoParameters &videoParameters) const
+{
+    qint32 xMargin, yMargin, xAlignment, yAlignment;
+    decoder.getRegionMargin(xMargin, yMargin, xAlignment, yAlignment);
+
+    addMargin(fullVideoParameters.activeVideoStart, fullVideoParameters.activeVideoEnd, xMargin, xAlignment,
+              videoParameters.activeVideoStart, videoParameters.activeVideoEnd);
+    addMargin(fullVideoParameters.firstActiveFrameLine, fullVideoParameters.lastActiveFrameLine, yMargin, yAlignment,
+              videoParameters.firstActiveFrameLine, videoParameters.lastActiveFrameLine);
+}
+
+// Load batches of input frames for the worker threads, in order, until the
+// end of the input is reached.
+//
+// Each worker has a queue of batches that have been loaded for it. Loading
+// happens here, in the main thread, while the workers are decoding: as soon
+// as a worker takes a batch from its queue, the next batch is loaded for it.
+// Workers that run out of work steal batches from the others (see
+// getInputFrames), so the input is always read sequentially, but the work is
+// still shared evenly at the end.
+void DecoderPool::loadBatches()
+{
+    // Since the batches are loaded in order, keep a window of recent frames
+    // so each frame only needs to be read once
+    SourceField::Window inputWindow(sourceVideo, ldDecodeMetaData, decoderLookBehind, decoderLookAhead,
+                                    maxBatchSize);
+
     QMutexLocker locker(&inputMutex);
 
-    // Work out a reasonable batch size to provide work for all threads.
-    // This assumes that the synchronisation to get a new batch is less
-    // expensive than computing a single frame, so a batch size of 1 is
-    // reasonable.
-    const qint32 maxBatchSize = qMin(DEFAULT_BATCH_SIZE, qMax(1, length / maxThreads));
+    while (!abort && inputFrameNumber <= lastFrameNumber) {
+        // Wait until a worker has an empty queue.
+        // (Workers may set abort without waking us up, so don't wait forever.)
+        bool queuesFull = true;
+        for (const Worker &worker : workers) {
+            if (worker.queue.empty()) queuesFull = false;
+        }
+        if (queuesFull) {
+            batchTaken.wait(&inputMutex, 100);
+            continue;
+        }
 
-    // Work out how many frames will be in this batch
-    qint32 batchFrames = qMin(maxBatchSize, lastFrameNumber + 1 - inputFrameNumber);
-    if (batchFrames == 0) {
-        // No more input frames
-        return false;
+        // Allocate the next batch of frames
+        Batch batch;
+        batch.startFrameNumber = inputFrameNumber;
+        batch.numFrames = getBatchSize(lastFrameNumber + 1 - inputFrameNumber);
+        inputFrameNumber += batch.numFrames;
+
+        // Wait until there's space in the output ring for the batch's frames,
+        // then load the fields, allowing the workers to continue meanwhile
+        locker.unlock();
+        if (!waitForOutputSpace(batch.startFrameNumber + batch.numFrames)) {
+            locker.relock();
+            break;
+        }
+        loadFields(inputWindow, batch);
+        locker.relock();
+
+        // If the worker that was given the previous batch has room, give it
+        // this one too, so it can reuse the frames it decoded at the end of
+        // that batch as this one's lookbehind (see Comb and TransformPal3D).
+        // Otherwise, give the batch to the worker with the least work queued.
+        qint32 bestWorker = -1;
+        for (qint32 i = 0; i < workers.size(); i++) {
+            if (workers[i].nextFrameNumber == batch.startFrameNumber && workers[i].queue.size() < MAX_FOLLOW_QUEUE) {
+                bestWorker = i;
+            }
+        }
+        if (bestWorker == -1) {
+            bestWorker = 0;
+            for (qint32 i = 1; i < workers.size(); i++) {
+                if (workers[i].queuedFrames < workers[bestWorker].queuedFrames) bestWorker = i;
+            }
+        }
+        workers[bestWorker].queuedFrames += batch.numFrames;
+        workers[bestWorker].queue.append(batch);
+        workers[bestWorker].nextFrameNumber = batch.startFrameNumber + batch.numFrames;
+
+        batchQueued.wakeAll();
+    }
+
+    inputFinished = true;
+    batchQueued.wakeAll();
+}
+
+// Load the fields for a batch of frames
+void DecoderPool::loadFields(SourceField::Window &inputWindow, Batch &batch) const
+{
+    qint32 startIndex, endIndex;
+
+    if (frameStep == 1) {
+        inputWindow.loadFields(batch.startFrameNumber, batch.numFrames, batch.fields, startIndex, endIndex);
+        return;
     }
 
-    // Advance the frame number
-    startFrameNumber = inputFrameNumber;
-    inputFrameNumber += batchFrames;
+    // The input frames aren't contiguous, so load them one at a time. If the
+    // decoder needs lookbehind/lookahead, getBatchSize only gives us one frame.
+    batch.fields.clear();
+    QVector<SourceField> frameFields;
+    for (qint32 i = 0; i < batch.numFrames; i++) {
+        const qint32 inputFrame = startFrame + ((batch.startFrameNumber + i - startFrame) * frameStep);
+        inputWindow.loadFields(inputFrame, 1, frameFields, startIndex, endIndex);
+        batch.fields += frameFields;
+    }
+}
 
-    // Load the fields
-    SourceField::loadFields(sourceVideo, ldDecodeMetaData,
-                            startFrameNumber, batchFrames, decoderLookBehind, decoderLookAhead,
-                            fields, startIndex, endIndex);
+// Work out how many frames should be in the next batch, given the number of
+// frames that haven't been allocated yet. You must hold inputMutex to call
+// this.
+qint32 DecoderPool::getBatchSize(qint32 remainingFrames) const
+{
+    // With a frame step, neighbouring frames in a batch aren't neighbours in
+    // the input, so each frame needs its own lookbehind/lookahead
+    if (frameStep != 1 && (decoderLookBehind != 0 || decoderLookAhead != 0)) {
+        return 1;
+    }
 
-    return true;
+    // The decode times that workers report don't include the cost of
+    // scheduling a batch (queueing it, waking a worker, and collecting its
+    // output), so never use batches smaller than the default
+    qint32 batchSize = qMin(DEFAULT_BATCH_SIZE, maxBatchSize);
+
+    if (costBatches != 0) {
+        // Make the batch large enough that the decoder's per-batch overhead
+        // is a small fraction of the decoding time
+        double frameCost, batchCost;
+        estimateCosts(frameCost, batchCost);
+        const double minBatchSize = batchCost / (frameCost * MAX_BATCH_OVERHEAD);
+        batchSize = static_cast<qint32>(qBound(static_cast<double>(batchSize), std::ceil(minBatchSize),
+                                               static_cast<double>(maxBatchSize)));
+    }
+
+    // Towards the end of the input, use smaller batches, so all the threads
+    // still have work to do
+    const qint32 shareSize = (remainingFrames + (2 * maxThreads) - 1) / (2 * maxThreads);
+    batchSize = qMin(batchSize, shareSize);
+
+    // Round to a multiple of the decoder's alignment (but the last batch may
+    // be shorter)
+    batchSize = qMax(decoderBatchAlignment, (batchSize / decoderBatchAlignment) * decoderBatchAlignment);
+    return qMin(batchSize, remainingFrames);
 }
 
-bool DecoderPool::putOutputFrames(qint32 startFrameNumber, const QVector<OutputFrame> &outputFrames)
+// Estimate the decoder's cost (in nanoseconds) per frame, and its fixed cost
+// per batch, from the decoding times that the workers have reported. You must
+// hold inputMutex to call this.
+void DecoderPool::estimateCosts(double &frameCost, double &batchCost) const
 {
-    QMutexLocker locker(&outputMutex);
+    const double meanFrames = costSumFrames / costBatches;
+    const double meanNsecs = costSumNsecs / costBatches;
+    const double varianceFrames = (costSumFramesSquared / costBatches) - (meanFrames * meanFrames);
+
+    frameCost = 0;
+    if (varianceFrames > 0.25) {
+        // There's been enough variation in the batch sizes to fit a line
+        frameCost = ((costSumFramesNsecs / costBatches) - (meanFrames * meanNsecs)) / varianceFrames;
+        batchCost = meanNsecs - (frameCost * meanFrames);
+    }
+
+    if (frameCost <= 0 || batchCost < 0) {
+        // Assume that each lookbehind/lookahead frame costs as much as a
+        // frame in the batch
+        const qint32 overlapFrames = decoderLookBehind + decoderLookAhead;
+        frameCost = costSumNsecs / (costSumFrames + (costBatches * overlapFrames));
+        batchCost = frameCost * overlapFrames;
+    }
+}
+
+bool DecoderPool::getInputFrames(qint32 workerNumber, qint32 &startFrameNumber, QVector<SourceField> &fields,
+                                 qint32 &startIndex, qint32 &endIndex)
+{
+    QMutexLocker locker(&inputMutex);
+    Worker &worker = workers[workerNumber];
 
-    for (qint32 i = 0; i < outputFrames.size(); i++) {
-        if (!putOutputFrame(startFrameNumber + i, outputFrames[i])) {
+    QElapsedTimer idleTimer;
+    idleTimer.start();
+
+    Batch batch;
+    while (true) {
+        if (abort) {
             return false;
         }
+
+        if (!worker.queue.empty()) {
+            // Take the next batch from our own queue
+            batch = worker.queue.takeFirst();
+            worker.queuedFrames -= batch.numFrames;
+            break;
+        }
+
+        if (stealBatch(workerNumber, batch)) {
+            worker.steals++;
+            break;
+        }
+
+        if (inputFinished) {
+            // No more input frames
+            worker.idleNsecs += idleTimer.nsecsElapsed();
+            worker.finishNsecs = totalTimer.nsecsElapsed();
+            return false;
+        }
+
+        // Wait for the main thread to load some more input
+        batchQueued.wait(&inputMutex, 100);
     }
 
+    // Let the main thread know there's space in this worker's queue
+    batchTaken.wakeAll();
+
+    worker.idleNsecs += idleTimer.nsecsElapsed();
+    worker.frames += batch.numFrames;
+    worker.batches++;
+    if (batch.startFrameNumber == worker.takenEndFrameNumber) worker.follows++;
+    worker.takenEndFrameNumber = batch.startFrameNumber + batch.numFrames;
+
+    startFrameNumber = batch.startFrameNumber;
+    fields = std::move(batch.fields);
+    startIndex = 2 * decoderLookBehind;
+    endIndex = startIndex + (2 * batch.numFrames);
+
     return true;
 }
 
-// Write one output frame. You must hold outputMutex to call this.
+// Steal work for an idle worker from the worker with the most work queued.
+// If that worker has several batches queued, take the last one; otherwise,
+// take the second half of its batch. You must hold inputMutex to call this.
 //
-// The worker threads will complete frames in an arbitrary order, so we can't
-// just write the frames to the output file directly. Instead, we keep a map of
-// frames that haven't yet been written; when a new frame comes in, we check
-// whether we can now write some of them out.
+// Returns true if a batch was stolen, false if there was nothing to steal.
+bool DecoderPool::stealBatch(qint32 workerNumber, Batch &batch)
+{
+    qint32 victimNumber = -1;
+    for (qint32 i = 0; i < workers.size(); i++) {
+        if (i != workerNumber && workers[i].queuedFrames > 0
+            && (victimNumber == -1 || workers[i].queuedFrames > workers[victimNumber].queuedFrames)) {
+            victimNumber = i;
+        }
+    }
+    if (victimNumber == -1) return false;
+
+    Worker &victim = workers[victimNumber];
+    if (victim.queue.size() > 1) {
+        batch = victim.queue.takeLast();
+    } else {
+        Batch &victimBatch = victim.queue.first();
+        const qint32 keepFrames = ((victimBatch.numFrames / 2) / decoderBatchAlignment) * decoderBatchAlignment;
+        if (keepFrames == 0) {
+            // Too small to split, so take all of it
+            batch = victim.queue.takeFirst();
+        } else {
+            batch = splitBatch(victimBatch, keepFrames);
+        }
+    }
+    victim.queuedFrames -= batch.numFrames;
+
+    // The stolen frames were at the end of the victim's work
+    victim.nextFrameNumber = batch.startFrameNumber;
+    workers[workerNumber].nextFrameNumber = batch.startFrameNumber + batch.numFrames;
+
+    return true;
+}
+
+// Split a batch, leaving the first numFrames frames in batch and returning a
+// new batch containing the rest.
+DecoderPool::Batch DecoderPool::splitBatch(Batch &batch, qint32 numFrames) const
+{
+    const qint32 overlapFrames = decoderLookBehind + decoderLookAhead;
+
+    // Both parts' lookbehind/lookahead frames are already in the batch
+    Batch rest;
+    rest.startFrameNumber = batch.startFrameNumber + numFrames;
+    rest.numFrames = batch.numFrames - numFrames;
+    rest.fields = batch.fields.mid(2 * numFrames, 2 * (rest.numFrames + overlapFrames));
+
+    batch.numFrames = numFrames;
+    batch.fields.resize(2 * (numFrames + overlapFrames));
+
+    return rest;
+}
+
+void DecoderPool::reportDecodeTime(qint32 numFrames, qint64 decodeNsecs)
+{
+    QMutexLocker locker(&inputMutex);
+
+    costBatches++;
+    costSumFrames += numFrames;
+    costSumFramesSquared += static_cast<double>(numFrames) * numFrames;
+    costSumNsecs += decodeNsecs;
+    costSumFramesNsecs += static_cast<double>(numFrames) * decodeNsecs;
+}
+
+// Show how much work each worker did, and how much time it spent waiting for
+// input
+void DecoderPool::printWorkerStatistics() const
+{
+    for (qint32 i = 0; i < workers.size(); i++) {
+        const Worker &worker = workers[i];
+        const double busy = worker.finishNsecs == 0 ? 0.0
+                            : 100.0 * (worker.finishNsecs - worker.idleNsecs) / worker.finishNsecs;
+        qInfo().nospace() << "Thread " << i << ": " << worker.frames << " frames in " << worker.batches
+                          << " batches (" << worker.steals << " stolen, " << worker.follows << " following on), "
+                          << busy << "% busy";
+    }
+}
+
+// Wait until the output ring has free slots for all frames before
+// endFrameNumber. Workers can't get further ahead of the output than this,
+// because they can only decode frames that loadBatches has loaded.
 //
-// Returns true on success, false on failure.
-bool DecoderPool::putOutputFrame(qint32 frameNumber, const OutputFrame &outputFrame)
+// Returns true on success, false if processing has been aborted.
+bool DecoderPool::waitForOutputSpace(qint32 endFrameNumber)
 {
-    // Put this frame into the map
-    pendingOutputFrames[frameNumber] = outputFrame;
+    QMutexLocker locker(&outputMutex);
 
-    // Write out as many frames as possible
-    while (pendingOutputFrames.contains(outputFrameNumber)) {
-        const OutputFrame& outputData = pendingOutputFrames.value(outputFrameNumber);
+    while (endFrameNumber > outputFrameNumber + outputRingSize) {
+        if (abort) return false;
+        outputSpace.wait(&outputMutex, 100);
+    }
 
-        // Write the frame header (if there is one)
-        const QByteArray frameHeader = outputWriter.getFrameHeader();
-        if (frameHeader.size() != 0 && targetVideo.write(frameHeader) == -1) {
-            qCritical() << "Writing to the output video file failed";
-            return false;
+    return true;
+}
+
+bool DecoderPool::putOutputFrames(qint32 startFrameNumber, const QVector<QVector<OutputFrame>> &outputFrames)
+{
+    QMutexLocker locker(&outputMutex);
+
+    const qint32 numFrames = outputFrames[0].size();
+    for (qint32 i = 0; i < numFrames; i++) {
+        const qint32 frameNumber = startFrameNumber + i;
+        assert(frameNumber >= outputFrameNumber && frameNumber < outputFrameNumber + outputRingSize);
+
+        const qint32 slot = frameNumber % outputRingSize;
+        for (qint32 j = 0; j < outputFrames.size(); j++) {
+            outputRing[slot][j] = outputFrames[j][i];
         }
+        outputRingFull[slot] = true;
+    }
 
-        // Write the frame data
-        if (targetVideo.write(reinterpret_cast<const char *>(outputData.data()), outputData.size() * 2) == -1) {
-            qCritical() << "Writing to the output video file failed";
-            return false;
+    outputReady.wakeAll();
+
+    return !outputFailed;
+}
+
+// Write frames from the output ring to the output file, in order, until all
+// the frames have been written. This runs in its own thread, so the workers
+// don't need to wait for writes to complete.
+//
+// The worker threads will complete frames in an arbitrary order, so the
+// writer waits for each frame's slot in the ring to be filled in turn.
+void DecoderPool::runWriter()
+{
+    QMutexLocker locker(&outputMutex);
+
+    while (outputFrameNumber <= lastFrameNumber) {
+        const qint32 slot = outputFrameNumber % outputRingSize;
+        if (!outputRingFull[slot]) {
+            // Wait for the frame to be decoded.
+            // (Workers may set abort without waking us up, so don't wait forever.)
+            if (abort) break;
+            outputReady.wait(&outputMutex, 100);
+            continue;
+        }
+
+        // Take the frames out of the ring, and write them without holding the lock
+        QVector<OutputFrame> outputFrames(outputs.size());
+        for (qint32 i = 0; i < outputs.size(); i++) {
+            outputFrames[i] = std::move(outputRing[slot][i]);
+            outputRing[slot][i] = OutputFrame();
+        }
+        outputRingFull[slot] = false;
+
+        locker.unlock();
+        const bool success = writeOutputFrames(outputFrames);
+        locker.relock();
+
+        if (!success) {
+            outputFailed = true;
+            abort = true;
+            break;
         }
 
-        pendingOutputFrames.remove(outputFrameNumber);
         outputFrameNumber++;
+        outputSpace.wakeAll();
 
         const qint32 outputCount = outputFrameNumber - startFrame;
         if ((outputCount % 32) == 0) {
             // Show an update to the user
-            double fps = outputCount / (static_cast<double>(totalTimer.elapsed()) / 1000.0);
-            qInfo() << outputCount << "frames processed -" << fps << "FPS";
+            const double elapsedSecs = static_cast<double>(totalTimer.elapsed()) / 1000.0;
+            qint64 bytesWritten = 0;
+            for (const auto &outputFile : outputFiles) {
+                bytesWritten += outputFile->getBytesWritten();
+            }
+            qInfo() << outputCount << "frames processed -" << outputCount / elapsedSecs << "FPS,"
+                    << bytesWritten / (elapsedSecs * 1.0e6) << "MB/s";
+        }
+    }
+}
+
+// Write one frame to each of the output files.
+//
+// Returns true on success, false on failure.
+bool DecoderPool::writeOutputFrames(const QVector<OutputFrame> &outputFrames)
+{
+    for (qint32 i = 0; i < outputs.size(); i++) {
+        // Write the frame header (if there is one) and the frame data together
+        if (!outputFiles[i]->write(frameHeaders[i], outputFrames[i])) {
+            qCritical() << "Writing to the output video file" << outputs[i].fileName << "failed";
+            return false;
         }
     }
 
     return true;
 }
+
+// Show how fast each output was written, and how long the writer thread spent
+// waiting to write it. If it was waiting most of the time, then whatever's
+// reading the output (e.g. an encoder at the other end of a pipe) is the
+// bottleneck, not the decoder.
+void DecoderPool::printOutputStatistics(double totalSecs) const
+{
+    for (qint32 i = 0; i < outputs.size(); i++) {
+        const double megabytes = outputFiles[i]->getBytesWritten() / 1.0e6;
+        const double writeSecs = outputFiles[i]->getWriteNsecs() / 1.0e9;
+        QString name;
+        if (outputs.size() > 1) {
+            name = " " + (outputs[i].fileName == "-" ? QString("stdout") : outputs[i].fileName);
+        }
+        qInfo().nospace().noquote() << "Output" << name << ": " << megabytes << " MB at " << megabytes / totalSecs << " MB/s, "
+                          << "waiting for writes " << 100.0 * writeSecs / totalSecs << "% of the time";
+    }
+}
+
+// Close all the output files
+void DecoderPool::closeOutputs()
+{
+    for (auto &outputFile : outputFiles) {
+        outputFile->close();
+    }
+    outputFiles.clear();
+}
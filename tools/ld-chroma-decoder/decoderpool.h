@@ -28,41 +28,61 @@
 #include <QObject>
 #include <QAtomicInt>
 #include <QElapsedTimer>
-#include <QMap>
 #include <QMutex>
+#include <QRect>
 #include <QThread>
 #include <QVector>
+#include <QWaitCondition>
+#include <memory>
+#include <vector>
 
 #include "lddecodemetadata.h"
 #include "sourcevideo.h"
 
 #include "decoder.h"
+#include "outputfile.h"
 #include "outputwriter.h"
 #include "sourcefield.h"
 
 class DecoderPool
 {
 public:
+    // An output file, and the format to write to it
+    struct Output {
+        QString fileName;
+        OutputWriter::Configuration config;
+    };
+
+    // Each frame is decoded once, then converted and written to each of the outputs.
+    //
+    // Only every frameStep'th frame of the length frames from startFrame is
+    // decoded. If region isn't null, only that part of the active area (in
+    // samples and frame lines) is decoded and output.
     explicit DecoderPool(Decoder &decoder, QString inputFileName,
-                         LdDecodeMetaData &ldDecodeMetaData,
-                         OutputWriter::Configuration &outputConfig, QString outputFileName,
-                         qint32 startFrame, qint32 length, qint32 maxThreads);
+                         LdDecodeMetaData &ldDecodeMetaData, const QVector<Output> &outputs,
+                         qint32 startFrame, qint32 length, qint32 frameStep, const QRect &region,
+                         qint32 maxThreads);
 
     // Decode fields to frames as specified by the constructor args.
     // Returns true on success; on failure, prints a message and returns false.
     bool process();
 
-    // For worker threads: get the configured OutputWriter
-    OutputWriter &getOutputWriter() {
-        return outputWriter;
+    // For worker threads: get the configured OutputWriter for each output
+    const QVector<OutputWriter> &getOutputWriters() const {
+        return outputWriters;
     }
 
+    // For worker threads: register a new worker, returning its number.
+    // This must be called before process() starts the worker threads.
+    qint32 addWorker();
+
     // For worker threads: get the next batch of data from the input file.
     //
     // fields will be resized and filled with pairs of SourceFields; entries
     // from startIndex to endIndex are those that should be processed into
     // output frames, with startIndex corresponding to the first field of frame
-    // startFrameNumber.
+    // startFrameNumber. (Frame numbers count output frames; with a frame step,
+    // these aren't the same as input frames.)
     //
     // If the Decoder requested lookahead or lookbehind, an appropriate number
     // of additional fields will be provided before startIndex and after
@@ -71,50 +91,153 @@ public:
     //
     // Returns true if a frame was returned, false if the end of the input has
     // been reached.
-    bool getInputFrames(qint32 &startFrameNumber, QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex);
+    bool getInputFrames(qint32 workerNumber, qint32 &startFrameNumber, QVector<SourceField> &fields,
+                        qint32 &startIndex, qint32 &endIndex);
 
-    // For worker threads: return decoded frames to write to the output file.
+    // For worker threads: report that decoding a batch of numFrames frames
+    // took decodeNsecs nanoseconds, so future batches can be sized to suit
+    // the decoder.
+    void reportDecodeTime(qint32 numFrames, qint64 decodeNsecs);
+
+    // For worker threads: return decoded frames to write to the output files.
+    // The frames are written in order by a separate writer thread.
     //
-    // outputFrames should contain RGB48, YUV444P16, or GRAY16 output frames,
-    // with the first frame being startFrameNumber.
+    // outputFrames[i] should contain frames converted by the OutputWriter for
+    // output i, with the first frame being startFrameNumber.
     //
     // Returns true on success, false on failure.
-    bool putOutputFrames(qint32 startFrameNumber, const QVector<OutputFrame> &outputFrames);
+    bool putOutputFrames(qint32 startFrameNumber, const QVector<QVector<OutputFrame>> &outputFrames);
 
 private:
-    bool putOutputFrame(qint32 frameNumber, const OutputFrame &outputFrame);
-
-    // Default batch size, in frames
+    // A batch of input frames, loaded and ready to be decoded
+    struct Batch {
+        qint32 startFrameNumber;
+        qint32 numFrames;
+        // Fields for the frames, with lookbehind/lookahead, as for getInputFrames
+        QVector<SourceField> fields;
+    };
+
+    // Scheduling state for each worker thread
+    struct Worker {
+        // Batches that have been loaded for this worker, in frame order
+        QVector<Batch> queue;
+        qint32 queuedFrames = 0;
+
+        // The frame after the last batch given to this worker, and after the
+        // last batch it took (or -1 if none)
+        qint32 nextFrameNumber = -1;
+        qint32 takenEndFrameNumber = -1;
+
+        // Statistics
+        qint32 frames = 0;
+        qint32 batches = 0;
+        qint32 steals = 0;
+        qint32 follows = 0;
+        qint64 idleNsecs = 0;
+        qint64 finishNsecs = 0;
+    };
+
+    bool setRegion(LdDecodeMetaData::VideoParameters &videoParameters) const;
+    void addRegionMargin(const LdDecodeMetaData::VideoParameters &fullVideoParameters,
+                         LdDecodeMetaData::VideoParameters &videoParameters) const;
+    void loadBatches();
+    void loadFields(SourceField::Window &inputWindow, Batch &batch) const;
+    qint32 getBatchSize(qint32 remainingFrames) const;
+    void estimateCosts(double &frameCost, double &batchCost) const;
+    bool stealBatch(qint32 workerNumber, Batch &batch);
+    Batch splitBatch(Batch &batch, qint32 numFrames) const;
+    void printWorkerStatistics() const;
+    void printOutputStatistics(double totalSecs) const;
+    void closeOutputs();
+    bool waitForOutputSpace(qint32 endFrameNumber);
+    void runWriter();
+    bool writeOutputFrames(const QVector<OutputFrame> &outputFrames);
+
+    class WriterThread;
+
+    // Smallest batch size to use (apart from towards the end of the input),
+    // in frames; batches are made larger if the decoder's measured per-batch
+    // overhead needs it
     static constexpr qint32 DEFAULT_BATCH_SIZE = 16;
 
+    // Maximum batch size, in frames
+    static constexpr qint32 MAX_BATCH_SIZE = 32;
+
+    // A worker can have this many batches queued and still be given the batch
+    // that follows on from its last one
+    static constexpr qint32 MAX_FOLLOW_QUEUE = 2;
+
+    // The output ring holds this many frames per thread, but never fewer than
+    // MIN_OUTPUT_RING_SIZE frames
+    static constexpr qint32 OUTPUT_FRAMES_PER_THREAD = 8;
+    static constexpr qint32 MIN_OUTPUT_RING_SIZE = 2 * MAX_BATCH_SIZE;
+
+    // Batches are made large enough that the decoder's per-batch overhead
+    // (e.g. decoding the lookbehind/lookahead frames) is at most this
+    // fraction of the time spent decoding the batch's frames
+    static constexpr double MAX_BATCH_OVERHEAD = 0.1;
+
     // Parameters
     Decoder &decoder;
     QString inputFileName;
-    OutputWriter::Configuration outputConfig;
-    QString outputFileName;
+    QVector<Output> outputs;
     qint32 startFrame;
     qint32 length;
+    qint32 frameStep;
+    QRect region;
     qint32 maxThreads;
 
     // Atomic abort flag shared by worker threads; workers watch this, and shut
     // down as soon as possible if it becomes true
     QAtomicInt abort;
 
-    // Input stream information (all guarded by inputMutex while threads are running)
+    // Input stream information (all guarded by inputMutex while threads are
+    // running, apart from ldDecodeMetaData and sourceVideo, which are only
+    // used by loadBatches)
     QMutex inputMutex;
     qint32 decoderLookBehind;
     qint32 decoderLookAhead;
+    qint32 decoderBatchAlignment;
+    qint32 maxBatchSize;
     qint32 inputFrameNumber;
     qint32 lastFrameNumber;
+    bool inputFinished;
     LdDecodeMetaData &ldDecodeMetaData;
     SourceVideo sourceVideo;
 
-    // Output stream information (all guarded by outputMutex while threads are running)
+    // Scheduling state (guarded by inputMutex)
+    QVector<Worker> workers;
+    QWaitCondition batchQueued;
+    QWaitCondition batchTaken;
+
+    // Measured decoding costs, for a least-squares fit of the time taken to
+    // decode a batch against its size (guarded by inputMutex)
+    qint32 costBatches;
+    double costSumFrames;
+    double costSumFramesSquared;
+    double costSumNsecs;
+    double costSumFramesNsecs;
+
+    // Output stream information (all guarded by outputMutex while threads are
+    // running, apart from outputFiles, which are only used by the writer thread)
     QMutex outputMutex;
     qint32 outputFrameNumber;
-    QMap<qint32, OutputFrame> pendingOutputFrames;
-    OutputWriter outputWriter;
-    QFile targetVideo;
+    bool outputFailed;
+
+    // Ring of decoded frames waiting to be written (one per output), indexed
+    // by frame number modulo outputRingSize. loadBatches doesn't load any
+    // input frame until its slot is free, so the number of frames held here
+    // (and so the memory used) is bounded by the ring size.
+    QVector<QVector<OutputFrame>> outputRing;
+    QVector<bool> outputRingFull;
+    qint32 outputRingSize;
+    QWaitCondition outputReady;
+    QWaitCondition outputSpace;
+
+    // Writers, frame headers and files for each output
+    QVector<OutputWriter> outputWriters;
+    QVector<QByteArray> frameHeaders;
+    std::vector<std::unique_ptr<OutputFile>> outputFiles;
     QElapsedTimer totalTimer;
 };
 
@@ -29,6 +29,7 @@
 #include <QDebug>
 #include <QtGlobal>
 #include <QCommandLineParser>
+#include <QRect>
 #include <QThread>
 #include <fstream>
 #include <memory>
@@ -95,6 +96,79 @@ static bool loadTransformThresholds(QCommandLineParser &parser, QCommandLineOpti
     return true;
 }
 
+// Set the output format and pixel format in outputConfig, given their names
+// from the command line. If grayDefault is true, the default YUV pixel format is
+// GRAY16 rather than YUV444P16. Return false if either name isn't recognised,
+// or if a pixel format is given for RGB output.
+static bool setOutputFormat(const QString &outputFormatName, const QString &yuvFormatName, bool grayDefault,
+                            OutputWriter::Configuration &outputConfig)
+{
+    if (outputFormatName == "yuv" || outputFormatName == "y4m") {
+        outputConfig.outputY4m = (outputFormatName == "y4m");
+        if (yuvFormatName.isEmpty() || yuvFormatName == "yuv444p16") {
+            if (grayDefault) {
+                outputConfig.pixelFormat = OutputWriter::PixelFormat::GRAY16;
+            } else {
+                outputConfig.pixelFormat = OutputWriter::PixelFormat::YUV444P16;
+            }
+        } else if (yuvFormatName == "gray16") {
+            outputConfig.pixelFormat = OutputWriter::PixelFormat::GRAY16;
+        } else if (yuvFormatName == "yuv422p10") {
+            outputConfig.pixelFormat = OutputWriter::PixelFormat::YUV422P10;
+        } else if (yuvFormatName == "yuv420p10") {
+            outputConfig.pixelFormat = OutputWriter::PixelFormat::YUV420P10;
+        } else if (yuvFormatName == "yuv420p") {
+            outputConfig.pixelFormat = OutputWriter::PixelFormat::YUV420P;
+        } else {
+            qCritical() << "Unknown YUV pixel format" << yuvFormatName;
+            return false;
+        }
+    } else if (outputFormatName == "rgb") {
+        if (!yuvFormatName.isEmpty()) {
+            qCritical() << "Pixel format" << yuvFormatName << "can only be used with yuv or y4m output";
+            return false;
+        }
+        outputConfig.pixelFormat = OutputWriter::PixelFormat::RGB48;
+    } else {
+        qCritical() << "Unknown output format" << outputFormatName;
+        return false;
+    }
+
+    return true;
+}
+
+// Parse the value of an --extra-output option, FORMAT[,PIXFMT][,pad=N]:FILE,
+// into output. Return false if it isn't valid.
+static bool parseExtraOutput(const QString &spec, bool grayDefault, DecoderPool::Output &output)
+{
+    const qint32 colon = spec.indexOf(':');
+    if (colon <= 0 || colon == spec.size() - 1) {
+        qCritical() << "Extra output" << spec << "should be FORMAT[,PIXFMT][,pad=N]:FILE";
+        return false;
+    }
+    output.fileName = spec.mid(colon + 1);
+
+    const QStringList fields = spec.left(colon).split(',');
+    QString yuvFormatName;
+    for (qint32 i = 1; i < fields.size(); i++) {
+        if (fields[i].startsWith("pad=")) {
+            bool ok = false;
+            output.config.paddingAmount = fields[i].mid(4).toInt(&ok);
+            if (!ok || output.config.paddingAmount < 1 || output.config.paddingAmount > 32) {
+                qCritical() << "Invalid padding amount in extra output" << spec;
+                return false;
+            }
+        } else if (yuvFormatName.isEmpty()) {
+            yuvFormatName = fields[i];
+        } else {
+            qCritical() << "Extra output" << spec << "should be FORMAT[,PIXFMT][,pad=N]:FILE";
+            return false;
+        }
+    }
+
+    return setOutputFormat(fields[0], yuvFormatName, grayDefault, output.config);
+}
+
 int main(int argc, char *argv[])
 {
     //set 'binary mode' for stdin and stdout on windows
@@ -148,6 +222,18 @@ int main(int argc, char *argv[])
                                         QCoreApplication::translate("main", "number"));
     parser.addOption(lengthOption);
 
+    // Option to only decode some of the frames (--frame-step)
+    QCommandLineOption frameStepOption(QStringList() << "frame-step",
+                                        QCoreApplication::translate("main", "Only decode every Nth frame of those selected by --start and --length (default 1)"),
+                                        QCoreApplication::translate("main", "N"));
+    parser.addOption(frameStepOption);
+
+    // Option to only decode part of each frame (--region)
+    QCommandLineOption regionOption(QStringList() << "region",
+                                        QCoreApplication::translate("main", "Only decode and output this part of the active area, given as the first sample, first frame line, width and height (default whole active area)"),
+                                        QCoreApplication::translate("main", "x,y,width,height"));
+    parser.addOption(regionOption);
+
     // Option to reverse the field order (-r)
     QCommandLineOption setReverseOption(QStringList() << "r" << "reverse",
                                        QCoreApplication::translate("main", "Reverse the field order to second/first (default first/second)"));
@@ -171,6 +257,23 @@ int main(int argc, char *argv[])
                                        QCoreApplication::translate("main", "output-format"));
     parser.addOption(outputFormatOption);
 
+    // Option to select the pixel format for YUV output (--yuv-format)
+    QCommandLineOption yuvFormatOption(QStringList() << "yuv-format",
+                                       QCoreApplication::translate("main", "YUV output: pixel format (yuv444p16, gray16, yuv422p10, yuv420p10, yuv420p; default yuv444p16, or gray16 for mono)"),
+                                       QCoreApplication::translate("main", "pixel-format"));
+    parser.addOption(yuvFormatOption);
+
+    // Option to write additional outputs from the same decode (--extra-output)
+    QCommandLineOption extraOutputOption(QStringList() << "extra-output",
+                                       QCoreApplication::translate("main", "Also write the decoded video to FILE, in another format (e.g. y4m,yuv420p,pad=16:preview.y4m); may be given more than once"),
+                                       QCoreApplication::translate("main", "format:file"));
+    parser.addOption(extraOutputOption);
+
+    // Option to write to a pipe using vmsplice (--output-vmsplice)
+    QCommandLineOption outputVmspliceOption(QStringList() << "output-vmsplice",
+                                       QCoreApplication::translate("main", "When the output is a pipe (Linux only), map frames into the pipe rather than copying them"));
+    parser.addOption(outputVmspliceOption);
+
     // Option to set the black and white output flag (causes output to be black and white) (-b)
     QCommandLineOption setBwModeOption(QStringList() << "b" << "blackandwhite",
                                        QCoreApplication::translate("main", "Output in black and white"));
@@ -242,6 +345,11 @@ int main(int argc, char *argv[])
                                            QCoreApplication::translate("main", "NTSC: Adjust phase per-line using burst phase"));
     parser.addOption(ntscPhaseCompOption);
 
+    // Option to use single-precision arithmetic for NTSC
+    QCommandLineOption ntscFloatOption(QStringList() << "ntsc-float",
+                                       QCoreApplication::translate("main", "NTSC: Use faster single-precision arithmetic for chroma decoding"));
+    parser.addOption(ntscFloatOption);
+
     // -- PAL decoder options --
 
     // Option to use Simple PAL UV filter
@@ -261,6 +369,17 @@ int main(int argc, char *argv[])
                                                  QCoreApplication::translate("main", "file"));
     parser.addOption(transformThresholdsOption);
 
+    // Option to use single-precision FFTs for Transform PAL
+    QCommandLineOption transformFloatOption(QStringList() << "transform-float",
+                                            QCoreApplication::translate("main", "Transform: Use faster single-precision FFTs"));
+    parser.addOption(transformFloatOption);
+
+    // Option to select the FFTW planning effort for Transform PAL
+    QCommandLineOption fftwEffortOption(QStringList() << "fftw-effort",
+                                        QCoreApplication::translate("main", "Transform: FFTW planning effort (estimate, measure, patient; default measure)"),
+                                        QCoreApplication::translate("main", "effort"));
+    parser.addOption(fftwEffortOption);
+
     // Option to overlay the FFTs
     QCommandLineOption showFFTsOption(QStringList() << "show-ffts",
                                       QCoreApplication::translate("main", "Transform: Overlay the input and output FFTs"));
@@ -309,6 +428,8 @@ int main(int argc, char *argv[])
 
     qint32 startFrame = -1;
     qint32 length = -1;
+    qint32 frameStep = 1;
+    QRect region;
     qint32 maxThreads = QThread::idealThreadCount();
     PalColour::Configuration palConfig;
     Comb::Configuration combConfig;
@@ -334,6 +455,32 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (parser.isSet(frameStepOption)) {
+        frameStep = parser.value(frameStepOption).toInt();
+
+        if (frameStep < 1) {
+            // Quit with error
+            qCritical("Specified frame step must be at least 1");
+            return -1;
+        }
+    }
+
+    if (parser.isSet(regionOption)) {
+        const QStringList regionValues = parser.value(regionOption).split(',');
+        bool ok = (regionValues.size() == 4);
+        qint32 values[4] = {0, 0, 0, 0};
+        for (qint32 i = 0; ok && i < 4; i++) {
+            values[i] = regionValues[i].toInt(&ok);
+        }
+
+        if (!ok || values[2] < 1 || values[3] < 1) {
+            // Quit with error
+            qCritical("Specified region must be x,y,width,height, with a non-zero width and height");
+            return -1;
+        }
+        region = QRect(values[0], values[1], values[2], values[3]);
+    }
+
     if (parser.isSet(threadsOption)) {
         maxThreads = parser.value(threadsOption).toInt();
 
@@ -397,6 +544,10 @@ int main(int argc, char *argv[])
         combConfig.phaseCompensation = true;
     }
 
+    if (parser.isSet(ntscFloatOption)) {
+        combConfig.singlePrecision = true;
+    }
+
     if (parser.isSet(simplePALOption)) {
         palConfig.simplePAL = true;
     }
@@ -411,6 +562,26 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (parser.isSet(transformFloatOption)) {
+        palConfig.transformSinglePrecision = true;
+    }
+
+    if (parser.isSet(fftwEffortOption)) {
+        const QString effortName = parser.value(fftwEffortOption);
+
+        if (effortName == "estimate") {
+            palConfig.transformEffort = fftwEstimate;
+        } else if (effortName == "measure") {
+            palConfig.transformEffort = fftwMeasure;
+        } else if (effortName == "patient") {
+            palConfig.transformEffort = fftwPatient;
+        } else {
+            // Quit with error
+            qCritical() << "Unknown FFTW effort" << effortName;
+            return -1;
+        }
+    }
+
     LdDecodeMetaData::LineParameters lineParameters;
     if (parser.isSet(firstFieldLineOption)) {
         lineParameters.firstActiveFieldLine = parser.value(firstFieldLineOption).toInt();
@@ -434,9 +605,10 @@ int main(int argc, char *argv[])
         inputJsonFileName = parser.value(inputJsonOption);
     }
 
-    // Load the source video metadata
+    // Load the source video metadata. Only the fields being decoded are
+    // needed, so decode the field metadata lazily as it's used.
     LdDecodeMetaData metaData;
-    if (!metaData.read(inputJsonFileName)) {
+    if (!metaData.read(inputJsonFileName, true)) {
         qInfo() << "Unable to open ld-decode metadata file";
         return -1;
     }
@@ -514,22 +686,10 @@ int main(int argc, char *argv[])
     } else {
         outputFormatName = "rgb";
     }
-    if (outputFormatName == "yuv" || outputFormatName == "y4m") {
-        if (outputFormatName == "y4m") {
-            outputConfig.outputY4m = true;
-        }
-        if (bwMode || decoderName == "mono") {
-            outputConfig.pixelFormat = OutputWriter::PixelFormat::GRAY16;
-        } else {
-            outputConfig.pixelFormat = OutputWriter::PixelFormat::YUV444P16;
-        }
-    } else if (outputFormatName == "rgb") {
-        outputConfig.pixelFormat = OutputWriter::PixelFormat::RGB48;
-    } else {
-        qCritical() << "Unknown output format" << outputFormatName;
+    const bool grayDefault = bwMode || decoderName == "mono";
+    if (!setOutputFormat(outputFormatName, parser.value(yuvFormatOption), grayDefault, outputConfig)) {
         return -1;
     }
-
     if (parser.isSet(outputPaddingOption)) {
         outputConfig.paddingAmount = parser.value(outputPaddingOption).toInt();
         if (outputConfig.paddingAmount < 1 || outputConfig.paddingAmount > 32) {
@@ -537,9 +697,49 @@ int main(int argc, char *argv[])
             outputConfig.paddingAmount = 8;
         }
     }
-    
+
+    // Collect the outputs -- the main one, then any extras
+    QVector<DecoderPool::Output> outputs;
+    outputs.append({outputFileName, outputConfig});
+    for (const QString &spec : parser.values(extraOutputOption)) {
+        DecoderPool::Output extraOutput;
+        if (!parseExtraOutput(spec, grayDefault, extraOutput)) {
+            return -1;
+        }
+        outputs.append(extraOutput);
+    }
+
+    // Check the outputs don't overlap with each other or the input
+    qint32 stdoutCount = 0;
+    for (qint32 i = 0; i < outputs.size(); i++) {
+        const QString &fileName = outputs[i].fileName;
+        if (fileName == "-") {
+            stdoutCount++;
+            continue;
+        }
+        if (fileName == inputFileName) {
+            qCritical("Input and output files cannot be the same");
+            return -1;
+        }
+        for (qint32 j = 0; j < i; j++) {
+            if (outputs[j].fileName == fileName) {
+                qCritical() << "Output file" << fileName << "is specified more than once";
+                return -1;
+            }
+        }
+    }
+    if (stdoutCount > 1) {
+        qCritical("Only one output can be written to stdout");
+        return -1;
+    }
+
+    for (DecoderPool::Output &output : outputs) {
+        output.config.useVmsplice = parser.isSet(outputVmspliceOption);
+    }
+
     // Perform the processing
-    DecoderPool decoderPool(*decoder, inputFileName, metaData, outputConfig, outputFileName, startFrame, length, maxThreads);
+    DecoderPool decoderPool(*decoder, inputFileName, metaData, outputs, startFrame, length, frameStep, region,
+                            maxThreads);
     if (!decoderPool.process()) {
         return -1;
     }
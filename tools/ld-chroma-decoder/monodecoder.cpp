@@ -46,6 +46,11 @@ MonoThread::MonoThread(QAtomicInt& _abort, DecoderPool& _decoderPool,
 {
 }
 
+bool MonoThread::streamsLines() const
+{
+    return true;
+}
+
 void MonoThread::decodeFrames(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
                               QVector<ComponentFrame> &componentFrames)
 {
@@ -58,16 +63,19 @@ void MonoThread::decodeFrame(const SourceField &firstField, const SourceField &s
 {
     const LdDecodeMetaData::VideoParameters &videoParameters = config.videoParameters;
 
-    bool ignoreUV = decoderPool.getOutputWriter().getPixelFormat() == OutputWriter::PixelFormat::GRAY16;
+    bool ignoreUV = true;
+    for (const OutputWriter &outputWriter : decoderPool.getOutputWriters()) {
+        ignoreUV &= outputWriter.getPixelFormat() == OutputWriter::PixelFormat::GRAY16;
+    }
 
     // Initialise and clear the component frame
-    // Ignore UV if we're doing Grayscale output.
+    // Ignore UV if all the outputs are Grayscale.
     // TODO: Fix so we don't need U/V vectors for RGB and YUV output either.
     componentFrame.init(videoParameters, ignoreUV);
 
     // Interlace the active lines of the two input fields to produce a component frame
     for (qint32 y = videoParameters.firstActiveFrameLine; y < videoParameters.lastActiveFrameLine; y++) {
-        const SourceVideo::Data &inputFieldData = (y % 2) == 0 ? firstField.data : secondField.data;
+        const SourceVideo::DataView &inputFieldData = (y % 2) == 0 ? firstField.data : secondField.data;
         const quint16 *inputLine = inputFieldData.data() + ((y / 2) * videoParameters.fieldWidth);
 
         // Copy the whole composite signal to Y (leaving U and V blank)
@@ -75,5 +83,7 @@ void MonoThread::decodeFrame(const SourceField &firstField, const SourceField &s
         for (qint32 x = videoParameters.activeVideoStart; x < videoParameters.activeVideoEnd; x++) {
             outY[x] = inputLine[x];
         }
+
+        componentFrame.finishLine(y);
     }
 }
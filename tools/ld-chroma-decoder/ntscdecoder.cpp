@@ -55,6 +55,11 @@ qint32 NtscDecoder::getLookAhead() const
     return config.combConfig.getLookAhead();
 }
 
+void NtscDecoder::getRegionMargin(qint32 &xMargin, qint32 &yMargin, qint32 &xAlignment, qint32 &yAlignment) const
+{
+    config.combConfig.getRegionMargin(xMargin, yMargin, xAlignment, yAlignment);
+}
+
 QThread *NtscDecoder::makeThread(QAtomicInt& abort, DecoderPool& decoderPool)
 {
     return new NtscThread(abort, decoderPool, config);
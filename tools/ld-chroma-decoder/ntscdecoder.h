@@ -49,6 +49,7 @@ public:
     bool configure(const LdDecodeMetaData::VideoParameters &videoParameters) override;
     qint32 getLookBehind() const override;
     qint32 getLookAhead() const override;
+    void getRegionMargin(qint32 &xMargin, qint32 &yMargin, qint32 &xAlignment, qint32 &yAlignment) const override;
     QThread *makeThread(QAtomicInt& abort, DecoderPool& decoderPool) override;
 
     // Parameters used by NtscDecoder and NtscThread
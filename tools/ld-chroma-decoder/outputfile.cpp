@@ -0,0 +1,214 @@
+/************************************************************************
+
+    outputfile.cpp
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2026 agent
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "outputfile.h"
+
+#include <QDebug>
+#include <QThread>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+OutputFile::~OutputFile()
+{
+    close();
+}
+
+bool OutputFile::open(const QString &fileName, bool useVmsplice)
+{
+    if (fileName == "-") {
+        if (!file.open(stdout, QIODevice::WriteOnly)) {
+            return false;
+        }
+    } else {
+        file.setFileName(fileName);
+        if (!file.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+    }
+
+    isOpen = true;
+    splicing = false;
+    bytesWritten = 0;
+    writeNsecs = 0;
+
+#ifdef Q_OS_LINUX
+    struct stat st;
+    if (fstat(file.handle(), &st) == 0 && S_ISFIFO(st.st_mode)) {
+        // Make the pipe bigger, so the writer and reader don't need to take
+        // turns as often. It doesn't matter if this fails.
+        fcntl(file.handle(), F_SETPIPE_SZ, PIPE_SIZE);
+
+        splicing = useVmsplice;
+    } else if (useVmsplice) {
+        qInfo() << "Output is not a pipe; not using vmsplice";
+    }
+#else
+    if (useVmsplice) {
+        qInfo() << "vmsplice is not supported on this platform";
+    }
+#endif
+
+    return true;
+}
+
+void OutputFile::close()
+{
+    if (!isOpen) {
+        return;
+    }
+
+    // Don't free buffers the pipe still refers to
+    releaseSplicedBuffers(true);
+
+    file.close();
+    isOpen = false;
+}
+
+bool OutputFile::write(const QByteArray &header, const QByteArray &data)
+{
+    QElapsedTimer writeTimer;
+    writeTimer.start();
+
+    const bool success = writeAll(header, data);
+
+    writeNsecs += writeTimer.nsecsElapsed();
+    return success;
+}
+
+bool OutputFile::writeAll(const QByteArray &header, const QByteArray &data)
+{
+#ifdef Q_OS_UNIX
+    struct iovec iov[2];
+    qint32 iovCount = 0;
+    if (header.size() != 0) {
+        iov[iovCount].iov_base = const_cast<char *>(header.constData());
+        iov[iovCount].iov_len = header.size();
+        iovCount++;
+    }
+    if (data.size() != 0) {
+        iov[iovCount].iov_base = const_cast<char *>(data.constData());
+        iov[iovCount].iov_len = data.size();
+        iovCount++;
+    }
+
+    struct iovec *nextIov = iov;
+    while (iovCount > 0) {
+        ssize_t count;
+#ifdef Q_OS_LINUX
+        if (splicing) {
+            count = vmsplice(file.handle(), nextIov, iovCount, 0);
+        } else
+#endif
+        {
+            count = writev(file.handle(), nextIov, iovCount);
+        }
+
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytesWritten += count;
+
+        // Skip over the data that has been written
+        while (iovCount > 0 && static_cast<size_t>(count) >= nextIov->iov_len) {
+            count -= nextIov->iov_len;
+            nextIov++;
+            iovCount--;
+        }
+        if (iovCount > 0) {
+            nextIov->iov_base = static_cast<char *>(nextIov->iov_base) + count;
+            nextIov->iov_len -= count;
+        }
+    }
+
+    if (splicing) {
+        // Keep the buffers until the reader has consumed them
+        splicedBuffers.append(SplicedBuffer {header, bytesWritten - data.size()});
+        splicedBuffers.append(SplicedBuffer {data, bytesWritten});
+        releaseSplicedBuffers(false);
+    }
+
+    return true;
+#else
+    if (header.size() != 0) {
+        if (file.write(header) == -1) {
+            return false;
+        }
+        bytesWritten += header.size();
+    }
+    if (file.write(data) == -1) {
+        return false;
+    }
+    bytesWritten += data.size();
+
+    return true;
+#endif
+}
+
+// Drop references to buffers that the pipe's reader has consumed. If
+// waitForReader is true, wait until it has consumed all of them.
+void OutputFile::releaseSplicedBuffers(bool waitForReader)
+{
+#ifdef Q_OS_LINUX
+    while (!splicedBuffers.isEmpty()) {
+        // Find out how much data is still in the pipe
+        int unread = 0;
+        if (ioctl(file.handle(), FIONREAD, &unread) != 0) {
+            // We can't tell, so assume the worst -- the buffers will be
+            // freed when we exit, after which the reader can't see them change
+            return;
+        }
+
+        const qint64 consumed = bytesWritten - unread;
+        while (!splicedBuffers.isEmpty() && splicedBuffers.first().endOffset <= consumed) {
+            splicedBuffers.removeFirst();
+        }
+
+        if (!waitForReader || splicedBuffers.isEmpty()) {
+            return;
+        }
+
+        // Give up if the reader has gone away
+        struct pollfd pfd = {file.handle(), 0, 0};
+        if (poll(&pfd, 1, 0) < 0 || (pfd.revents & POLLERR) != 0) {
+            return;
+        }
+        QThread::msleep(1);
+    }
+#else
+    Q_UNUSED(waitForReader);
+#endif
+}
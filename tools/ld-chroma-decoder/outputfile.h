@@ -0,0 +1,96 @@
+/************************************************************************
+
+    outputfile.h
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2026 agent
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef OUTPUTFILE_H
+#define OUTPUTFILE_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+// The file (or pipe) that decoded frames are written to.
+//
+// Each write passes a header and a body to the OS in a single call (with
+// writev, where available), so y4m frames don't need an extra system call
+// for the header or an extra copy to join them.
+//
+// On Linux, if the output is a pipe and vmsplice is enabled, the data is
+// mapped into the pipe rather than copied into it. The pipe then refers to
+// our memory until the reader has consumed it, so OutputFile keeps a
+// reference to each buffer it has written until then. (This relies on
+// QByteArray's copy-on-write: anyone who modifies a buffer that OutputFile
+// still refers to gets a new copy.)
+class OutputFile
+{
+public:
+    OutputFile() = default;
+    ~OutputFile();
+
+    // Open the output file, or stdout if fileName is "-".
+    // Returns true on success, false on failure.
+    bool open(const QString &fileName, bool useVmsplice);
+
+    // Close the file. If data is still waiting in a pipe, this waits until
+    // the reader has consumed it.
+    void close();
+
+    // Write header (which may be empty), followed by data.
+    // Returns true on success, false on failure.
+    bool write(const QByteArray &header, const QByteArray &data);
+
+    // Statistics: total bytes written, and time spent waiting for writes
+    qint64 getBytesWritten() const {
+        return bytesWritten;
+    }
+    qint64 getWriteNsecs() const {
+        return writeNsecs;
+    }
+
+private:
+    // Size to make the pipe buffer, if the output is a pipe (1 MiB is the
+    // largest that Linux allows unprivileged processes by default)
+    static constexpr qint32 PIPE_SIZE = 1024 * 1024;
+
+    QFile file;
+    bool isOpen = false;
+    bool splicing = false;
+    qint64 bytesWritten = 0;
+    qint64 writeNsecs = 0;
+
+    // Buffers that have been spliced into the pipe, and the value of
+    // bytesWritten after each of them, oldest first
+    struct SplicedBuffer {
+        QByteArray data;
+        qint64 endOffset;
+    };
+    QVector<SplicedBuffer> splicedBuffers;
+
+    bool writeAll(const QByteArray &header, const QByteArray &data);
+    void releaseSplicedBuffers(bool waitForReader);
+};
+
+#endif // OUTPUTFILE_H
@@ -27,6 +27,9 @@
 #include "outputwriter.h"
 
 #include "componentframe.h"
+#include "simddispatch.h"
+
+#include <numeric>
 
 // Limits, zero points and scaling factors (from 0-1) for Y'CbCr colour representations
 // [Poynton ch25 p305] [BT.601-7 sec 2.5.3]
@@ -50,6 +53,70 @@ static constexpr double ONE_MINUS_Kr = 1.0 - 0.299;
 static constexpr double kB = 0.49211104112248356308804691718185;
 static constexpr double kR = 0.87728321993817866838972487283129;
 
+namespace {
+    // Scale, offset, round and limit a line of samples.
+    //
+    // The SIMD versions of these use the same operations in the same order
+    // (without fused multiply-add), so the output is the same on every CPU.
+    template <typename T>
+    Q_ALWAYS_INLINE void quantiseKernel(const double *in, double scale, double offset,
+                                        double minValue, double maxValue, T *out, qint32 count)
+    {
+        for (qint32 i = 0; i < count; i++) {
+            out[i] = static_cast<T>(qBound(minValue, (in[i] * scale) + offset, maxValue) + 0.5);
+        }
+    }
+
+    // Filter and subsample a line of chroma horizontally, producing a sample
+    // co-sited with every other input sample [BT.601-7 sec 2.4]. in[-1] and
+    // in[2 * count] must be valid.
+    Q_ALWAYS_INLINE void subsampleKernel(const double *in, double scale, double *__restrict out, qint32 count)
+    {
+        for (qint32 i = 0; i < count; i++) {
+            out[i] = (in[(2 * i) - 1] + (2.0 * in[2 * i]) + in[(2 * i) + 1]) * (scale / 4.0);
+        }
+    }
+
+    // Combine three lines of chroma vertically, then quantise the result
+    template <typename T>
+    Q_ALWAYS_INLINE void verticalKernel(const double *in0, const double *in1, const double *in2,
+                                        double w0, double w1, double w2, double offset,
+                                        double minValue, double maxValue, T *out, qint32 count)
+    {
+        for (qint32 i = 0; i < count; i++) {
+            const double value = (in0[i] * w0) + (in1[i] * w1) + (in2[i] * w2);
+            out[i] = static_cast<T>(qBound(minValue, value + offset, maxValue) + 0.5);
+        }
+    }
+
+    SIMD_DISPATCH_EXACT void quantise(const double *in, double scale, double offset,
+                                      double minValue, double maxValue, quint8 *out, qint32 count)
+    {
+        quantiseKernel(in, scale, offset, minValue, maxValue, out, count);
+    }
+    SIMD_DISPATCH_EXACT void quantise(const double *in, double scale, double offset,
+                                      double minValue, double maxValue, quint16 *out, qint32 count)
+    {
+        quantiseKernel(in, scale, offset, minValue, maxValue, out, count);
+    }
+    SIMD_DISPATCH_EXACT void subsample(const double *in, double scale, double *out, qint32 count)
+    {
+        subsampleKernel(in, scale, out, count);
+    }
+    SIMD_DISPATCH_EXACT void vertical(const double *in0, const double *in1, const double *in2,
+                                      double w0, double w1, double w2, double offset,
+                                      double minValue, double maxValue, quint8 *out, qint32 count)
+    {
+        verticalKernel(in0, in1, in2, w0, w1, w2, offset, minValue, maxValue, out, count);
+    }
+    SIMD_DISPATCH_EXACT void vertical(const double *in0, const double *in1, const double *in2,
+                                      double w0, double w1, double w2, double offset,
+                                      double minValue, double maxValue, quint16 *out, qint32 count)
+    {
+        verticalKernel(in0, in1, in2, w0, w1, w2, offset, minValue, maxValue, out, count);
+    }
+}
+
 void OutputWriter::updateConfiguration(LdDecodeMetaData::VideoParameters &_videoParameters,
                                        const OutputWriter::Configuration &_config)
 {
@@ -62,14 +129,43 @@ void OutputWriter::updateConfiguration(LdDecodeMetaData::VideoParameters &_video
     activeHeight = videoParameters.lastActiveFrameLine - videoParameters.firstActiveFrameLine;
     outputHeight = activeHeight;
 
-    if (config.paddingAmount > 1) {
+    switch (config.pixelFormat) {
+    case YUV422P10:
+        sampleBits = 10;
+        chromaXSub = 2;
+        chromaYSub = 1;
+        break;
+    case YUV420P10:
+        sampleBits = 10;
+        chromaXSub = 2;
+        chromaYSub = 2;
+        break;
+    case YUV420P:
+        sampleBits = 8;
+        chromaXSub = 2;
+        chromaYSub = 2;
+        break;
+    default:
+        sampleBits = 16;
+        chromaXSub = 1;
+        chromaYSub = 1;
+        break;
+    }
+
+    // Subsampled formats need the width to be a multiple of the subsampling
+    // factor. For 4:2:0, each field's height must be even too, since chroma
+    // is subsampled within each field.
+    const qint32 widthMultiple = std::lcm(qMax(config.paddingAmount, 1), chromaXSub);
+    const qint32 heightMultiple = std::lcm(qMax(config.paddingAmount, 1), (chromaYSub == 2) ? 4 : 1);
+
+    if (widthMultiple > 1 || heightMultiple > 1) {
         // Some video codecs require the width and height of a video to be divisible by
         // a given number of samples on each axis.
         
         // Expand horizontal active region so the width is divisible by the specified padding factor.
         while (true) {
             activeWidth = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
-            if ((activeWidth % config.paddingAmount) == 0) {
+            if ((activeWidth % widthMultiple) == 0) {
                 break;
             }
 
@@ -84,7 +180,7 @@ void OutputWriter::updateConfiguration(LdDecodeMetaData::VideoParameters &_video
         // Insert empty padding lines so the height is divisible by by the specified padding factor.
         while (true) {
             outputHeight = topPadLines + activeHeight + bottomPadLines;
-            if ((outputHeight % config.paddingAmount) == 0) {
+            if ((outputHeight % heightMultiple) == 0) {
                 break;
             }
 
@@ -99,6 +195,25 @@ void OutputWriter::updateConfiguration(LdDecodeMetaData::VideoParameters &_video
         // Update the caller's copy, now we've adjusted the active area
         _videoParameters = videoParameters;
     }
+
+    chromaWidth = activeWidth / chromaXSub;
+    chromaHeight = outputHeight / chromaYSub;
+
+    // Y'CbCr limits and zero points for the subsampled formats' sample size.
+    // The lowest and highest codes are reserved [BT.601-7 sec 2.5.3].
+    const double divisor = static_cast<double>(1 << (16 - sampleBits));
+    subsampledScaling.minValue = static_cast<double>(1 << (sampleBits - 8));
+    subsampledScaling.maxValue = static_cast<double>((255 << (sampleBits - 8)) - 1);
+    subsampledScaling.yZero = Y_ZERO / divisor;
+    subsampledScaling.cZero = C_ZERO / divisor;
+
+    // Convert Y'UV to Y'CbCr [Poynton eq 25.5 p307]
+    const double yRange = videoParameters.white16bIre - videoParameters.black16bIre;
+    const double uvRange = yRange;
+    subsampledScaling.yOffset = videoParameters.black16bIre;
+    subsampledScaling.yScale = (Y_SCALE / yRange) / divisor;
+    subsampledScaling.cbScale = ((C_SCALE / (ONE_MINUS_Kb * kB)) / uvRange) / divisor;
+    subsampledScaling.crScale = ((C_SCALE / (ONE_MINUS_Kr * kR)) / uvRange) / divisor;
 }
 
 const char *OutputWriter::getPixelName() const
@@ -110,6 +225,12 @@ const char *OutputWriter::getPixelName() const
         return "YUV444P16";
     case GRAY16:
         return "GRAY16";
+    case YUV422P10:
+        return "YUV422P10";
+    case YUV420P10:
+        return "YUV420P10";
+    case YUV420P:
+        return "YUV420P";
     default:
         return "unknown";
     }
@@ -179,6 +300,15 @@ QByteArray OutputWriter::getStreamHeader() const
     case GRAY16:
         str << " Cmono16 XCOLORRANGE=LIMITED";
         break;
+    case YUV422P10:
+        str << " C422p10 XCOLORRANGE=LIMITED";
+        break;
+    case YUV420P10:
+        str << " C420p10 XCOLORRANGE=LIMITED";
+        break;
+    case YUV420P:
+        str << " C420mpeg2 XCOLORRANGE=LIMITED";
+        break;
     default:
         qFatal("pixel format not supported in yuv4mpeg header");
         break;
@@ -200,34 +330,195 @@ QByteArray OutputWriter::getFrameHeader() const
 
 void OutputWriter::convert(const ComponentFrame &componentFrame, OutputFrame &outputFrame) const
 {
+    // Pass the active lines through a LineConverter, just as a decoder that
+    // streams its output would
+    LineConverter converter;
+    converter.begin(*this, outputFrame);
+
+    for (qint32 line = videoParameters.firstActiveFrameLine; line < videoParameters.lastActiveFrameLine; line++) {
+        // U and V are not used if output is GRAY16
+        const bool useUV = (config.pixelFormat != GRAY16);
+        converter.putLine(line, componentFrame.y(line), useUV ? componentFrame.u(line) : nullptr,
+                          useUV ? componentFrame.v(line) : nullptr);
+    }
+
+    converter.finish();
+}
+
+void OutputWriter::LineConverter::begin(const OutputWriter &_writer, OutputFrame &_outputFrame)
+{
+    writer = &_writer;
+    outputFrame = &_outputFrame;
+
     // Work out the number of output values, and resize the vector accordingly
-    qint32 totalSize = activeWidth * outputHeight;
-    switch (config.pixelFormat) {
+    const qint32 sampleBytes = (writer->sampleBits + 7) / 8;
+    qint32 totalSize = writer->activeWidth * writer->outputHeight;
+    switch (writer->config.pixelFormat) {
     case RGB48:
     case YUV444P16:
         totalSize *= 3;
         break;
     case GRAY16:
         break;
+    case YUV422P10:
+    case YUV420P10:
+    case YUV420P:
+        totalSize += 2 * writer->chromaWidth * writer->chromaHeight;
+        break;
     }
-    outputFrame.resize(totalSize);
+    outputFrame->resize(totalSize * sampleBytes);
 
     // Clear padding
-    clearPadLines(0, topPadLines, outputFrame);
-    clearPadLines(outputHeight - bottomPadLines, bottomPadLines, outputFrame);
+    switch (writer->config.pixelFormat) {
+    case YUV422P10:
+    case YUV420P10:
+        writer->clearSubsampledPadLines(reinterpret_cast<quint16 *>(outputFrame->data()));
+        break;
+    case YUV420P:
+        writer->clearSubsampledPadLines(reinterpret_cast<quint8 *>(outputFrame->data()));
+        break;
+    default: {
+        quint16 *outputData = reinterpret_cast<quint16 *>(outputFrame->data());
+        writer->clearPadLines(0, writer->topPadLines, outputData);
+        writer->clearPadLines(writer->outputHeight - writer->bottomPadLines, writer->bottomPadLines, outputData);
+        return;
+    }
+    }
+
+    cbLine.resize(writer->chromaWidth);
+    crLine.resize(writer->chromaWidth);
 
-    // Convert active lines
-    for (qint32 y = 0; y < activeHeight; y++) {
-        convertLine(y, componentFrame, outputFrame);
+    if (writer->chromaYSub == 2) {
+        chromaWindow.resize(2 * 4 * 2 * writer->chromaWidth);
+        nextFieldLine[0] = 0;
+        nextFieldLine[1] = 0;
     }
 }
 
-void OutputWriter::clearPadLines(qint32 firstLine, qint32 numLines, OutputFrame &outputFrame) const
+void OutputWriter::LineConverter::putLine(qint32 line, const double *y, const double *u, const double *v)
+{
+    const qint32 lineNumber = line - writer->videoParameters.firstActiveFrameLine;
+    if (lineNumber < 0 || lineNumber >= writer->activeHeight) {
+        return;
+    }
+
+    switch (writer->config.pixelFormat) {
+    case YUV422P10:
+    case YUV420P10:
+        writer->convertSubsampledLine(lineNumber, y, u, v, cbLine.data(), crLine.data(),
+                                      reinterpret_cast<quint16 *>(outputFrame->data()));
+        break;
+    case YUV420P:
+        writer->convertSubsampledLine(lineNumber, y, u, v, cbLine.data(), crLine.data(),
+                                      reinterpret_cast<quint8 *>(outputFrame->data()));
+        break;
+    default:
+        writer->convertLine(lineNumber, y, u, v, reinterpret_cast<quint16 *>(outputFrame->data()));
+        return;
+    }
+
+    if (writer->chromaYSub == 2) {
+        const qint32 outputLine = writer->topPadLines + lineNumber;
+        putChromaLine(outputLine % 2, outputLine / 2, cbLine.constData(), crLine.constData());
+    }
+}
+
+void OutputWriter::LineConverter::finish()
+{
+    if (writer->chromaYSub == 2) {
+        // Complete both fields with padding
+        const qint32 lastFieldLine = (writer->outputHeight / 2) - 1;
+        for (qint32 field = 0; field < 2; field++) {
+            if (nextFieldLine[field] <= lastFieldLine) {
+                putChromaLine(field, lastFieldLine, nullptr, nullptr);
+            }
+        }
+    }
+
+    writer = nullptr;
+    outputFrame = nullptr;
+}
+
+// 4:2:0 -- subsample each field vertically, since the fields are from
+// different times. Each chroma line comes from a pair of lines in one field,
+// and is sited 1/4 of the way between them in the first field and 3/4 of the
+// way in the second [MPEG-2 sec 6.1.1.8]. The filters are a two-line average,
+// interpolated linearly to that position, so each chroma line can be
+// converted as soon as the line after the pair has arrived.
+void OutputWriter::LineConverter::putChromaLine(qint32 field, qint32 fieldLine, const double *cb, const double *cr)
+{
+    assert(fieldLine >= nextFieldLine[field]);
+    const qint32 chromaWidth = writer->chromaWidth;
+    const qint32 lastFieldLine = (writer->outputHeight / 2) - 1;
+
+    while (nextFieldLine[field] <= fieldLine) {
+        // Store the line, or no chroma for padding lines we've skipped over
+        const qint32 k = nextFieldLine[field]++;
+        double *cbOut = windowLine(field, k, 0);
+        double *crOut = windowLine(field, k, 1);
+        for (qint32 x = 0; x < chromaWidth; x++) {
+            cbOut[x] = (k == fieldLine && cb != nullptr) ? cb[x] : 0.0;
+            crOut[x] = (k == fieldLine && cr != nullptr) ? cr[x] : 0.0;
+        }
+
+        // Work out which chroma line (if any) is now complete, and the lines
+        // from this field it's made from. At the edges, repeat the nearest
+        // line in the field.
+        qint32 chromaLine, lines[3];
+        double weights[3];
+        if (field == 0 && (k % 2) == 1) {
+            chromaLine = k - 1;
+            lines[0] = qMax(k - 2, 0);
+            lines[1] = k - 1;
+            lines[2] = k;
+            weights[0] = 1.0 / 8.0;
+            weights[1] = 4.0 / 8.0;
+            weights[2] = 3.0 / 8.0;
+        } else if (field == 1 && ((k % 2) == 0 && k >= 2)) {
+            chromaLine = k - 1;
+            lines[0] = k - 2;
+            lines[1] = k - 1;
+            lines[2] = k;
+            weights[0] = 3.0 / 8.0;
+            weights[1] = 4.0 / 8.0;
+            weights[2] = 1.0 / 8.0;
+        } else if (field == 1 && k == lastFieldLine) {
+            chromaLine = k;
+            lines[0] = k - 1;
+            lines[1] = k;
+            lines[2] = k;
+            weights[0] = 3.0 / 8.0;
+            weights[1] = 4.0 / 8.0;
+            weights[2] = 1.0 / 8.0;
+        } else {
+            continue;
+        }
+
+        const double *cb0 = windowLine(field, lines[0], 0), *cb1 = windowLine(field, lines[1], 0);
+        const double *cb2 = windowLine(field, lines[2], 0);
+        const double *cr0 = windowLine(field, lines[0], 1), *cr1 = windowLine(field, lines[1], 1);
+        const double *cr2 = windowLine(field, lines[2], 1);
+        if (writer->sampleBits == 8) {
+            writer->convertChromaLine(chromaLine, cb0, cb1, cb2, cr0, cr1, cr2, weights[0], weights[1], weights[2],
+                                      reinterpret_cast<quint8 *>(outputFrame->data()));
+        } else {
+            writer->convertChromaLine(chromaLine, cb0, cb1, cb2, cr0, cr1, cr2, weights[0], weights[1], weights[2],
+                                      reinterpret_cast<quint16 *>(outputFrame->data()));
+        }
+    }
+}
+
+double *OutputWriter::LineConverter::windowLine(qint32 field, qint32 fieldLine, qint32 plane)
+{
+    return chromaWindow.data() + (((((field * 4) + (fieldLine % 4)) * 2) + plane) * writer->chromaWidth);
+}
+
+void OutputWriter::clearPadLines(qint32 firstLine, qint32 numLines, quint16 *outputData) const
 {
     switch (config.pixelFormat) {
         case RGB48: {
             // Fill with RGB black
-            quint16 *out = outputFrame.data() + (activeWidth * firstLine * 3);
+            quint16 *out = outputData + (activeWidth * firstLine * 3);
 
             for (qint32 i = 0; i < numLines * activeWidth * 3; i++) {
                 out[i] = 0;
@@ -237,7 +528,7 @@ void OutputWriter::clearPadLines(qint32 firstLine, qint32 numLines, OutputFrame
         }
         case YUV444P16: {
             // Fill Y with black, no chroma
-            quint16 *outY  = outputFrame.data() + (activeWidth * firstLine);
+            quint16 *outY  = outputData + (activeWidth * firstLine);
             quint16 *outCB = outY + (activeWidth * outputHeight);
             quint16 *outCR = outCB + (activeWidth * outputHeight);
 
@@ -251,7 +542,7 @@ void OutputWriter::clearPadLines(qint32 firstLine, qint32 numLines, OutputFrame
         }
         case GRAY16: {
             // Fill with black
-            quint16 *out = outputFrame.data() + (activeWidth * firstLine);
+            quint16 *out = outputData + (activeWidth * firstLine);
 
             for (qint32 i = 0; i < numLines * activeWidth; i++) {
                 out[i] = static_cast<quint16>(Y_ZERO);
@@ -259,19 +550,21 @@ void OutputWriter::clearPadLines(qint32 firstLine, qint32 numLines, OutputFrame
 
             break;
         }
+        default:
+            // Subsampled formats are handled by the *Subsampled* functions
+            break;
     }
 }
 
-void OutputWriter::convertLine(qint32 lineNumber, const ComponentFrame &componentFrame, OutputFrame &outputFrame) const
+void OutputWriter::convertLine(qint32 lineNumber, const double *inY, const double *inU, const double *inV,
+                               quint16 *outputData) const
 {
-    // Get pointers to the component data for the active region
-    const qint32 inputLine = videoParameters.firstActiveFrameLine + lineNumber;
-    const double *inY = componentFrame.y(inputLine) + videoParameters.activeVideoStart;
-    // Not used if output is GRAY16
-    const double *inU = (config.pixelFormat != GRAY16) ?
-                            componentFrame.u(inputLine) + videoParameters.activeVideoStart : nullptr;
-    const double *inV = (config.pixelFormat != GRAY16) ?
-                            componentFrame.v(inputLine) + videoParameters.activeVideoStart : nullptr;
+    // Move to the active region (U and V are not used if output is GRAY16)
+    inY += videoParameters.activeVideoStart;
+    if (config.pixelFormat != GRAY16) {
+        inU += videoParameters.activeVideoStart;
+        inV += videoParameters.activeVideoStart;
+    }
 
     const qint32 outputLine = topPadLines + lineNumber;
 
@@ -282,7 +575,7 @@ void OutputWriter::convertLine(qint32 lineNumber, const ComponentFrame &componen
     switch (config.pixelFormat) {
         case RGB48: {
             // Convert Y'UV to full-range R'G'B' [Poynton eq 28.6 p337]
-            quint16 *out = outputFrame.data() + (activeWidth * outputLine * 3);
+            quint16 *out = outputData + (activeWidth * outputLine * 3);
 
             const double yScale = 65535.0 / yRange;
             const double uvScale = 65535.0 / uvRange;
@@ -304,7 +597,7 @@ void OutputWriter::convertLine(qint32 lineNumber, const ComponentFrame &componen
         }
         case YUV444P16: {
             // Convert Y'UV to Y'CbCr [Poynton eq 25.5 p307]
-            quint16 *outY  = outputFrame.data() + (activeWidth * outputLine);
+            quint16 *outY  = outputData + (activeWidth * outputLine);
             quint16 *outCB = outY + (activeWidth * outputHeight);
             quint16 *outCR = outCB + (activeWidth * outputHeight);
 
@@ -322,7 +615,7 @@ void OutputWriter::convertLine(qint32 lineNumber, const ComponentFrame &componen
         }
         case GRAY16: {
             // Throw away UV and just convert Y' to the same scale as Y'CbCr
-            quint16 *out = outputFrame.data() + (activeWidth * outputLine);
+            quint16 *out = outputData + (activeWidth * outputLine);
 
             const double yScale = Y_SCALE / yRange;
 
@@ -332,5 +625,81 @@ void OutputWriter::convertLine(qint32 lineNumber, const ComponentFrame &componen
 
             break;
         }
+        default:
+            // Subsampled formats are handled by the *Subsampled* functions
+            break;
+    }
+}
+
+template <typename T>
+void OutputWriter::clearSubsampledPadLines(T *outputData) const
+{
+    const SubsampledScaling &scaling = subsampledScaling;
+    T *outY  = outputData;
+    T *outCB = outY + (activeWidth * outputHeight);
+    T *outCR = outCB + (chromaWidth * chromaHeight);
+
+    // Fill padding lines with black
+    for (qint32 i = 0; i < topPadLines * activeWidth; i++) {
+        outY[i] = static_cast<T>(scaling.yZero);
+    }
+    for (qint32 i = (topPadLines + activeHeight) * activeWidth; i < outputHeight * activeWidth; i++) {
+        outY[i] = static_cast<T>(scaling.yZero);
+    }
+
+    if (chromaYSub == 1) {
+        // 4:2:2 -- padding lines have no chroma
+        // (4:2:0 chroma lines are all produced by the LineConverter)
+        for (qint32 i = 0; i < topPadLines * chromaWidth; i++) {
+            outCB[i] = static_cast<T>(scaling.cZero);
+            outCR[i] = static_cast<T>(scaling.cZero);
+        }
+        for (qint32 i = (topPadLines + activeHeight) * chromaWidth; i < outputHeight * chromaWidth; i++) {
+            outCB[i] = static_cast<T>(scaling.cZero);
+            outCR[i] = static_cast<T>(scaling.cZero);
+        }
+    }
+}
+
+template <typename T>
+void OutputWriter::convertSubsampledLine(qint32 lineNumber, const double *inY, const double *inU, const double *inV,
+                                         double *cbLine, double *crLine, T *outputData) const
+{
+    const SubsampledScaling &scaling = subsampledScaling;
+    T *outY  = outputData;
+    T *outCB = outY + (activeWidth * outputHeight);
+    T *outCR = outCB + (chromaWidth * chromaHeight);
+
+    const qint32 outputLine = topPadLines + lineNumber;
+    const qint32 x = videoParameters.activeVideoStart;
+
+    // Convert Y, and filter and subsample Cb and Cr horizontally, without
+    // offsetting or quantising them yet
+    quantise(inY + x, scaling.yScale, scaling.yZero - (scaling.yOffset * scaling.yScale),
+             scaling.minValue, scaling.maxValue, outY + (outputLine * activeWidth), activeWidth);
+    subsample(inU + x, scaling.cbScale, cbLine, chromaWidth);
+    subsample(inV + x, scaling.crScale, crLine, chromaWidth);
+
+    if (chromaYSub == 1) {
+        // 4:2:2 -- no vertical subsampling
+        quantise(cbLine, 1.0, scaling.cZero, scaling.minValue, scaling.maxValue,
+                 outCB + (outputLine * chromaWidth), chromaWidth);
+        quantise(crLine, 1.0, scaling.cZero, scaling.minValue, scaling.maxValue,
+                 outCR + (outputLine * chromaWidth), chromaWidth);
     }
 }
+
+template <typename T>
+void OutputWriter::convertChromaLine(qint32 chromaLine, const double *cb0, const double *cb1, const double *cb2,
+                                     const double *cr0, const double *cr1, const double *cr2,
+                                     double w0, double w1, double w2, T *outputData) const
+{
+    const SubsampledScaling &scaling = subsampledScaling;
+    T *outCB = outputData + (activeWidth * outputHeight);
+    T *outCR = outCB + (chromaWidth * chromaHeight);
+
+    vertical(cb0, cb1, cb2, w0, w1, w2, scaling.cZero, scaling.minValue, scaling.maxValue,
+             outCB + (chromaLine * chromaWidth), chromaWidth);
+    vertical(cr0, cr1, cr2, w0, w1, w2, scaling.cZero, scaling.minValue, scaling.maxValue,
+             outCR + (chromaLine * chromaWidth), chromaWidth);
+}
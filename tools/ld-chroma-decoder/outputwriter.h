@@ -30,14 +30,13 @@
 #include <QByteArray>
 #include <QVector>
 
+#include "componentframe.h"
 #include "lddecodemetadata.h"
 
-class ComponentFrame;
-
 // A frame (two interlaced fields), converted to one of the supported output formats.
-// Since all the formats currently supported use 16-bit samples, this is just a
-// vector of 16-bit numbers.
-using OutputFrame = QVector<quint16>;
+// This is the data to be written to the output file: planes or pixels of
+// 16-bit samples in the machine's byte order, or 8-bit samples for YUV420P.
+using OutputFrame = QByteArray;
 
 class OutputWriter {
 public:
@@ -45,7 +44,10 @@ public:
     enum PixelFormat {
         RGB48 = 0,
         YUV444P16,
-        GRAY16
+        GRAY16,
+        YUV422P10,
+        YUV420P10,
+        YUV420P
     };
 
     // Output settings
@@ -53,6 +55,8 @@ public:
         qint32 paddingAmount = 8;
         PixelFormat pixelFormat = RGB48;
         bool outputY4m = false;
+        // Used by DecoderPool: map frames into the output pipe with vmsplice
+        bool useVmsplice = false;
     };
 
     // Set the output configuration, and adjust the VideoParameters to suit.
@@ -71,6 +75,39 @@ public:
     // For worker threads: convert a component frame to the configured output format
     void convert(const ComponentFrame &componentFrame, OutputFrame &outputFrame) const;
 
+    // For worker threads: convert a frame to the configured output format one
+    // line at a time, as the decoder finishes each line. Lines within each
+    // field must arrive in ascending order; the fields may be interleaved.
+    class LineConverter : public ComponentFrame::LineSink {
+    public:
+        // Start converting a new frame into outputFrame
+        void begin(const OutputWriter &writer, OutputFrame &outputFrame);
+
+        // Convert one line of the frame (ignored if it's outside the active area)
+        void putLine(qint32 line, const double *y, const double *u, const double *v) override;
+
+        // Finish converting the frame
+        void finish();
+
+    private:
+        const OutputWriter *writer = nullptr;
+        OutputFrame *outputFrame = nullptr;
+
+        // One line of horizontally-subsampled Cb and Cr
+        QVector<double> cbLine;
+        QVector<double> crLine;
+
+        // For 4:2:0 formats, the last four subsampled lines of Cb and Cr in
+        // each field, and the next output line expected in each field
+        QVector<double> chromaWindow;
+        qint32 nextFieldLine[2];
+
+        // Add the next line of subsampled chroma from one field (or nullptr
+        // for padding), and convert any chroma lines that are now complete
+        void putChromaLine(qint32 field, qint32 fieldLine, const double *cb, const double *cr);
+        double *windowLine(qint32 field, qint32 fieldLine, qint32 plane);
+    };
+
     PixelFormat getPixelFormat() const {
         return config.pixelFormat;
     }
@@ -89,14 +126,42 @@ private:
     qint32 activeHeight;
     qint32 outputHeight;
 
+    // Bits per sample, and chroma subsampling factors
+    qint32 sampleBits;
+    qint32 chromaXSub;
+    qint32 chromaYSub;
+    qint32 chromaWidth;
+    qint32 chromaHeight;
+
+    // Scaling for the subsampled Y'CbCr formats
+    struct SubsampledScaling {
+        double minValue, maxValue;
+        double yZero, cZero;
+        double yOffset;
+        double yScale, cbScale, crScale;
+    };
+    SubsampledScaling subsampledScaling;
+
     // Get a string representing the pixel format
     const char *getPixelName() const;
 
     // Clear padding lines
-    void clearPadLines(qint32 firstLine, qint32 numLines, OutputFrame &outputFrame) const;
+    void clearPadLines(qint32 firstLine, qint32 numLines, quint16 *outputData) const;
 
     // Convert one line
-    void convertLine(qint32 lineNumber, const ComponentFrame &componentFrame, OutputFrame &outputFrame) const;
+    void convertLine(qint32 lineNumber, const double *inY, const double *inU, const double *inV,
+                     quint16 *outputData) const;
+
+    // Steps of converting to one of the subsampled Y'CbCr formats
+    template <typename T>
+    void clearSubsampledPadLines(T *outputData) const;
+    template <typename T>
+    void convertSubsampledLine(qint32 lineNumber, const double *inY, const double *inU, const double *inV,
+                               double *cbLine, double *crLine, T *outputData) const;
+    template <typename T>
+    void convertChromaLine(qint32 chromaLine, const double *cb0, const double *cb1, const double *cb2,
+                           const double *cr0, const double *cr1, const double *cr2,
+                           double w0, double w1, double w2, T *outputData) const;
 };
 
 #endif // OUTPUTWRITER_H
@@ -39,6 +39,8 @@
 
 #include "deemp.h"
 
+#include "simddispatch.h"
+
 #include <array>
 #include <cassert>
 #include <cmath>
@@ -66,6 +68,130 @@
     filters with more complex coefficients than the report describes.
  */
 
+namespace {
+    using Line = double[PalColour::MAX_WIDTH];
+    using ChromaFilter = double[4];
+    using LumaFilter = double[2];
+
+    // Multiply the composite or pre-filtered chroma signal on seven lines by
+    // the reference carrier, combining symmetrical pairs of lines (see
+    // decodeLine).
+    template <typename ChromaSample>
+    Q_ALWAYS_INLINE void productDetectKernel(const ChromaSample *in0, const ChromaSample *in1, const ChromaSample *in2,
+                                             const ChromaSample *in3, const ChromaSample *in4, const ChromaSample *in5,
+                                             const ChromaSample *in6, const double *sine, const double *cosine,
+                                             Line *m, Line *n, qint32 start, qint32 end)
+    {
+        for (qint32 i = start; i < end; i++) {
+            m[0][i] =  in0[i] * sine[i];
+            m[2][i] =  in1[i] * sine[i] - in2[i] * sine[i];
+            m[1][i] = -in3[i] * sine[i] - in4[i] * sine[i];
+            m[3][i] = -in5[i] * sine[i] + in6[i] * sine[i];
+
+            n[0][i] =  in0[i] * cosine[i];
+            n[2][i] =  in1[i] * cosine[i] - in2[i] * cosine[i];
+            n[1][i] = -in3[i] * cosine[i] - in4[i] * cosine[i];
+            n[3][i] = -in5[i] * cosine[i] + in6[i] * cosine[i];
+        }
+    }
+
+    // Apply PALcolour's 2D filters to the output of productDetectKernel.
+    //
+    // This works through the taps in the outer loop, accumulating into the
+    // output arrays, so the inner loop can be vectorised across samples. The
+    // sums for each sample are computed in the same order as a
+    // sample-at-a-time loop would, so the results are exactly the same. The
+    // outputs are __restrict so the compiler doesn't need to check at run
+    // time whether they overlap the inputs.
+    Q_ALWAYS_INLINE void filter2DKernel(const Line *m, const Line *n,
+                                        const ChromaFilter *cfilt, const LumaFilter *yfilt,
+                                        double *__restrict pu, double *__restrict qu, double *__restrict pv,
+                                        double *__restrict qv, double *__restrict py, double *__restrict qy,
+                                        qint32 start, qint32 end)
+    {
+        for (qint32 i = start; i < end; i++) {
+            pu[i] = 0;
+            qu[i] = 0;
+            pv[i] = 0;
+            qv[i] = 0;
+            py[i] = 0;
+            qy[i] = 0;
+        }
+
+        // Carry out 2D filtering. P and Q are the two arbitrary SINE & COS
+        // phases components. U filters for U, V for V, and Y for Y.
+        //
+        // U and V are the same for lines n ([0]), n+/-2 ([1]), but
+        // differ in sign for n+/-1 ([2]), n+/-3 ([3]) owing to the
+        // forward/backward axis slant.
+        for (qint32 b = 0; b <= PalColour::FILTER_SIZE; b++) {
+            const double y0 = yfilt[b][0], y1 = yfilt[b][1];
+            const double c0 = cfilt[b][0], c1 = cfilt[b][1], c2 = cfilt[b][2], c3 = cfilt[b][3];
+
+            for (qint32 i = start; i < end; i++) {
+                const qint32 l = i - b;
+                const qint32 r = i + b;
+
+                const double m0 = m[0][r] + m[0][l], m1 = m[1][r] + m[1][l];
+                const double m2 = m[2][r] + m[2][l], m3 = m[3][r] + m[3][l];
+                const double n0 = n[0][r] + n[0][l], n1 = n[1][r] + n[1][l];
+                const double n2 = n[2][r] + n[2][l], n3 = n[3][r] + n[3][l];
+
+                py[i] += m0 * y0 + m1 * y1;
+                qy[i] += n0 * y0 + n1 * y1;
+
+                pu[i] += m0 * c0 + m1 * c1 + n2 * c2 + n3 * c3;
+                qu[i] += n0 * c0 + n1 * c1 - m2 * c2 - m3 * c3;
+                pv[i] += m0 * c0 + m1 * c1 - n2 * c2 - n3 * c3;
+                qv[i] += n0 * c0 + n1 * c1 + m2 * c2 + m3 * c3;
+            }
+        }
+    }
+
+    // Compute the per-sample terms of detectBurst's sums: the current line
+    // less the average of the lines two above and below, and the difference
+    // between the lines immediately below and above.
+    Q_ALWAYS_INLINE void burstDifferencesKernel(const quint16 *in0, const quint16 *in1, const quint16 *in2,
+                                                const quint16 *in3, const quint16 *in4,
+                                                double *current, double *adjacent, qint32 start, qint32 end)
+    {
+        for (qint32 i = start; i < end; i++) {
+            current[i] = (in0[i] - ((in3[i] + in4[i]) / 2.0)) / 2.0;
+            adjacent[i] = (in2[i] - in1[i]) / 2.0;
+        }
+    }
+
+    // These are compiled for each SIMD instruction set, but without fused
+    // multiply-add, so the output is the same on every CPU
+    SIMD_DISPATCH_EXACT void productDetect(const quint16 *in0, const quint16 *in1, const quint16 *in2,
+                                           const quint16 *in3, const quint16 *in4, const quint16 *in5,
+                                           const quint16 *in6, const double *sine, const double *cosine,
+                                           Line *m, Line *n, qint32 start, qint32 end)
+    {
+        productDetectKernel(in0, in1, in2, in3, in4, in5, in6, sine, cosine, m, n, start, end);
+    }
+    SIMD_DISPATCH_EXACT void productDetect(const double *in0, const double *in1, const double *in2,
+                                           const double *in3, const double *in4, const double *in5,
+                                           const double *in6, const double *sine, const double *cosine,
+                                           Line *m, Line *n, qint32 start, qint32 end)
+    {
+        productDetectKernel(in0, in1, in2, in3, in4, in5, in6, sine, cosine, m, n, start, end);
+    }
+    SIMD_DISPATCH_EXACT void filter2D(const Line *m, const Line *n,
+                                      const ChromaFilter *cfilt, const LumaFilter *yfilt,
+                                      double *pu, double *qu, double *pv, double *qv, double *py, double *qy,
+                                      qint32 start, qint32 end)
+    {
+        filter2DKernel(m, n, cfilt, yfilt, pu, qu, pv, qv, py, qy, start, end);
+    }
+    SIMD_DISPATCH_EXACT void burstDifferences(const quint16 *in0, const quint16 *in1, const quint16 *in2,
+                                              const quint16 *in3, const quint16 *in4,
+                                              double *current, double *adjacent, qint32 start, qint32 end)
+    {
+        burstDifferencesKernel(in0, in1, in2, in3, in4, current, adjacent, start, end);
+    }
+}
+
 PalColour::PalColour()
     : configurationSet(false)
 {
@@ -100,6 +226,47 @@ qint32 PalColour::Configuration::getLookAhead() const
     }
 }
 
+qint32 PalColour::Configuration::getBatchAlignment() const
+{
+    if (chromaFilter == transform3DFilter) {
+        return TransformPal3D::getBatchAlignment();
+    } else {
+        return 1;
+    }
+}
+
+void PalColour::Configuration::getRegionMargin(qint32 &xMargin, qint32 &yMargin,
+                                               qint32 &xAlignment, qint32 &yAlignment) const
+{
+    xMargin = 0;
+    yMargin = 0;
+    xAlignment = 1;
+    yAlignment = 1;
+
+    if (chromaFilter == transform2DFilter) {
+        TransformPal2D::getRegionMargin(xMargin, yMargin, xAlignment, yAlignment);
+    } else if (chromaFilter == transform3DFilter) {
+        TransformPal3D::getRegionMargin(xMargin, yMargin, xAlignment, yAlignment);
+    }
+
+    // decodeLine looks up to three field lines above and below, using black
+    // outside the active area
+    yMargin += 7;
+
+    // The Transform PAL output is zero outside the active area, and
+    // decodeLine's horizontal filters reach FILTER_SIZE samples either side
+    // (or one more with Simple PAL). The PALcolour filters read the composite
+    // signal, which is valid everywhere.
+    if (chromaFilter != palColourFilter) {
+        xMargin += FILTER_SIZE + 1;
+    }
+
+    // doYNR feeds zeros into its filter outside the active area
+    if (yNRLevel > 0.0) {
+        xMargin += c_nrpal_b.size() / 2;
+    }
+}
+
 // Return the current configuration
 const PalColour::Configuration &PalColour::getConfiguration() const {
     return configuration;
@@ -118,9 +285,11 @@ void PalColour::updateConfiguration(const LdDecodeMetaData::VideoParameters &_vi
     if (configuration.chromaFilter == transform2DFilter || configuration.chromaFilter == transform3DFilter) {
         // Create the Transform PAL filter
         if (configuration.chromaFilter == transform2DFilter) {
-            transformPal = std::make_unique<TransformPal2D>();
+            transformPal = std::make_unique<TransformPal2D>(configuration.transformSinglePrecision,
+                                                            configuration.transformEffort);
         } else {
-            transformPal = std::make_unique<TransformPal3D>();
+            transformPal = std::make_unique<TransformPal3D>(configuration.transformSinglePrecision,
+                                                            configuration.transformEffort);
         }
 
         // Configure the filter
@@ -344,12 +513,16 @@ void PalColour::detectBurst(LineInfo &line, const quint16 *inputData)
     // degree change of phase), and we also analyse the average (bpo/bqo
     // 'old') of the line immediately above and below, which have the
     // opposite V-switch phase (and a 90 degree subcarrier phase shift).
+    double current[MAX_WIDTH], adjacent[MAX_WIDTH];
+    burstDifferences(in0, in1, in2, in3, in4, current, adjacent,
+                     videoParameters.colourBurstStart, videoParameters.colourBurstEnd);
+
     double bp = 0, bq = 0, bpo = 0, bqo = 0;
     for (qint32 i = videoParameters.colourBurstStart; i < videoParameters.colourBurstEnd; i++) {
-        bp += ((in0[i] - ((in3[i] + in4[i]) / 2.0)) / 2.0) * sine[i];
-        bq += ((in0[i] - ((in3[i] + in4[i]) / 2.0)) / 2.0) * cosine[i];
-        bpo += ((in2[i] - in1[i]) / 2.0) * sine[i];
-        bqo += ((in2[i] - in1[i]) / 2.0) * cosine[i];
+        bp += current[i] * sine[i];
+        bq += current[i] * cosine[i];
+        bpo += adjacent[i] * sine[i];
+        bqo += adjacent[i] * cosine[i];
     }
 
     // Normalise the sums above
@@ -513,56 +686,14 @@ void PalColour::decodeLine(const SourceField &inputField, const ChromaSample *ch
         // Vertical taps 1 and 2 are swapped in the array to save one addition
         // in the filter loop, as U and V use the same sign for taps 0 and 2.
         double m[4][MAX_WIDTH], n[4][MAX_WIDTH];
-        for (qint32 i = videoParameters.activeVideoStart - FILTER_SIZE; i < videoParameters.activeVideoEnd + FILTER_SIZE + 1; i++) {
-            m[0][i] =  in0[i] * sine[i];
-            m[2][i] =  in1[i] * sine[i] - in2[i] * sine[i];
-            m[1][i] = -in3[i] * sine[i] - in4[i] * sine[i];
-            m[3][i] = -in5[i] * sine[i] + in6[i] * sine[i];
-
-            n[0][i] =  in0[i] * cosine[i];
-            n[2][i] =  in1[i] * cosine[i] - in2[i] * cosine[i];
-            n[1][i] = -in3[i] * cosine[i] - in4[i] * cosine[i];
-            n[3][i] = -in5[i] * cosine[i] + in6[i] * cosine[i];
-        }
+        productDetect(in0, in1, in2, in3, in4, in5, in6, sine, cosine, m, n,
+                      videoParameters.activeVideoStart - FILTER_SIZE, videoParameters.activeVideoEnd + FILTER_SIZE + 1);
 
         // p & q should be sine/cosine components' amplitudes
         // NB: Multiline averaging/filtering assumes perfect
         //     inter-line phase registration...
-
-        for (qint32 i = videoParameters.activeVideoStart; i < videoParameters.activeVideoEnd; i++) {
-            double PU = 0, QU = 0, PV = 0, QV = 0, PY = 0, QY = 0;
-
-            // Carry out 2D filtering. P and Q are the two arbitrary SINE & COS
-            // phases components. U filters for U, V for V, and Y for Y.
-            //
-            // U and V are the same for lines n ([0]), n+/-2 ([1]), but
-            // differ in sign for n+/-1 ([2]), n+/-3 ([3]) owing to the
-            // forward/backward axis slant.
-
-            for (qint32 b = 0; b <= FILTER_SIZE; b++) {
-                const qint32 l = i - b;
-                const qint32 r = i + b;
-
-                PY += (m[0][r] + m[0][l]) * yfilt[b][0] + (m[1][r] + m[1][l]) * yfilt[b][1];
-                QY += (n[0][r] + n[0][l]) * yfilt[b][0] + (n[1][r] + n[1][l]) * yfilt[b][1];
-
-                PU += (m[0][r] + m[0][l]) * cfilt[b][0] + (m[1][r] + m[1][l]) * cfilt[b][1]
-                        + (n[2][r] + n[2][l]) * cfilt[b][2] + (n[3][r] + n[3][l]) * cfilt[b][3];
-                QU += (n[0][r] + n[0][l]) * cfilt[b][0] + (n[1][r] + n[1][l]) * cfilt[b][1]
-                        - (m[2][r] + m[2][l]) * cfilt[b][2] - (m[3][r] + m[3][l]) * cfilt[b][3];
-                PV += (m[0][r] + m[0][l]) * cfilt[b][0] + (m[1][r] + m[1][l]) * cfilt[b][1]
-                        - (n[2][r] + n[2][l]) * cfilt[b][2] - (n[3][r] + n[3][l]) * cfilt[b][3];
-                QV += (n[0][r] + n[0][l]) * cfilt[b][0] + (n[1][r] + n[1][l]) * cfilt[b][1]
-                        + (m[2][r] + m[2][l]) * cfilt[b][2] + (m[3][r] + m[3][l]) * cfilt[b][3];
-            }
-
-            pu[i] = PU;
-            qu[i] = QU;
-            pv[i] = PV;
-            qv[i] = QV;
-            py[i] = PY;
-            qy[i] = QY;
-        }
+        filter2D(m, n, cfilt, yfilt, pu, qu, pv, qv, py, qy,
+                 videoParameters.activeVideoStart, videoParameters.activeVideoEnd);
     }
 
     // Pointer to composite signal data
@@ -599,4 +730,6 @@ void PalColour::decodeLine(const SourceField &inputField, const ChromaSample *ch
     if (configuration.yNRLevel > 0.0) {
         doYNR(outY);
     }
+
+    componentFrame.finishLine(lineNumber);
 }
@@ -62,6 +62,8 @@ public:
         ChromaFilterMode chromaFilter = palColourFilter;
         double transformThreshold = 0.4;
         QVector<double> transformThresholds;
+        bool transformSinglePrecision = false;
+        FFTWEffort transformEffort = fftwMeasure;
         bool showFFTs = false;
         qint32 showPositionX = 200;
         qint32 showPositionY = 200;
@@ -69,6 +71,8 @@ public:
         qint32 getThresholdsSize() const;
         qint32 getLookBehind() const;
         qint32 getLookAhead() const;
+        qint32 getBatchAlignment() const;
+        void getRegionMargin(qint32 &xMargin, qint32 &yMargin, qint32 &xAlignment, qint32 &yAlignment) const;
     };
 
     const Configuration &getConfiguration() const;
@@ -82,6 +86,9 @@ public:
     // Maximum frame size, based on PAL
     static constexpr qint32 MAX_WIDTH = 1135;
 
+    // Size of the 2D chroma filters (see cfilt below)
+    static constexpr qint32 FILTER_SIZE = 7;
+
 private:
     // Information about a line we're decoding.
     struct LineInfo {
@@ -121,7 +128,6 @@ private:
     // array represents one quarter of a filter. The zeroth horizontal element
     // is included in the sum twice, so the coefficient is halved to
     // compensate. Each filter is (2 * FILTER_SIZE) + 1 elements wide.
-    static constexpr qint32 FILTER_SIZE = 7;
     double cfilt[FILTER_SIZE + 1][4];
     double yfilt[FILTER_SIZE + 1][2];
 };
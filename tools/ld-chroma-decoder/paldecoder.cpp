@@ -54,6 +54,16 @@ qint32 PalDecoder::getLookAhead() const
     return config.pal.getLookAhead();
 }
 
+qint32 PalDecoder::getBatchAlignment() const
+{
+    return config.pal.getBatchAlignment();
+}
+
+void PalDecoder::getRegionMargin(qint32 &xMargin, qint32 &yMargin, qint32 &xAlignment, qint32 &yAlignment) const
+{
+    config.pal.getRegionMargin(xMargin, yMargin, xAlignment, yAlignment);
+}
+
 QThread *PalDecoder::makeThread(QAtomicInt& abort, DecoderPool& decoderPool) {
     return new PalThread(abort, decoderPool, config);
 }
@@ -66,6 +76,12 @@ PalThread::PalThread(QAtomicInt& _abort, DecoderPool& _decoderPool,
     palColour.updateConfiguration(config.videoParameters, config.pal);
 }
 
+bool PalThread::streamsLines() const
+{
+    // The FFT overlay is drawn onto complete frames
+    return !config.pal.showFFTs;
+}
+
 void PalThread::decodeFrames(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
                              QVector<ComponentFrame> &componentFrames)
 {
@@ -48,6 +48,8 @@ public:
     bool configure(const LdDecodeMetaData::VideoParameters &videoParameters) override;
     qint32 getLookBehind() const override;
     qint32 getLookAhead() const override;
+    qint32 getBatchAlignment() const override;
+    void getRegionMargin(qint32 &xMargin, qint32 &yMargin, qint32 &xAlignment, qint32 &yAlignment) const override;
     QThread *makeThread(QAtomicInt& abort, DecoderPool& decoderPool) override;
 
     // Parameters used by PalDecoder and PalThread
@@ -70,6 +72,7 @@ public:
 protected:
     void decodeFrames(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
                       QVector<ComponentFrame> &componentFrames) override;
+    bool streamsLines() const override;
 
 private:
     // Settings
@@ -0,0 +1,59 @@
+/************************************************************************
+
+    simddispatch.h
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2026 agent
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef SIMDDISPATCH_H
+#define SIMDDISPATCH_H
+
+// SIMD_DISPATCH marks a function to be compiled several times for different
+// x86 instruction set extensions, with the best version for the CPU being
+// selected when the program starts. The code should be written as plain
+// loops that the compiler can vectorise.
+//
+// Where this isn't supported (other compilers, other architectures, or
+// platforms without ifunc support), the function is compiled once for the
+// baseline instruction set, which the compiler will still vectorise for
+// (e.g. SSE2 on x86-64, or NEON on AArch64).
+//
+// Since the AVX-512 version may use fused multiply-add instructions, results
+// may differ very slightly between CPUs, so this shouldn't be used where the
+// output must be bit-identical.
+//
+// SIMD_DISPATCH_EXACT is the same, but without the AVX-512 version. None of
+// the remaining instruction sets have fused multiply-add, so (as long as the
+// compiler doesn't reorder floating-point operations) the results are the
+// same on every CPU.
+
+#if defined(__has_attribute)
+#if __has_attribute(target_clones) && defined(__x86_64__) && defined(__linux__)
+#define SIMD_DISPATCH __attribute__((target_clones("avx512f", "avx2", "sse4.2", "default")))
+#define SIMD_DISPATCH_EXACT __attribute__((target_clones("avx2", "sse4.2", "default")))
+#endif
+#endif
+
+#ifndef SIMD_DISPATCH
+#define SIMD_DISPATCH
+#define SIMD_DISPATCH_EXACT
+#endif
+
+#endif // SIMDDISPATCH_H
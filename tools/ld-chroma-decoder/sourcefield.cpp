@@ -24,15 +24,68 @@
 
 #include "sourcefield.h"
 
+#include <cassert>
+
 #include "sourcevideo.h"
 
+// Load one frame's pair of fields from the input.
+// Frames outside the bounds of the file will have dummy metadata and black data.
+static void loadFrame(SourceVideo &sourceVideo, LdDecodeMetaData &ldDecodeMetaData, qint32 frameNumber,
+                      SourceField &firstField, SourceField &secondField)
+{
+    const LdDecodeMetaData::VideoParameters &videoParameters = ldDecodeMetaData.getVideoParameters();
+
+    // Is this frame outside the bounds of the input file?
+    // If so, use real metadata (from frame 1) and black fields.
+    const qint32 numInputFrames = ldDecodeMetaData.getNumberOfFrames();
+    const bool useBlankFrame = frameNumber < 1 || frameNumber > numInputFrames;
+
+    // Get the first frame from the file (using frame 1 if outside bounds)
+    qint32 firstFieldNumber = ldDecodeMetaData.getFirstFieldNumber(useBlankFrame ? 1 : frameNumber);
+    qint32 secondFieldNumber = ldDecodeMetaData.getSecondFieldNumber(useBlankFrame ? 1 : frameNumber);
+
+    // Fetch the input metadata
+    firstField.field = ldDecodeMetaData.getField(firstFieldNumber);
+    secondField.field = ldDecodeMetaData.getField(secondFieldNumber);
+
+    const quint16 black = videoParameters.black16bIre;
+
+    if (useBlankFrame) {
+        // Fill both fields with black
+        SourceVideo::Data blackField;
+        blackField.fill(black, sourceVideo.getFieldLength());
+        firstField.data = blackField;
+        secondField.data = blackField;
+    } else {
+        // Fetch the input fields.
+        // If the input is memory-mapped, this doesn't copy the data.
+        firstField.data = sourceVideo.getVideoFieldView(firstFieldNumber);
+        secondField.data = sourceVideo.getVideoFieldView(secondFieldNumber);
+
+        if ((videoParameters.system == PAL || videoParameters.system == PAL_M) && videoParameters.isSubcarrierLocked) {
+            // With subcarrier-locked 4fSC PAL sampling, we have four
+            // "extra" samples over the course of the frame, so the two
+            // fields will be horizontally misaligned by two samples. Shift
+            // the second field to the left to compensate.
+            //
+            // XXX This should be done elsewhere, as it affects other tools
+            // too.
+
+            SourceVideo::Data shiftedField = secondField.data.toData();
+            shiftedField.remove(0, 2);
+            for (int j = 0; j < 2; j++) {
+                shiftedField.append(black);
+            }
+            secondField.data = shiftedField;
+        }
+    }
+}
+
 void SourceField::loadFields(SourceVideo &sourceVideo, LdDecodeMetaData &ldDecodeMetaData,
                              qint32 firstFrameNumber, qint32 numFrames,
                              qint32 lookBehindFrames, qint32 lookAheadFrames,
                              QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex)
 {
-    const LdDecodeMetaData::VideoParameters &videoParameters = ldDecodeMetaData.getVideoParameters();
-
     // Work out indexes.
     // fields will contain {lookbehind fields... [startIndex] real fields... [endIndex] lookahead fields...}.
     startIndex = 2 * lookBehindFrames;
@@ -40,49 +93,53 @@ void SourceField::loadFields(SourceVideo &sourceVideo, LdDecodeMetaData &ldDecod
     fields.resize(endIndex + (2 * lookAheadFrames));
 
     // Populate fields
-    const qint32 numInputFrames = ldDecodeMetaData.getNumberOfFrames();
     qint32 frameNumber = firstFrameNumber - lookBehindFrames;
     for (qint32 i = 0; i < fields.size(); i += 2) {
+        loadFrame(sourceVideo, ldDecodeMetaData, frameNumber, fields[i], fields[i + 1]);
+        frameNumber++;
+    }
+}
 
-        // Is this frame outside the bounds of the input file?
-        // If so, use real metadata (from frame 1) and black fields.
-        const bool useBlankFrame = frameNumber < 1 || frameNumber > numInputFrames;
-
-        // Get the first frame from the file (using frame 1 if outside bounds)
-        qint32 firstFieldNumber = ldDecodeMetaData.getFirstFieldNumber(useBlankFrame ? 1 : frameNumber);
-        qint32 secondFieldNumber = ldDecodeMetaData.getSecondFieldNumber(useBlankFrame ? 1 : frameNumber);
-
-        // Fetch the input metadata
-        fields[i].field = ldDecodeMetaData.getField(firstFieldNumber);
-        fields[i + 1].field = ldDecodeMetaData.getField(secondFieldNumber);
-
-        const quint16 black = videoParameters.black16bIre;
-
-        if (useBlankFrame) {
-            // Fill both fields with black
-            fields[i].data.fill(black, sourceVideo.getFieldLength());
-            fields[i + 1].data.fill(black, sourceVideo.getFieldLength());
-        } else {
-            // Fetch the input fields
-            fields[i].data = sourceVideo.getVideoField(firstFieldNumber);
-            fields[i + 1].data = sourceVideo.getVideoField(secondFieldNumber);
-
-            if ((videoParameters.system == PAL || videoParameters.system == PAL_M) && videoParameters.isSubcarrierLocked) {
-                // With subcarrier-locked 4fSC PAL sampling, we have four
-                // "extra" samples over the course of the frame, so the two
-                // fields will be horizontally misaligned by two samples. Shift
-                // the second field to the left to compensate.
-                //
-                // XXX This should be done elsewhere, as it affects other tools
-                // too.
-
-                fields[i + 1].data.remove(0, 2);
-                for (int j = 0; j < 2; j++) {
-                    fields[i + 1].data.append(black);
-                }
-            }
-        }
+SourceField::Window::Window(SourceVideo &_sourceVideo, LdDecodeMetaData &_ldDecodeMetaData,
+                            qint32 _lookBehindFrames, qint32 _lookAheadFrames, qint32 maxFrames)
+    : sourceVideo(_sourceVideo), ldDecodeMetaData(_ldDecodeMetaData),
+      lookBehindFrames(_lookBehindFrames), lookAheadFrames(_lookAheadFrames),
+      capacity(_lookBehindFrames + maxFrames + _lookAheadFrames),
+      firstFrame(0), endFrame(0)
+{
+    frames.resize(2 * capacity);
+}
 
-        frameNumber++;
+void SourceField::Window::loadFields(qint32 firstFrameNumber, qint32 numFrames,
+                                     QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex)
+{
+    assert(numFrames <= capacity - lookBehindFrames - lookAheadFrames);
+
+    const qint32 wantFirst = firstFrameNumber - lookBehindFrames;
+    const qint32 wantEnd = firstFrameNumber + numFrames + lookAheadFrames;
+
+    if (wantFirst < firstFrame || wantFirst > endFrame) {
+        // We've been asked to go backwards, or to skip ahead -- start again
+        endFrame = wantFirst;
+    }
+
+    // Forget the frames before the ones we need
+    firstFrame = wantFirst;
+
+    // Load the new frames, in order
+    while (endFrame < wantEnd) {
+        const qint32 slot = 2 * (((endFrame % capacity) + capacity) % capacity);
+        loadFrame(sourceVideo, ldDecodeMetaData, endFrame, frames[slot], frames[slot + 1]);
+        endFrame++;
+    }
+
+    // Copy the frames out, as for SourceField::loadFields
+    startIndex = 2 * lookBehindFrames;
+    endIndex = startIndex + (2 * numFrames);
+    fields.resize(2 * (wantEnd - wantFirst));
+    for (qint32 frameNumber = wantFirst, i = 0; frameNumber < wantEnd; frameNumber++, i += 2) {
+        const qint32 slot = 2 * (((frameNumber % capacity) + capacity) % capacity);
+        fields[i] = frames[slot];
+        fields[i + 1] = frames[slot + 1];
     }
 }
@@ -31,7 +31,7 @@
 // A field read from the input, with metadata and data
 struct SourceField {
     LdDecodeMetaData::Field field;
-    SourceVideo::Data data;
+    SourceVideo::DataView data;
 
     // Load a sequence of frames from the input files.
     //
@@ -42,6 +42,9 @@ struct SourceField {
                            qint32 lookBehindFrames, qint32 lookAheadFrames,
                            QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex);
 
+    // A sliding window over the input (see below)
+    class Window;
+
     // Return the vertical offset of this field within the interlaced frame
     // (i.e. 0 for the top field, 1 for the bottom field).
     qint32 getOffset() const {
@@ -58,4 +61,38 @@ struct SourceField {
     }
 };
 
+// A sliding window over the input, for loading consecutive batches of
+// frames with lookbehind/lookahead.
+//
+// Each frame is read from the SourceVideo only once, in order, and kept
+// until no later batch can need it, so the lookbehind/lookahead frames
+// never need to be read again. This means that the input can be a pipe
+// (e.g. from ld-decode), and the memory used is bounded by the size of
+// the window rather than the SourceVideo's cache.
+class SourceField::Window {
+public:
+    // maxFrames is the largest number of frames that will be requested at once
+    Window(SourceVideo &sourceVideo, LdDecodeMetaData &ldDecodeMetaData,
+           qint32 lookBehindFrames, qint32 lookAheadFrames, qint32 maxFrames);
+
+    // Load a sequence of frames, as for SourceField::loadFields. Each
+    // call should follow on from the previous one; otherwise, frames
+    // will be read from the input again.
+    void loadFields(qint32 firstFrameNumber, qint32 numFrames,
+                    QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex);
+
+private:
+    SourceVideo &sourceVideo;
+    LdDecodeMetaData &ldDecodeMetaData;
+    qint32 lookBehindFrames;
+    qint32 lookAheadFrames;
+    qint32 capacity;
+
+    // Ring of fields for the frames from firstFrame to endFrame - 1,
+    // with each frame at index 2 * (frame number modulo capacity)
+    QVector<SourceField> frames;
+    qint32 firstFrame;
+    qint32 endFrame;
+};
+
 #endif
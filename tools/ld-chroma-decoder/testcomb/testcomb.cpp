@@ -0,0 +1,270 @@
+/************************************************************************
+
+    testcomb.cpp
+
+    Golden-output tests for the NTSC comb filter
+    Copyright (C) 2026 agent
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "comb.h"
+#include "componentframe.h"
+#include "sourcefield.h"
+
+// Number of frames in the test sequence
+static constexpr qint32 NUM_FRAMES = 6;
+
+// Make video parameters for a 4fSC NTSC source
+static LdDecodeMetaData::VideoParameters makeVideoParameters()
+{
+    LdDecodeMetaData::VideoParameters videoParameters;
+    videoParameters.system = NTSC;
+    videoParameters.isValid = true;
+    videoParameters.fieldWidth = 910;
+    videoParameters.fieldHeight = 263;
+    videoParameters.fSC = 315.0e6 / 88.0;
+    videoParameters.sampleRate = 4 * videoParameters.fSC;
+    videoParameters.colourBurstStart = 78;
+    videoParameters.colourBurstEnd = 110;
+    videoParameters.activeVideoStart = 134;
+    videoParameters.activeVideoEnd = 894;
+    videoParameters.firstActiveFrameLine = 40;
+    videoParameters.lastActiveFrameLine = 525;
+    videoParameters.white16bIre = 51200;
+    videoParameters.black16bIre = 15360;
+    return videoParameters;
+}
+
+// Generate a sequence of fields containing moving luma and chroma patterns,
+// plus noise. Only integer arithmetic is used, so the input is the same on
+// every platform.
+static QVector<SourceField> makeFields(const LdDecodeMetaData::VideoParameters &videoParameters)
+{
+    QVector<SourceField> fields(NUM_FRAMES * 2);
+    quint32 seed = 12345;
+
+    for (qint32 i = 0; i < fields.size(); i++) {
+        SourceVideo::Data data(videoParameters.fieldWidth * videoParameters.fieldHeight);
+        const qint32 frame = i / 2;
+
+        for (qint32 y = 0; y < videoParameters.fieldHeight; y++) {
+            // The subcarrier phase flips on alternate lines and fields
+            const bool invert = ((y + i) % 2) != 0;
+
+            for (qint32 x = 0; x < videoParameters.fieldWidth; x++) {
+                seed = (seed * 1103515245) + 12345;
+                const qint32 noise = static_cast<qint32>((seed >> 16) % 400);
+
+                // Luma: diagonal ramps, with a block that moves between frames
+                qint32 luma = 20000 + (((x * 3) + (y * 5)) % 200) * 80;
+                if (((x + (frame * 16)) / 64) % 3 == 0 && (y / 40) % 2 == 0) luma += 12000;
+
+                // Chroma: a subcarrier with amplitude and phase varying by region
+                static constexpr qint32 carrier[4] = {0, 1, 0, -1};
+                const qint32 phase = x + (((x / 100) + frame) % 2);
+                qint32 chroma = carrier[phase % 4] * (2000 + ((y * 7) % 5000));
+                if (invert) chroma = -chroma;
+
+                data[(y * videoParameters.fieldWidth) + x] = static_cast<quint16>(qBound(0, luma + chroma + noise, 65535));
+            }
+        }
+
+        fields[i].data = data;
+        fields[i].field.seqNo = i + 1;
+        fields[i].field.isFirstField = (i % 2) == 0;
+        fields[i].field.fieldPhaseID = (i % 4) + 1;
+    }
+
+    return fields;
+}
+
+// Decode the test sequence in batches, returning the output frames
+static QVector<ComponentFrame> decode(const Comb::Configuration &configuration, qint32 batchSize)
+{
+    const LdDecodeMetaData::VideoParameters videoParameters = makeVideoParameters();
+    const QVector<SourceField> allFields = makeFields(videoParameters);
+
+    Comb comb;
+    comb.updateConfiguration(videoParameters, configuration);
+    const qint32 lookBehind = configuration.getLookBehind();
+    const qint32 lookAhead = configuration.getLookAhead();
+
+    QVector<ComponentFrame> outputFrames;
+    for (qint32 firstFrame = 0; firstFrame < NUM_FRAMES; firstFrame += batchSize) {
+        const qint32 numFrames = qMin(batchSize, NUM_FRAMES - firstFrame);
+
+        // Build the batch, repeating the first/last frame at the ends
+        QVector<SourceField> fields;
+        for (qint32 frame = firstFrame - lookBehind; frame < firstFrame + numFrames + lookAhead; frame++) {
+            const qint32 sourceFrame = qBound(0, frame, NUM_FRAMES - 1);
+            fields.append(allFields[sourceFrame * 2]);
+            fields.append(allFields[(sourceFrame * 2) + 1]);
+        }
+
+        QVector<ComponentFrame> componentFrames(numFrames);
+        const qint32 startIndex = lookBehind * 2;
+        comb.decodeFrames(fields, startIndex, startIndex + (numFrames * 2), componentFrames);
+
+        outputFrames.append(componentFrames);
+    }
+
+    return outputFrames;
+}
+
+// Return a hash of a sequence of frames
+static quint64 hashFrames(const QVector<ComponentFrame> &componentFrames)
+{
+    // FNV-1a
+    quint64 hash = 14695981039346656037ULL;
+    auto hashBytes = [&hash](const void *data, size_t size) {
+        const quint8 *bytes = static_cast<const quint8 *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+
+    for (const ComponentFrame &componentFrame : componentFrames) {
+        for (qint32 y = 0; y < componentFrame.getHeight(); y++) {
+            hashBytes(componentFrame.y(y), componentFrame.getWidth() * sizeof(double));
+            hashBytes(componentFrame.u(y), componentFrame.getWidth() * sizeof(double));
+            hashBytes(componentFrame.v(y), componentFrame.getWidth() * sizeof(double));
+        }
+    }
+
+    return hash;
+}
+
+// Compare the active area of two sequences of frames, returning the largest
+// difference between samples, and setting numOverThreshold to the number of
+// samples that differ by more than threshold
+static double compareFrames(const QVector<ComponentFrame> &a, const QVector<ComponentFrame> &b,
+                            double threshold, qint64 &numOverThreshold)
+{
+    const LdDecodeMetaData::VideoParameters videoParameters = makeVideoParameters();
+    double maxDifference = 0.0;
+    numOverThreshold = 0;
+
+    for (qint32 i = 0; i < a.size(); i++) {
+        for (qint32 y = videoParameters.firstActiveFrameLine; y < videoParameters.lastActiveFrameLine; y++) {
+            const double *linesA[] = { a[i].y(y), a[i].u(y), a[i].v(y) };
+            const double *linesB[] = { b[i].y(y), b[i].u(y), b[i].v(y) };
+            for (qint32 c = 0; c < 3; c++) {
+                for (qint32 x = videoParameters.activeVideoStart; x < videoParameters.activeVideoEnd; x++) {
+                    const double difference = std::fabs(linesA[c][x] - linesB[c][x]);
+                    maxDifference = std::max(maxDifference, difference);
+                    if (difference > threshold) numOverThreshold++;
+                }
+            }
+        }
+    }
+
+    return maxDifference;
+}
+
+struct TestCase {
+    const char *name;
+    qint32 dimensions;
+    bool adaptive;
+    bool phaseCompensation;
+    bool showMap;
+    quint64 expected;
+
+    // Number of samples where the single-precision output may differ from
+    // the double-precision output by more than FLOAT_TOLERANCE. The adaptive
+    // 3D filter can choose a different candidate where two are almost equally
+    // good, so a few samples may differ a lot.
+    qint64 maxFloatOutliers;
+};
+
+// Largest expected difference between the single- and double-precision
+// output for most samples
+static constexpr double FLOAT_TOLERANCE = 0.05;
+
+int main()
+{
+    // Expected hashes of the output, as produced by the original per-sample
+    // implementation of the filters
+    static constexpr TestCase testCases[] = {
+        { "ntsc1d",           1, true,  false, false, 0x77edde16e0fa0010ULL, 0 },
+        { "ntsc2d",           2, true,  false, false, 0x240d2048dc76af7eULL, 0 },
+        { "ntsc3d",           3, true,  false, false, 0x3eaf2a6f119b81f0ULL, 1000 },
+        { "ntsc3dnoadapt",    3, false, false, false, 0x7c3fe61367028a77ULL, 0 },
+        { "ntsc3d-phasecomp", 3, true,  true,  false, 0x2495c73dcf7d8ed3ULL, 1000 },
+        { "ntsc3d-map",       3, true,  false, true,  0x050d6b5a551b1c92ULL, 1000 },
+    };
+
+    bool failed = false;
+    for (const TestCase &testCase : testCases) {
+        Comb::Configuration configuration;
+        configuration.dimensions = testCase.dimensions;
+        configuration.adaptive = testCase.adaptive;
+        configuration.phaseCompensation = testCase.phaseCompensation;
+        configuration.showMap = testCase.showMap;
+
+        // The result should be the same regardless of how the input is batched
+        QVector<ComponentFrame> doubleFrames;
+        quint64 firstHash = 0;
+        for (qint32 batchSize : { 1, 4 }) {
+            doubleFrames = decode(configuration, batchSize);
+            const quint64 hash = hashFrames(doubleFrames);
+            fprintf(stderr, "%-18s batch %d: %016llx", testCase.name, batchSize, static_cast<unsigned long long>(hash));
+
+            if (batchSize == 1) {
+                firstHash = hash;
+            } else if (hash != firstHash) {
+                fprintf(stderr, " - differs from batch 1");
+                failed = true;
+            }
+
+#if defined(__x86_64__)
+            // The expected hashes depend on the platform's floating-point
+            // behaviour, so they're only checked on x86-64
+            if (hash != testCase.expected) {
+                fprintf(stderr, " - expected %016llx", static_cast<unsigned long long>(testCase.expected));
+                failed = true;
+            }
+#endif
+            fprintf(stderr, "\n");
+        }
+
+        // The single-precision output depends on the instruction set used, so
+        // it's compared against the double-precision output instead
+        configuration.singlePrecision = true;
+        qint64 numOutliers;
+        const double maxDifference = compareFrames(decode(configuration, 4), doubleFrames, FLOAT_TOLERANCE, numOutliers);
+        fprintf(stderr, "%-18s float:   max difference %g, %lld over %g",
+                testCase.name, maxDifference, static_cast<long long>(numOutliers), FLOAT_TOLERANCE);
+        if (numOutliers > testCase.maxFloatOutliers) {
+            fprintf(stderr, " - expected at most %lld", static_cast<long long>(testCase.maxFloatOutliers));
+            failed = true;
+        }
+        fprintf(stderr, "\n");
+    }
+
+    if (failed) {
+        fprintf(stderr, "Output doesn't match\n");
+        return 1;
+    }
+    return 0;
+}
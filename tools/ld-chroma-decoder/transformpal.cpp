@@ -27,8 +27,192 @@
 
 #include "transformpal.h"
 
+#include "simddispatch.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+// FFTW's planner isn't thread-safe, so planning and wisdom operations are
+// serialised using this mutex
+static QMutex plannerMutex;
+
+// Return the path of the FFTW wisdom cache file for type T
+template <typename T>
+static QString getWisdomPath()
+{
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (cacheDir.isEmpty()) return QString();
+
+    return cacheDir + "/ld-decode/" + FFTW<T>::wisdomName;
+}
+
+// Import FFTW's wisdom from the cache file, if there is one
+template <typename T>
+static void importWisdom()
+{
+    const QString wisdomPath = getWisdomPath<T>();
+    if (wisdomPath.isEmpty()) return;
+
+    QFile wisdomFile(wisdomPath);
+    if (!wisdomFile.open(QIODevice::ReadOnly)) return;
+
+    const QByteArray wisdom = wisdomFile.readAll();
+    if (FFTW<T>::importWisdom(wisdom.constData()) == 0) {
+        qDebug() << "FFTBatch: Ignoring invalid FFTW wisdom in" << wisdomPath;
+    }
+}
+
+// Export FFTW's wisdom to the cache file.
+// The file is replaced atomically, so that other processes see either the
+// old or the new wisdom.
+template <typename T>
+static void exportWisdom()
+{
+    const QString wisdomPath = getWisdomPath<T>();
+    if (wisdomPath.isEmpty()) return;
+
+    char *wisdom = FFTW<T>::exportWisdom();
+    if (wisdom == nullptr) return;
+
+    QSaveFile wisdomFile(wisdomPath);
+    if (!QDir().mkpath(QFileInfo(wisdomPath).absolutePath())
+        || !wisdomFile.open(QIODevice::WriteOnly)
+        || wisdomFile.write(wisdom) != static_cast<qint64>(strlen(wisdom))
+        || !wisdomFile.commit()) {
+        qDebug() << "FFTBatch: Unable to save FFTW wisdom to" << wisdomPath;
+    }
+
+    // FFTW allocates the string with malloc
+    free(wisdom);
+}
+
+// Get the shared plans for a batch of tiles, creating them if necessary
+template <typename T>
+static void getPlans(qint32 zSize, qint32 ySize, qint32 xSize, FFTWEffort effort,
+                     typename FFTW<T>::Plan &forwardPlan, typename FFTW<T>::Plan &inversePlan)
+{
+    using Plan = typename FFTW<T>::Plan;
+    using Key = std::array<qint32, 4>;
+
+    QMutexLocker locker(&plannerMutex);
+
+    // Plans that have already been created, which last until the program exits
+    static std::map<Key, std::pair<Plan, Plan>> plans;
+    static bool wisdomImported = false;
+
+    const Key key {zSize, ySize, xSize, static_cast<qint32>(effort)};
+    auto it = plans.find(key);
+    if (it == plans.end()) {
+        if (!wisdomImported) {
+            importWisdom<T>();
+            wisdomImported = true;
+        }
+
+        // Dimensions of each tile, omitting Z for 2D tiles
+        const int sizes[] = {zSize, ySize, xSize};
+        const int rank = (zSize == 1) ? 2 : 3;
+        const int *n = sizes + (3 - rank);
+
+        unsigned flags;
+        switch (effort) {
+        case fftwEstimate:
+            flags = FFTW_ESTIMATE;
+            break;
+        case fftwPatient:
+            flags = FFTW_PATIENT;
+            break;
+        default:
+            flags = FFTW_MEASURE;
+            break;
+        }
+
+        // Plan using temporary buffers, since measuring overwrites them.
+        // The batches' own buffers are allocated in the same way, so they
+        // will have the same alignment, as new-array execution requires.
+        const qint32 realSize = zSize * ySize * xSize * FFTBatch<T>::BATCH_SIZE;
+        const qint32 complexSize = zSize * ySize * ((xSize / 2) + 1) * FFTBatch<T>::BATCH_SIZE;
+        T *real = FFTW<T>::allocReal(realSize);
+        auto *complex = FFTW<T>::allocComplex(complexSize);
+
+        // Plan FFTW operations, with the tiles interleaved
+        const qint32 batchSize = FFTBatch<T>::BATCH_SIZE;
+        const Plan forward = FFTW<T>::planManyR2C(rank, n, batchSize,
+                                                  real, nullptr, batchSize, 1,
+                                                  complex, nullptr, batchSize, 1,
+                                                  flags);
+        const Plan inverse = FFTW<T>::planManyC2R(rank, n, batchSize,
+                                                  complex, nullptr, batchSize, 1,
+                                                  real, nullptr, batchSize, 1,
+                                                  flags);
+
+        FFTW<T>::freeMemory(real);
+        FFTW<T>::freeMemory(complex);
+
+        // Save any new wisdom (estimating doesn't produce any)
+        if (effort != fftwEstimate) exportWisdom<T>();
+
+        it = plans.emplace(key, std::make_pair(forward, inverse)).first;
+    }
+
+    forwardPlan = it->second.first;
+    inversePlan = it->second.second;
+}
+
+template <typename T>
+FFTBatch<T>::FFTBatch(qint32 zSize, qint32 ySize, qint32 xSize, FFTWEffort effort)
+{
+    // Size of the real and complex arrays for each tile
+    const qint32 realSize = zSize * ySize * xSize;
+    const qint32 complexSize = zSize * ySize * ((xSize / 2) + 1);
+
+    real = FFTW<T>::allocReal(realSize * BATCH_SIZE);
+    complexIn = FFTW<T>::allocComplex(complexSize * BATCH_SIZE);
+    complexOut = FFTW<T>::allocComplex(complexSize * BATCH_SIZE);
+
+    // A batch isn't always full, so clear the buffers to avoid transforming
+    // uninitialised data
+    std::fill_n(real, realSize * BATCH_SIZE, T(0));
+    std::fill_n(&complexIn[0][0], complexSize * BATCH_SIZE * 2, T(0));
+    std::fill_n(&complexOut[0][0], complexSize * BATCH_SIZE * 2, T(0));
+
+    getPlans<T>(zSize, ySize, xSize, effort, forwardPlan, inversePlan);
+}
+
+template <typename T>
+FFTBatch<T>::~FFTBatch()
+{
+    // Free FFTW buffers (the plans are shared, so they're kept)
+    FFTW<T>::freeMemory(real);
+    FFTW<T>::freeMemory(complexIn);
+    FFTW<T>::freeMemory(complexOut);
+}
+
+template <typename T>
+void FFTBatch<T>::forward()
+{
+    FFTW<T>::executeR2C(forwardPlan, real, complexIn);
+}
+
+template <typename T>
+void FFTBatch<T>::inverse()
+{
+    FFTW<T>::executeC2R(inversePlan, complexOut, real);
+}
+
+template class FFTBatch<double>;
+template class FFTBatch<float>;
 
 TransformPal::TransformPal(qint32 _xComplex, qint32 _yComplex, qint32 _zComplex)
     : xComplex(_xComplex), yComplex(_yComplex), zComplex(_zComplex), configurationSet(false)
@@ -117,3 +301,80 @@ void TransformPal::overlayFFTArrays(const fftw_complex *fftIn, const fftw_comple
         }
     }
 }
+
+// Overlay the FFT arrays for one tile of a batch, which must have been
+// through applyFilter
+template <typename T>
+void TransformPal::overlayFFTBatch(const FFTBatch<T> &batch, qint32 tile, FrameCanvas &canvas)
+{
+    // Extract the tile's values from the interleaved batch
+    const qint32 size = xComplex * yComplex * zComplex;
+    QVector<double> fftIn(size * 2), fftOut(size * 2);
+    for (qint32 i = 0; i < size; i++) {
+        for (qint32 j = 0; j < 2; j++) {
+            fftIn[(i * 2) + j] = batch.complexIn[(i * FFTBatch<T>::BATCH_SIZE) + tile][j];
+            fftOut[(i * 2) + j] = batch.complexOut[(i * FFTBatch<T>::BATCH_SIZE) + tile][j];
+        }
+    }
+
+    overlayFFTArrays(reinterpret_cast<const fftw_complex *>(fftIn.constData()),
+                     reinterpret_cast<const fftw_complex *>(fftOut.constData()), canvas);
+}
+
+template void TransformPal::overlayFFTBatch(const FFTBatch<double> &batch, qint32 tile, FrameCanvas &canvas);
+template void TransformPal::overlayFFTBatch(const FFTBatch<float> &batch, qint32 tile, FrameCanvas &canvas);
+
+namespace {
+    // Similarity test for a pair of bins across a batch (see filterBins).
+    //
+    // This is written without branches so the compiler can vectorise it.
+    // Bins that fail the test are left alone, as applyFilter clears the
+    // output first; bins that pass may be written more than once, but always
+    // with the same value.
+    template <typename T, typename Complex>
+    Q_ALWAYS_INLINE void filterBinsKernel(const Complex *in, const Complex *ref,
+                                          Complex *out, Complex *outRef, T thresholdSq)
+    {
+        for (qint32 t = 0; t < FFTBatch<T>::BATCH_SIZE; t++) {
+            // Get the squares of the magnitudes (to minimise the number of sqrts)
+            const T mInSq = (in[t][0] * in[t][0]) + (in[t][1] * in[t][1]);
+            const T mRefSq = (ref[t][0] * ref[t][0]) + (ref[t][1] * ref[t][1]);
+
+            // Compare the magnitudes of the two values, and discard both
+            // if they are more different than the threshold for this bin
+            const bool keep = !((mInSq < mRefSq * thresholdSq) | (mRefSq < mInSq * thresholdSq));
+
+            out[t][0] = keep ? in[t][0] : out[t][0];
+            out[t][1] = keep ? in[t][1] : out[t][1];
+            outRef[t][0] = keep ? ref[t][0] : outRef[t][0];
+            outRef[t][1] = keep ? ref[t][1] : outRef[t][1];
+        }
+    }
+
+    // The double-precision path must give the same output on every CPU, so
+    // it doesn't get the AVX-512 version; the float path is already
+    // approximate, so it can.
+    SIMD_DISPATCH_EXACT void filterBinsDouble(const fftw_complex *in, const fftw_complex *ref,
+                                              fftw_complex *out, fftw_complex *outRef, double thresholdSq)
+    {
+        filterBinsKernel(in, ref, out, outRef, thresholdSq);
+    }
+
+    SIMD_DISPATCH void filterBinsFloat(const fftwf_complex *in, const fftwf_complex *ref,
+                                       fftwf_complex *out, fftwf_complex *outRef, float thresholdSq)
+    {
+        filterBinsKernel(in, ref, out, outRef, thresholdSq);
+    }
+}
+
+void TransformPal::filterBins(const fftw_complex *in, const fftw_complex *ref,
+                              fftw_complex *out, fftw_complex *outRef, double thresholdSq)
+{
+    filterBinsDouble(in, ref, out, outRef, thresholdSq);
+}
+
+void TransformPal::filterBins(const fftwf_complex *in, const fftwf_complex *ref,
+                              fftwf_complex *out, fftwf_complex *outRef, float thresholdSq)
+{
+    filterBinsFloat(in, ref, out, outRef, thresholdSq);
+}
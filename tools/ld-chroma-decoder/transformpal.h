@@ -38,6 +38,111 @@
 #include "outputwriter.h"
 #include "sourcefield.h"
 
+// The FFTW interface for a given sample type, so that the Transform PAL
+// filters can be written once for double precision (fftw_) and single
+// precision (fftwf_).
+template <typename T>
+struct FFTW;
+
+template <>
+struct FFTW<double> {
+    using Complex = fftw_complex;
+    using Plan = fftw_plan;
+
+    static constexpr auto allocReal = fftw_alloc_real;
+    static constexpr auto allocComplex = fftw_alloc_complex;
+    static constexpr auto freeMemory = fftw_free;
+    static constexpr auto planManyR2C = fftw_plan_many_dft_r2c;
+    static constexpr auto planManyC2R = fftw_plan_many_dft_c2r;
+    static constexpr auto executeR2C = fftw_execute_dft_r2c;
+    static constexpr auto executeC2R = fftw_execute_dft_c2r;
+    static constexpr auto importWisdom = fftw_import_wisdom_from_string;
+    static constexpr auto exportWisdom = fftw_export_wisdom_to_string;
+
+    // Name of the wisdom cache file
+    static constexpr const char *wisdomName = "fftw-wisdom";
+};
+
+template <>
+struct FFTW<float> {
+    using Complex = fftwf_complex;
+    using Plan = fftwf_plan;
+
+    static constexpr auto allocReal = fftwf_alloc_real;
+    static constexpr auto allocComplex = fftwf_alloc_complex;
+    static constexpr auto freeMemory = fftwf_free;
+    static constexpr auto planManyR2C = fftwf_plan_many_dft_r2c;
+    static constexpr auto planManyC2R = fftwf_plan_many_dft_c2r;
+    static constexpr auto executeR2C = fftwf_execute_dft_r2c;
+    static constexpr auto executeC2R = fftwf_execute_dft_c2r;
+    static constexpr auto importWisdom = fftwf_import_wisdom_from_string;
+    static constexpr auto exportWisdom = fftwf_export_wisdom_to_string;
+
+    // Name of the wisdom cache file
+    static constexpr const char *wisdomName = "fftwf-wisdom";
+};
+
+// How much time FFTW should spend planning. More effort may find a faster
+// way of computing the transforms, at the cost of a slower start.
+enum FFTWEffort {
+    // Pick a plan using heuristics, without measuring
+    fftwEstimate,
+    // Measure a few candidate plans (the default)
+    fftwMeasure,
+    // Measure many more candidate plans
+    fftwPatient
+};
+
+// A batch of tiles to be transformed by FFTW together, using one plan.
+//
+// For small tiles, the cost of the FFT is dominated by per-call overhead, so
+// it's much faster to do several at once. The tiles are interleaved in the
+// buffers, so element i of tile t is at index (i * BATCH_SIZE) + t; this lets
+// FFTW and applyFilter use SIMD instructions across tiles.
+//
+// Plans are created once for each tile size and shared between all the
+// batches (and threads) that use that size, with each batch executing them on
+// its own buffers. FFTW's accumulated wisdom is kept in a file in the user's
+// cache directory, so that later runs don't need to measure plans again.
+template <typename T>
+class FFTBatch {
+public:
+    using Complex = typename FFTW<T>::Complex;
+
+    // Number of tiles in a batch
+    static constexpr qint32 BATCH_SIZE = 8;
+
+    // Create buffers and get plans for tiles of zSize x ySize x xSize real
+    // samples (with zSize = 1 for 2D tiles).
+    //
+    // This must not be called concurrently with FFTW planning outside this
+    // class, as FFTW's planner isn't thread-safe.
+    FFTBatch(qint32 zSize, qint32 ySize, qint32 xSize, FFTWEffort effort);
+    ~FFTBatch();
+
+    // Prevent copying or assignment
+    FFTBatch(const FFTBatch &) = delete;
+    FFTBatch &operator=(const FFTBatch &) = delete;
+
+    // Convert the time domain in real to the frequency domain in complexIn
+    void forward();
+
+    // Convert the frequency domain in complexOut to the time domain in real.
+    // This overwrites complexOut.
+    void inverse();
+
+    // FFT input/output buffers.
+    // These are allocated using FFTW's own functions so they're properly
+    // aligned for SIMD operations.
+    T *real;
+    Complex *complexIn;
+    Complex *complexOut;
+
+private:
+    // Shared plans, owned by the plan cache
+    typename FFTW<T>::Plan forwardPlan, inversePlan;
+};
+
 // Abstract base class for Transform PAL filters.
 class TransformPal {
 public:
@@ -79,6 +184,19 @@ protected:
     void overlayFFTArrays(const fftw_complex *fftIn, const fftw_complex *fftOut,
                           FrameCanvas &canvas);
 
+    // Overlay the FFT arrays for one tile of a batch
+    template <typename T>
+    void overlayFFTBatch(const FFTBatch<T> &batch, qint32 tile, FrameCanvas &canvas);
+
+    // Apply the similarity test from applyFilter to a pair of bins, for
+    // each tile in a batch. in and ref are the bin and its reflection, and
+    // out and outRef the corresponding output bins; values are copied to
+    // the output if their magnitudes are similar enough.
+    static void filterBins(const fftw_complex *in, const fftw_complex *ref,
+                           fftw_complex *out, fftw_complex *outRef, double thresholdSq);
+    static void filterBins(const fftwf_complex *in, const fftwf_complex *ref,
+                           fftwf_complex *out, fftwf_complex *outRef, float thresholdSq);
+
     // FFT size
     qint32 xComplex;
     qint32 yComplex;
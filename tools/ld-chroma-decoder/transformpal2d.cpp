@@ -28,6 +28,7 @@
 #include "transformpal2d.h"
 
 #include <QtMath>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 
@@ -51,7 +52,7 @@ static double computeWindow(qint32 element, qint32 limit)
     return 0.5 - (0.5 * cos((2 * M_PI * (element + 0.5)) / limit));
 }
 
-TransformPal2D::TransformPal2D()
+TransformPal2D::TransformPal2D(bool singlePrecision, FFTWEffort effort)
     : TransformPal(XCOMPLEX, YCOMPLEX, 1)
 {
     // Compute the window function.
@@ -63,25 +64,12 @@ TransformPal2D::TransformPal2D()
         }
     }
 
-    // Allocate buffers for FFTW. These must be allocated using FFTW's own
-    // functions so they're properly aligned for SIMD operations.
-    fftReal = fftw_alloc_real(YTILE * XTILE);
-    fftComplexIn = fftw_alloc_complex(YCOMPLEX * XCOMPLEX);
-    fftComplexOut = fftw_alloc_complex(YCOMPLEX * XCOMPLEX);
-
-    // Plan FFTW operations
-    forwardPlan = fftw_plan_dft_r2c_2d(YTILE, XTILE, fftReal, fftComplexIn, FFTW_MEASURE);
-    inversePlan = fftw_plan_dft_c2r_2d(YTILE, XTILE, fftComplexOut, fftReal, FFTW_MEASURE);
-}
-
-TransformPal2D::~TransformPal2D()
-{
-    // Free FFTW plans and buffers
-    fftw_destroy_plan(forwardPlan);
-    fftw_destroy_plan(inversePlan);
-    fftw_free(fftReal);
-    fftw_free(fftComplexIn);
-    fftw_free(fftComplexOut);
+    // Allocate buffers and get FFTW plans
+    if (singlePrecision) {
+        floatBatch = std::make_unique<FFTBatch<float>>(1, YTILE, XTILE, effort);
+    } else {
+        doubleBatch = std::make_unique<FFTBatch<double>>(1, YTILE, XTILE, effort);
+    }
 }
 
 qint32 TransformPal2D::getThresholdsSize()
@@ -90,6 +78,18 @@ qint32 TransformPal2D::getThresholdsSize()
     return YCOMPLEX * ((XCOMPLEX / 4) + 1);
 }
 
+void TransformPal2D::getRegionMargin(qint32 &xMargin, qint32 &yMargin, qint32 &xAlignment, qint32 &yAlignment)
+{
+    // Tiles read the input outside the active area horizontally, so they only
+    // need to stay on the same grid. Vertically, lines outside the active area
+    // are replaced with black, so every tile that overlaps the region must be
+    // entirely within the decoded area. (Tiles are in field lines.)
+    xMargin = 0;
+    yMargin = 2 * YTILE;
+    xAlignment = HALFXTILE;
+    yAlignment = 2 * HALFYTILE;
+}
+
 void TransformPal2D::filterFields(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
                                   QVector<const double *> &outputFields)
 {
@@ -112,12 +112,17 @@ void TransformPal2D::filterFields(const QVector<SourceField> &inputFields, qint3
     }
 
     for (qint32 i = startIndex, j = 0; i < endIndex; i++, j++) {
-        filterField(inputFields[i], j);
+        if (floatBatch) {
+            filterField(*floatBatch, inputFields[i], j);
+        } else {
+            filterField(*doubleBatch, inputFields[i], j);
+        }
     }
 }
 
-// Process one field, writing the reuslt into chromaBuf[outputIndex]
-void TransformPal2D::filterField(const SourceField& inputField, qint32 outputIndex)
+// Process one field, writing the result into chromaBuf[outputIndex]
+template <typename T>
+void TransformPal2D::filterField(FFTBatch<T> &batch, const SourceField& inputField, qint32 outputIndex)
 {
     const qint32 firstFieldLine = inputField.getFirstActiveLine(videoParameters);
     const qint32 lastFieldLine = inputField.getLastActiveLine(videoParameters);
@@ -129,82 +134,87 @@ void TransformPal2D::filterField(const SourceField& inputField, qint32 outputInd
         const qint32 startY = qMax(firstFieldLine - tileY, 0);
         const qint32 endY = qMin(lastFieldLine - tileY, YTILE);
 
-        for (qint32 tileX = videoParameters.activeVideoStart - HALFXTILE; tileX < videoParameters.activeVideoEnd; tileX += HALFXTILE) {
-            // Compute the forward FFT
-            forwardFFTTile(tileX, tileY, startY, endY, inputField);
+        // Process the row of tiles a batch at a time
+        for (qint32 batchX = videoParameters.activeVideoStart - HALFXTILE; batchX < videoParameters.activeVideoEnd;
+             batchX += BATCH_SIZE * HALFXTILE) {
+            // The last batch in the row may not be full
+            const qint32 numTiles = qMin(BATCH_SIZE, (videoParameters.activeVideoEnd - batchX + HALFXTILE - 1) / HALFXTILE);
+
+            // Compute the forward FFTs
+            for (qint32 tile = 0; tile < numTiles; tile++) {
+                loadTile(batch, tile, batchX + (tile * HALFXTILE), tileY, startY, endY, inputField);
+            }
+            batch.forward();
 
             // Apply the frequency-domain filter
-            applyFilter();
+            applyFilter(batch);
 
-            // Compute the inverse FFT
-            inverseFFTTile(tileX, tileY, startY, endY, outputIndex);
+            // Compute the inverse FFTs
+            batch.inverse();
+            for (qint32 tile = 0; tile < numTiles; tile++) {
+                storeTile(batch, tile, batchX + (tile * HALFXTILE), tileY, startY, endY, outputIndex);
+            }
         }
     }
 }
 
-// Apply the forward FFT to an input tile, populating fftComplexIn
-void TransformPal2D::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, const SourceField &inputField)
+// Copy an input tile into the batch, ready for the forward FFT
+template <typename T>
+void TransformPal2D::loadTile(FFTBatch<T> &batch, qint32 tile, qint32 tileX, qint32 tileY, qint32 startY, qint32 endY,
+                              const SourceField &inputField)
 {
-    // Copy the input signal into fftReal, applying the window function
+    // Copy the input signal into the batch, applying the window function
+    T *realPtr = batch.real + tile;
     const quint16 *inputPtr = inputField.data.data();
     for (qint32 y = 0; y < YTILE; y++) {
         // If this frame line is above/below the active region, fill it with
         // black instead.
         if (y < startY || y >= endY) {
             for (qint32 x = 0; x < XTILE; x++) {
-                fftReal[(y * XTILE) + x] = videoParameters.black16bIre * windowFunction[y][x];
+                realPtr[((y * XTILE) + x) * BATCH_SIZE] = videoParameters.black16bIre * windowFunction[y][x];
             }
             continue;
         }
 
         const quint16 *b = inputPtr + ((tileY + y) * videoParameters.fieldWidth);
         for (qint32 x = 0; x < XTILE; x++) {
-            fftReal[(y * XTILE) + x] = b[tileX + x] * windowFunction[y][x];
+            realPtr[((y * XTILE) + x) * BATCH_SIZE] = b[tileX + x] * windowFunction[y][x];
         }
     }
-
-    // Convert time domain in fftReal to frequency domain in fftComplexIn
-    fftw_execute(forwardPlan);
 }
 
-// Apply the inverse FFT to fftComplexOut, overlaying the result into chromaBuf[outputIndex]
-void TransformPal2D::inverseFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, qint32 outputIndex)
+// Overlay a tile from the batch after the inverse FFT into chromaBuf[outputIndex]
+template <typename T>
+void TransformPal2D::storeTile(const FFTBatch<T> &batch, qint32 tile, qint32 tileX, qint32 tileY, qint32 startY, qint32 endY,
+                               qint32 outputIndex)
 {
     // Work out what X range of this tile is inside the active area
     const qint32 startX = qMax(videoParameters.activeVideoStart - tileX, 0);
     const qint32 endX = qMin(videoParameters.activeVideoEnd - tileX, XTILE);
 
-    // Convert frequency domain in fftComplexOut back to time domain in fftReal
-    fftw_execute(inversePlan);
-
     // Overlay the result, normalising the FFTW output, into chromaBuf
+    const T *realPtr = batch.real + tile;
     double *outputPtr = chromaBuf[outputIndex].data();
     for (qint32 y = startY; y < endY; y++) {
         double *b = outputPtr + ((tileY + y) * videoParameters.fieldWidth);
         for (qint32 x = startX; x < endX; x++) {
-            b[tileX + x] += fftReal[(y * XTILE) + x] / (YTILE * XTILE);
+            b[tileX + x] += realPtr[((y * XTILE) + x) * BATCH_SIZE] / (YTILE * XTILE);
         }
     }
 }
 
-// Return the absolute value squared of an fftw_complex
-static inline double fftwAbsSq(const fftw_complex &value)
+// Apply the frequency-domain filter to each tile in the batch.
+template <typename T>
+void TransformPal2D::applyFilter(FFTBatch<T> &batch)
 {
-    return (value[0] * value[0]) + (value[1] * value[1]);
-}
+    using Complex = typename FFTBatch<T>::Complex;
 
-// Apply the frequency-domain filter.
-void TransformPal2D::applyFilter()
-{
     // Get pointer to squared threshold values
     const double *thresholdsPtr = thresholds.data();
 
-    // Clear fftComplexOut. We discard values by default; the filter only
+    // Clear complexOut. We discard values by default; the filter only
     // copies values that look like chroma.
-    for (qint32 i = 0; i < XCOMPLEX * YCOMPLEX; i++) {
-        fftComplexOut[i][0] = 0.0;
-        fftComplexOut[i][1] = 0.0;
-    }
+    std::fill_n(&batch.complexOut[0][0], XCOMPLEX * YCOMPLEX * BATCH_SIZE * 2, T(0));
 
     // This is a direct translation of transform_filter from pyctools-pal.
     // The main simplification is that we don't need to worry about
@@ -226,12 +236,12 @@ void TransformPal2D::applyFilter()
         const qint32 y_ref = ((YTILE / 2) + YTILE - y) % YTILE;
 
         // Input data for this line and its reflection
-        const fftw_complex *bi = fftComplexIn + (y * XCOMPLEX);
-        const fftw_complex *bi_ref = fftComplexIn + (y_ref * XCOMPLEX);
+        const Complex *bi = batch.complexIn + (y * XCOMPLEX * BATCH_SIZE);
+        const Complex *bi_ref = batch.complexIn + (y_ref * XCOMPLEX * BATCH_SIZE);
 
         // Output data for this line and its reflection
-        fftw_complex *bo = fftComplexOut + (y * XCOMPLEX);
-        fftw_complex *bo_ref = fftComplexOut + (y_ref * XCOMPLEX);
+        Complex *bo = batch.complexOut + (y * XCOMPLEX * BATCH_SIZE);
+        Complex *bo_ref = batch.complexOut + (y_ref * XCOMPLEX * BATCH_SIZE);
 
         // We only need to look at horizontal frequencies that might be chroma (0.5fSC to 1.5fSC).
         for (qint32 x = XTILE / 8; x <= XTILE / 4; x++) {
@@ -239,34 +249,23 @@ void TransformPal2D::applyFilter()
             const qint32 x_ref = (XTILE / 2) - x;
 
             // Get the threshold for this bin
-            const double threshold_sq = *thresholdsPtr++;
+            const T threshold_sq = static_cast<T>(*thresholdsPtr++);
 
-            const fftw_complex &in_val = bi[x];
-            const fftw_complex &ref_val = bi_ref[x_ref];
+            // Input and output values for this bin and its reflection, for all tiles
+            const Complex *in_val = bi + (x * BATCH_SIZE);
+            const Complex *ref_val = bi_ref + (x_ref * BATCH_SIZE);
+            Complex *out_val = bo + (x * BATCH_SIZE);
+            Complex *out_ref_val = bo_ref + (x_ref * BATCH_SIZE);
 
             if (x == x_ref && y == y_ref) {
                 // This bin is its own reflection (i.e. it's a carrier). Keep it!
-                bo[x][0] = in_val[0];
-                bo[x][1] = in_val[1];
+                std::copy_n(&in_val[0][0], BATCH_SIZE * 2, &out_val[0][0]);
                 continue;
             }
 
-            // Get the squares of the magnitudes (to minimise the number of sqrts)
-            const double m_in_sq = fftwAbsSq(in_val);
-            const double m_ref_sq = fftwAbsSq(ref_val);
-
-            // Compare the magnitudes of the two values, and discard both
-            // if they are more different than the threshold for this
-            // bin.
-            if (m_in_sq < m_ref_sq * threshold_sq || m_ref_sq < m_in_sq * threshold_sq) {
-                // Probably not a chroma signal; throw it away.
-            } else {
-                // They're similar. Keep it!
-                bo[x][0] = in_val[0];
-                bo[x][1] = in_val[1];
-                bo_ref[x_ref][0] = ref_val[0];
-                bo_ref[x_ref][1] = ref_val[1];
-            }
+            // Compare the magnitudes of the two values, and keep both if
+            // they're similar; otherwise it's probably not a chroma signal
+            filterBins(in_val, ref_val, out_val, out_ref_val, threshold_sq);
         }
     }
 
@@ -283,19 +282,31 @@ void TransformPal2D::overlayFFTFrame(qint32 positionX, qint32 positionY,
         return;
     }
 
-    // Work out which field lines to use (as the input is in frame lines)
     const SourceField &inputField = inputFields[fieldIndex];
+    if (floatBatch) {
+        overlayFFTFrameUsing(*floatBatch, positionX, positionY, inputField, componentFrame);
+    } else {
+        overlayFFTFrameUsing(*doubleBatch, positionX, positionY, inputField, componentFrame);
+    }
+}
+
+template <typename T>
+void TransformPal2D::overlayFFTFrameUsing(FFTBatch<T> &batch, qint32 positionX, qint32 positionY,
+                                          const SourceField &inputField, ComponentFrame &componentFrame)
+{
+    // Work out which field lines to use (as the input is in frame lines)
     const qint32 firstFieldLine = inputField.getFirstActiveLine(videoParameters);
     const qint32 lastFieldLine = inputField.getLastActiveLine(videoParameters);
     const qint32 tileY = positionY / 2;
     const qint32 startY = qMax(firstFieldLine - tileY, 0);
     const qint32 endY = qMin(lastFieldLine - tileY, YTILE);
 
-    // Compute the forward FFT
-    forwardFFTTile(positionX, tileY, startY, endY, inputField);
+    // Compute the forward FFT, using the first tile of the batch
+    loadTile(batch, 0, positionX, tileY, startY, endY, inputField);
+    batch.forward();
 
     // Apply the frequency-domain filter
-    applyFilter();
+    applyFilter(batch);
 
     // Create a canvas
     FrameCanvas canvas(componentFrame, videoParameters);
@@ -305,5 +316,5 @@ void TransformPal2D::overlayFFTFrame(qint32 positionX, qint32 positionY,
     canvas.drawRectangle(positionX - 1, positionY + inputField.getOffset() - 1, XTILE + 1, (YTILE * 2) + 1, green);
 
     // Draw the arrays
-    overlayFFTArrays(fftComplexIn, fftComplexOut, canvas);
+    overlayFFTBatch(batch, 0, canvas);
 }
@@ -30,6 +30,7 @@
 
 #include <QVector>
 #include <fftw3.h>
+#include <memory>
 
 #include "componentframe.h"
 #include "outputwriter.h"
@@ -38,23 +39,40 @@
 
 class TransformPal2D : public TransformPal {
 public:
-    TransformPal2D();
-    virtual ~TransformPal2D();
+    // If singlePrecision is true, the FFTs are computed using floats rather
+    // than doubles, which is faster but slightly less accurate. effort
+    // controls how much time FFTW spends planning the transforms.
+    explicit TransformPal2D(bool singlePrecision = false, FFTWEffort effort = fftwMeasure);
 
     // Return the expected size of the thresholds array.
     static qint32 getThresholdsSize();
 
+    // Return the margin (in samples and frame lines) that the filter needs
+    // around a region of interest, and the alignment that the start of the
+    // decoded area needs relative to the full active area, for the output
+    // within the region to be the same as when filtering the whole area.
+    static void getRegionMargin(qint32 &xMargin, qint32 &yMargin, qint32 &xAlignment, qint32 &yAlignment);
+
     void filterFields(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
                       QVector<const double *> &outputFields) override;
 
 protected:
-    void filterField(const SourceField& inputField, qint32 outputIndex);
-    void forwardFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, const SourceField &inputField);
-    void inverseFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, qint32 outputIndex);
-    void applyFilter();
+    template <typename T>
+    void filterField(FFTBatch<T> &batch, const SourceField &inputField, qint32 outputIndex);
+    template <typename T>
+    void loadTile(FFTBatch<T> &batch, qint32 tile, qint32 tileX, qint32 tileY, qint32 startY, qint32 endY,
+                  const SourceField &inputField);
+    template <typename T>
+    void storeTile(const FFTBatch<T> &batch, qint32 tile, qint32 tileX, qint32 tileY, qint32 startY, qint32 endY,
+                   qint32 outputIndex);
+    template <typename T>
+    void applyFilter(FFTBatch<T> &batch);
     void overlayFFTFrame(qint32 positionX, qint32 positionY,
                          const QVector<SourceField> &inputFields, qint32 fieldIndex,
                          ComponentFrame &componentFrame) override;
+    template <typename T>
+    void overlayFFTFrameUsing(FFTBatch<T> &batch, qint32 positionX, qint32 positionY,
+                              const SourceField &inputField, ComponentFrame &componentFrame);
 
     // FFT input and output sizes.
     // The input field is divided into tiles of XTILE x YTILE, with adjacent
@@ -64,23 +82,23 @@ protected:
     static constexpr qint32 XTILE = 32;
     static constexpr qint32 HALFXTILE = XTILE / 2;
 
-    // Each tile is converted to the frequency domain using forwardPlan, which
-    // gives a complex result of size XCOMPLEX x YCOMPLEX (roughly half the
-    // size of the input, because the input data was real, i.e. contained no
-    // negative frequencies).
+    // Each tile is converted to the frequency domain using a forward FFT,
+    // which gives a complex result of size XCOMPLEX x YCOMPLEX (roughly half
+    // the size of the input, because the input data was real, i.e. contained
+    // no negative frequencies).
     static constexpr qint32 YCOMPLEX = YTILE;
     static constexpr qint32 XCOMPLEX = (XTILE / 2) + 1;
 
+    // Number of tiles that are transformed together.
+    // Tiles are processed a batch at a time along each row of tiles.
+    static constexpr qint32 BATCH_SIZE = FFTBatch<double>::BATCH_SIZE;
+
     // Window function applied before the FFT
     double windowFunction[YTILE][XTILE];
 
-    // FFT input/output buffers
-    double *fftReal;
-    fftw_complex *fftComplexIn;
-    fftw_complex *fftComplexOut;
-
-    // FFT plans
-    fftw_plan forwardPlan, inversePlan;
+    // FFT buffers and plans; only the one for the selected precision is allocated
+    std::unique_ptr<FFTBatch<double>> doubleBatch;
+    std::unique_ptr<FFTBatch<float>> floatBatch;
 
     // The combined result of all the FFT processing for each input field.
     // Inverse-FFT results are accumulated into these buffers.
@@ -28,6 +28,7 @@
 #include "transformpal3d.h"
 
 #include <QtMath>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstring>
@@ -54,7 +55,7 @@ static double computeWindow(qint32 element, qint32 limit)
     return 0.5 - (0.5 * cos((2 * M_PI * (element + 0.5)) / limit));
 }
 
-TransformPal3D::TransformPal3D()
+TransformPal3D::TransformPal3D(bool singlePrecision, FFTWEffort effort)
     : TransformPal(XCOMPLEX, YCOMPLEX, ZCOMPLEX)
 {
     // Compute the window function.
@@ -69,25 +70,12 @@ TransformPal3D::TransformPal3D()
         }
     }
 
-    // Allocate buffers for FFTW. These must be allocated using FFTW's own
-    // functions so they're properly aligned for SIMD operations.
-    fftReal = fftw_alloc_real(ZTILE * YTILE * XTILE);
-    fftComplexIn = fftw_alloc_complex(ZCOMPLEX * YCOMPLEX * XCOMPLEX);
-    fftComplexOut = fftw_alloc_complex(ZCOMPLEX * YCOMPLEX * XCOMPLEX);
-
-    // Plan FFTW operations
-    forwardPlan = fftw_plan_dft_r2c_3d(ZTILE, YTILE, XTILE, fftReal, fftComplexIn, FFTW_MEASURE);
-    inversePlan = fftw_plan_dft_c2r_3d(ZTILE, YTILE, XTILE, fftComplexOut, fftReal, FFTW_MEASURE);
-}
-
-TransformPal3D::~TransformPal3D()
-{
-    // Free FFTW plans and buffers
-    fftw_destroy_plan(forwardPlan);
-    fftw_destroy_plan(inversePlan);
-    fftw_free(fftReal);
-    fftw_free(fftComplexIn);
-    fftw_free(fftComplexOut);
+    // Allocate buffers and get FFTW plans
+    if (singlePrecision) {
+        floatBatch = std::make_unique<FFTBatch<float>>(ZTILE, YTILE, XTILE, effort);
+    } else {
+        doubleBatch = std::make_unique<FFTBatch<double>>(ZTILE, YTILE, XTILE, effort);
+    }
 }
 
 qint32 TransformPal3D::getThresholdsSize()
@@ -102,12 +90,27 @@ qint32 TransformPal3D::getLookBehind()
     return (HALFZTILE + 1) / 2;
 }
 
+void TransformPal3D::getRegionMargin(qint32 &xMargin, qint32 &yMargin, qint32 &xAlignment, qint32 &yAlignment)
+{
+    // As for TransformPal2D, except that tiles are in frame lines
+    xMargin = 0;
+    yMargin = YTILE;
+    xAlignment = HALFXTILE;
+    yAlignment = HALFYTILE;
+}
+
 qint32 TransformPal3D::getLookAhead()
 {
     // ... and at most a tile minus one bin into the future.
     return (ZTILE - 1 + 1) / 2;
 }
 
+qint32 TransformPal3D::getBatchAlignment()
+{
+    // Tiles are HALFZTILE fields apart, rounded up to whole frames.
+    return (HALFZTILE + 1) / 2;
+}
+
 void TransformPal3D::filterFields(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
                                   QVector<const double *> &outputFields)
 {
@@ -125,42 +128,120 @@ void TransformPal3D::filterFields(const QVector<SourceField> &inputFields, qint3
     assert(startIndex >= HALFZTILE);
     assert((inputFields.size() - endIndex) >= HALFZTILE);
 
-    // Allocate and clear output buffers
-    chromaBuf.resize(endIndex - startIndex);
+    // The first tile position in Z
+    qint32 firstTileZ = startIndex - HALFZTILE;
+
+    // chromaBuf has a buffer for each output field, followed by HALFZTILE
+    // buffers for the fields after them. If the previous batch's last tile
+    // position covered the same input fields as this batch's first, then it
+    // has already accumulated its results for this batch's first fields into
+    // those extra buffers, so we can rotate them to the front and skip it.
+    qint32 reusedFields = 0;
+    if (hasCarriedFields(inputFields, firstTileZ)) {
+        std::rotate(chromaBuf.begin(), chromaBuf.end() - HALFZTILE, chromaBuf.end());
+        reusedFields = HALFZTILE;
+        firstTileZ += HALFZTILE;
+    }
+
+    // Allocate and clear the rest of the buffers
+    chromaBuf.resize(endIndex - startIndex + HALFZTILE);
     for (qint32 i = 0; i < chromaBuf.size(); i++) {
-        chromaBuf[i].resize(videoParameters.fieldWidth * videoParameters.fieldHeight);
-        chromaBuf[i].fill(0.0);
+        if (i >= reusedFields) {
+            chromaBuf[i].resize(videoParameters.fieldWidth * videoParameters.fieldHeight);
+            chromaBuf[i].fill(0.0);
+        }
 
-        outputFields[i] = chromaBuf[i].data();
+        if (i < outputFields.size()) {
+            outputFields[i] = chromaBuf[i].data();
+        }
     }
 
+    // If a tile position starts HALFZTILE fields before the end of the batch,
+    // the next batch will start with the same tile position, so remember
+    // which fields it covers. (This is only the case if the number of fields
+    // is a multiple of HALFZTILE.)
+    carriedFields.clear();
+    if (((endIndex - startIndex) % HALFZTILE) == 0) {
+        carriedFields = inputFields.mid(endIndex - HALFZTILE, ZTILE);
+    }
+
+    if (floatBatch) {
+        filterFieldsUsing(*floatBatch, inputFields, firstTileZ, startIndex, endIndex);
+    } else {
+        filterFieldsUsing(*doubleBatch, inputFields, firstTileZ, startIndex, endIndex);
+    }
+}
+
+// Return true if the ZTILE input fields starting at tileZ are the ones in carriedFields.
+// The input data is never modified once loaded, so it's enough to check that
+// the samples are at the same address. (carriedFields holds a reference to
+// the data, so it can't have been reused for another field.)
+bool TransformPal3D::hasCarriedFields(const QVector<SourceField> &inputFields, qint32 tileZ) const
+{
+    if (carriedFields.size() != ZTILE) return false;
+
+    for (qint32 z = 0; z < ZTILE; z++) {
+        const SourceField &carried = carriedFields[z];
+        const SourceField &input = inputFields[tileZ + z];
+        if (carried.field.seqNo != input.field.seqNo
+            || carried.data.data() != input.data.data()
+            || carried.data.size() != input.data.size()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename T>
+void TransformPal3D::filterFieldsUsing(FFTBatch<T> &batch, const QVector<SourceField> &inputFields,
+                                       qint32 firstTileZ, qint32 startIndex, qint32 endIndex)
+{
+    // Accumulate results into the extra buffers at the end of chromaBuf if
+    // the next batch may be able to use them
+    const qint32 accumulateEndIndex = carriedFields.isEmpty() ? endIndex : endIndex + HALFZTILE;
+
     // Iterate through the overlapping tile positions, covering the active area.
     // (See TransformPal3D member variable documentation for how the tiling works;
-    // if you change the Z tiling here, also review getLookBehind/getLookAhead above.)
-    for (qint32 tileZ = startIndex - HALFZTILE; tileZ < endIndex; tileZ += HALFZTILE) {
+    // if you change the Z tiling here, also review getLookBehind/getLookAhead/getBatchAlignment above.)
+    for (qint32 tileZ = firstTileZ; tileZ < endIndex; tileZ += HALFZTILE) {
         for (qint32 tileY = videoParameters.firstActiveFrameLine - HALFYTILE; tileY < videoParameters.lastActiveFrameLine; tileY += HALFYTILE) {
-            for (qint32 tileX = videoParameters.activeVideoStart - HALFXTILE; tileX < videoParameters.activeVideoEnd; tileX += HALFXTILE) {
-                // Compute the forward FFT
-                forwardFFTTile(tileX, tileY, tileZ, inputFields);
+            // Process the row of tiles a batch at a time
+            for (qint32 batchX = videoParameters.activeVideoStart - HALFXTILE; batchX < videoParameters.activeVideoEnd;
+                 batchX += BATCH_SIZE * HALFXTILE) {
+                // The last batch in the row may not be full
+                const qint32 numTiles = qMin(BATCH_SIZE, (videoParameters.activeVideoEnd - batchX + HALFXTILE - 1) / HALFXTILE);
+
+                // Compute the forward FFTs
+                for (qint32 tile = 0; tile < numTiles; tile++) {
+                    loadTile(batch, tile, batchX + (tile * HALFXTILE), tileY, tileZ, inputFields);
+                }
+                batch.forward();
 
                 // Apply the frequency-domain filter
-                applyFilter();
+                applyFilter(batch);
 
-                // Compute the inverse FFT
-                inverseFFTTile(tileX, tileY, tileZ, startIndex, endIndex);
+                // Compute the inverse FFTs
+                batch.inverse();
+                for (qint32 tile = 0; tile < numTiles; tile++) {
+                    storeTile(batch, tile, batchX + (tile * HALFXTILE), tileY, tileZ, startIndex, accumulateEndIndex);
+                }
             }
         }
     }
 }
 
-// Apply the forward FFT to an input tile, populating fftComplexIn
-void TransformPal3D::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, const QVector<SourceField> &inputFields)
+// Copy an input tile into the batch, ready for the forward FFT
+template <typename T>
+void TransformPal3D::loadTile(FFTBatch<T> &batch, qint32 tile, qint32 tileX, qint32 tileY, qint32 tileZ,
+                              const QVector<SourceField> &inputFields)
 {
     // Work out which lines of this tile are within the active region
     const qint32 startY = qMax(videoParameters.firstActiveFrameLine - tileY, 0);
     const qint32 endY = qMin(videoParameters.lastActiveFrameLine - tileY, YTILE);
 
-    // Copy the input signal into fftReal, applying the window function
+    // Copy the input signal into the batch, applying the window function
+    T *realPtr = batch.real + tile;
     for (qint32 z = 0; z < ZTILE; z++) {
         const qint32 fieldIndex = tileZ + z;
         const quint16 *inputPtr = inputFields[fieldIndex].data.data();
@@ -172,7 +253,7 @@ void TransformPal3D::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, co
             // field), fill it with black instead.
             if (y < startY || y >= endY || ((tileY + y) % 2) != (fieldIndex % 2)) {
                 for (qint32 x = 0; x < XTILE; x++) {
-                    fftReal[(((z * YTILE) + y) * XTILE) + x] = videoParameters.black16bIre * windowFunction[z][y][x];
+                    realPtr[((((z * YTILE) + y) * XTILE) + x) * BATCH_SIZE] = videoParameters.black16bIre * windowFunction[z][y][x];
                 }
                 continue;
             }
@@ -180,17 +261,16 @@ void TransformPal3D::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, co
             const qint32 fieldLine = (tileY + y) / 2;
             const quint16 *b = inputPtr + (fieldLine * videoParameters.fieldWidth);
             for (qint32 x = 0; x < XTILE; x++) {
-                fftReal[(((z * YTILE) + y) * XTILE) + x] = b[tileX + x] * windowFunction[z][y][x];
+                realPtr[((((z * YTILE) + y) * XTILE) + x) * BATCH_SIZE] = b[tileX + x] * windowFunction[z][y][x];
             }
         }
     }
-
-    // Convert time domain in fftReal to frequency domain in fftComplexIn
-    fftw_execute(forwardPlan);
 }
 
-// Apply the inverse FFT to fftComplexOut, overlaying the result into chromaBuf
-void TransformPal3D::inverseFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, qint32 startIndex, qint32 endIndex)
+// Overlay a tile from the batch after the inverse FFT into the chroma buffers
+template <typename T>
+void TransformPal3D::storeTile(const FFTBatch<T> &batch, qint32 tile, qint32 tileX, qint32 tileY, qint32 tileZ,
+                               qint32 startIndex, qint32 endIndex)
 {
     // Work out what portion of this tile is inside the active area
     const qint32 startX = qMax(videoParameters.activeVideoStart - tileX, 0);
@@ -200,10 +280,8 @@ void TransformPal3D::inverseFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, qi
     const qint32 startZ = qMax(startIndex - tileZ, 0);
     const qint32 endZ = qMin(endIndex - tileZ, ZTILE);
 
-    // Convert frequency domain in fftComplexOut back to time domain in fftReal
-    fftw_execute(inversePlan);
-
     // Overlay the result, normalising the FFTW output, into the chroma buffers
+    const T *realPtr = batch.real + tile;
     for (qint32 z = startZ; z < endZ; z++) {
         const qint32 outputIndex = tileZ + z - startIndex;
         double *outputPtr = chromaBuf[outputIndex].data();
@@ -217,30 +295,24 @@ void TransformPal3D::inverseFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, qi
             const qint32 outputLine = (tileY + y) / 2;
             double *b = outputPtr + (outputLine * videoParameters.fieldWidth);
             for (qint32 x = startX; x < endX; x++) {
-                b[tileX + x] += fftReal[(((z * YTILE) + y) * XTILE) + x] / (ZTILE * YTILE * XTILE);
+                b[tileX + x] += realPtr[((((z * YTILE) + y) * XTILE) + x) * BATCH_SIZE] / (ZTILE * YTILE * XTILE);
             }
         }
     }
 }
 
-// Return the absolute value squared of an fftw_complex
-static inline double fftwAbsSq(const fftw_complex &value)
+// Apply the frequency-domain filter to each tile in the batch.
+template <typename T>
+void TransformPal3D::applyFilter(FFTBatch<T> &batch)
 {
-    return (value[0] * value[0]) + (value[1] * value[1]);
-}
+    using Complex = typename FFTBatch<T>::Complex;
 
-// Apply the frequency-domain filter.
-void TransformPal3D::applyFilter()
-{
     // Get pointer to squared threshold values
     const double *thresholdsPtr = thresholds.data();
 
-    // Clear fftComplexOut. We discard values by default; the filter only
+    // Clear complexOut. We discard values by default; the filter only
     // copies values that look like chroma.
-    for (qint32 i = 0; i < ZCOMPLEX * YCOMPLEX * XCOMPLEX; i++) {
-        fftComplexOut[i][0] = 0.0;
-        fftComplexOut[i][1] = 0.0;
-    }
+    std::fill_n(&batch.complexOut[0][0], ZCOMPLEX * YCOMPLEX * XCOMPLEX * BATCH_SIZE * 2, T(0));
 
     // This is a direct translation of transform_filter from pyctools-pal, with
     // an extra loop added to extend it to 3D. The main simplification is that
@@ -268,12 +340,12 @@ void TransformPal3D::applyFilter()
             const qint32 y_ref = ((YTILE / 4) + YTILE - y) % YTILE;
 
             // Input data for this line and its reflection
-            const fftw_complex *bi = fftComplexIn + (((z * YCOMPLEX) + y) * XCOMPLEX);
-            const fftw_complex *bi_ref = fftComplexIn + (((z_ref * YCOMPLEX) + y_ref) * XCOMPLEX);
+            const Complex *bi = batch.complexIn + (((z * YCOMPLEX) + y) * XCOMPLEX * BATCH_SIZE);
+            const Complex *bi_ref = batch.complexIn + (((z_ref * YCOMPLEX) + y_ref) * XCOMPLEX * BATCH_SIZE);
 
             // Output data for this line and its reflection
-            fftw_complex *bo = fftComplexOut + (((z * YCOMPLEX) + y) * XCOMPLEX);
-            fftw_complex *bo_ref = fftComplexOut + (((z_ref * YCOMPLEX) + y_ref) * XCOMPLEX);
+            Complex *bo = batch.complexOut + (((z * YCOMPLEX) + y) * XCOMPLEX * BATCH_SIZE);
+            Complex *bo_ref = batch.complexOut + (((z_ref * YCOMPLEX) + y_ref) * XCOMPLEX * BATCH_SIZE);
 
             // We only need to look at horizontal frequencies that might be chroma (0.5fSC to 1.5fSC).
             for (qint32 x = XTILE / 8; x <= XTILE / 4; x++) {
@@ -281,34 +353,23 @@ void TransformPal3D::applyFilter()
                 const qint32 x_ref = (XTILE / 2) - x;
 
                 // Get the threshold for this bin
-                const double threshold_sq = *thresholdsPtr++;
+                const T threshold_sq = static_cast<T>(*thresholdsPtr++);
 
-                const fftw_complex &in_val = bi[x];
-                const fftw_complex &ref_val = bi_ref[x_ref];
+                // Input and output values for this bin and its reflection, for all tiles
+                const Complex *in_val = bi + (x * BATCH_SIZE);
+                const Complex *ref_val = bi_ref + (x_ref * BATCH_SIZE);
+                Complex *out_val = bo + (x * BATCH_SIZE);
+                Complex *out_ref_val = bo_ref + (x_ref * BATCH_SIZE);
 
                 if (x == x_ref && y == y_ref && z == z_ref) {
                     // This bin is its own reflection (i.e. it's a carrier). Keep it!
-                    bo[x][0] = in_val[0];
-                    bo[x][1] = in_val[1];
+                    std::copy_n(&in_val[0][0], BATCH_SIZE * 2, &out_val[0][0]);
                     continue;
                 }
 
-                // Get the squares of the magnitudes (to minimise the number of sqrts)
-                const double m_in_sq = fftwAbsSq(in_val);
-                const double m_ref_sq = fftwAbsSq(ref_val);
-
-                // Compare the magnitudes of the two values, and discard
-                // both if they are more different than the threshold for
-                // this bin.
-                if (m_in_sq < m_ref_sq * threshold_sq || m_ref_sq < m_in_sq * threshold_sq) {
-                    // Probably not a chroma signal; throw it away.
-                } else {
-                    // They're similar. Keep it!
-                    bo[x][0] = in_val[0];
-                    bo[x][1] = in_val[1];
-                    bo_ref[x_ref][0] = ref_val[0];
-                    bo_ref[x_ref][1] = ref_val[1];
-                }
+                // Compare the magnitudes of the two values, and keep both if
+                // they're similar; otherwise it's probably not a chroma signal
+                filterBins(in_val, ref_val, out_val, out_ref_val, threshold_sq);
             }
         }
     }
@@ -326,11 +387,24 @@ void TransformPal3D::overlayFFTFrame(qint32 positionX, qint32 positionY,
         return;
     }
 
-    // Compute the forward FFT
-    forwardFFTTile(positionX, positionY, fieldIndex, inputFields);
+    if (floatBatch) {
+        overlayFFTFrameUsing(*floatBatch, positionX, positionY, inputFields, fieldIndex, componentFrame);
+    } else {
+        overlayFFTFrameUsing(*doubleBatch, positionX, positionY, inputFields, fieldIndex, componentFrame);
+    }
+}
+
+template <typename T>
+void TransformPal3D::overlayFFTFrameUsing(FFTBatch<T> &batch, qint32 positionX, qint32 positionY,
+                                          const QVector<SourceField> &inputFields, qint32 fieldIndex,
+                                          ComponentFrame &componentFrame)
+{
+    // Compute the forward FFT, using the first tile of the batch
+    loadTile(batch, 0, positionX, positionY, fieldIndex, inputFields);
+    batch.forward();
 
     // Apply the frequency-domain filter
-    applyFilter();
+    applyFilter(batch);
 
     // Create a canvas
     FrameCanvas canvas(componentFrame, videoParameters);
@@ -340,5 +414,5 @@ void TransformPal3D::overlayFFTFrame(qint32 positionX, qint32 positionY,
     canvas.drawRectangle(positionX - 1, positionY - 1, XTILE + 1, YTILE + 1, green);
 
     // Draw the arrays
-    overlayFFTArrays(fftComplexIn, fftComplexOut, canvas);
+    overlayFFTBatch(batch, 0, canvas);
 }
@@ -30,6 +30,7 @@
 
 #include <QVector>
 #include <fftw3.h>
+#include <memory>
 
 #include "componentframe.h"
 #include "outputwriter.h"
@@ -38,8 +39,10 @@
 
 class TransformPal3D : public TransformPal {
 public:
-    TransformPal3D();
-    ~TransformPal3D();
+    // If singlePrecision is true, the FFTs are computed using floats rather
+    // than doubles, which is faster but slightly less accurate. effort
+    // controls how much time FFTW spends planning the transforms.
+    explicit TransformPal3D(bool singlePrecision = false, FFTWEffort effort = fftwMeasure);
 
     // Return the expected size of the thresholds array.
     static qint32 getThresholdsSize();
@@ -49,16 +52,40 @@ public:
     static qint32 getLookBehind();
     static qint32 getLookAhead();
 
+    // Return the number of frames that batches of input should be a multiple
+    // of. The Z tiling starts at the start of each batch, so the output only
+    // doesn't depend on how the input is batched if this is true.
+    static qint32 getBatchAlignment();
+
+    // Return the margin (in samples and frame lines) that the filter needs
+    // around a region of interest, and the alignment that the start of the
+    // decoded area needs relative to the full active area, for the output
+    // within the region to be the same as when filtering the whole area.
+    static void getRegionMargin(qint32 &xMargin, qint32 &yMargin, qint32 &xAlignment, qint32 &yAlignment);
+
     void filterFields(const QVector<SourceField> &inputFields, qint32 startFieldIndex, qint32 endFieldIndex,
                       QVector<const double *> &outputFields) override;
 
 protected:
-    void forwardFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, const QVector<SourceField> &inputFields);
-    void inverseFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, qint32 startFieldIndex, qint32 endFieldIndex);
-    void applyFilter();
+    bool hasCarriedFields(const QVector<SourceField> &inputFields, qint32 tileZ) const;
+    template <typename T>
+    void filterFieldsUsing(FFTBatch<T> &batch, const QVector<SourceField> &inputFields,
+                           qint32 firstTileZ, qint32 startIndex, qint32 endIndex);
+    template <typename T>
+    void loadTile(FFTBatch<T> &batch, qint32 tile, qint32 tileX, qint32 tileY, qint32 tileZ,
+                  const QVector<SourceField> &inputFields);
+    template <typename T>
+    void storeTile(const FFTBatch<T> &batch, qint32 tile, qint32 tileX, qint32 tileY, qint32 tileZ,
+                   qint32 startIndex, qint32 endIndex);
+    template <typename T>
+    void applyFilter(FFTBatch<T> &batch);
     void overlayFFTFrame(qint32 positionX, qint32 positionY,
                          const QVector<SourceField> &inputFields, qint32 fieldIndex,
                          ComponentFrame &componentFrame) override;
+    template <typename T>
+    void overlayFFTFrameUsing(FFTBatch<T> &batch, qint32 positionX, qint32 positionY,
+                              const QVector<SourceField> &inputFields, qint32 fieldIndex,
+                              ComponentFrame &componentFrame);
 
     // FFT input and output sizes.
     //
@@ -76,28 +103,35 @@ protected:
     static constexpr qint32 XTILE = 16;
     static constexpr qint32 HALFXTILE = XTILE / 2;
 
-    // Each tile is converted to the frequency domain using forwardPlan, which
-    // gives a complex result of size XCOMPLEX x YCOMPLEX x ZCOMPLEX (roughly
-    // half the size of the input, because the input data was real, i.e.
-    // contained no negative frequencies).
+    // Each tile is converted to the frequency domain using a forward FFT,
+    // which gives a complex result of size XCOMPLEX x YCOMPLEX x ZCOMPLEX
+    // (roughly half the size of the input, because the input data was real,
+    // i.e. contained no negative frequencies).
     static constexpr qint32 ZCOMPLEX = ZTILE;
     static constexpr qint32 YCOMPLEX = YTILE;
     static constexpr qint32 XCOMPLEX = (XTILE / 2) + 1;
 
+    // Number of tiles that are transformed together.
+    // Tiles are processed a batch at a time along each row of tiles.
+    static constexpr qint32 BATCH_SIZE = FFTBatch<double>::BATCH_SIZE;
+
     // Window function applied before the FFT
     double windowFunction[ZTILE][YTILE][XTILE];
 
-    // FFT input/output buffers
-    double *fftReal;
-    fftw_complex *fftComplexIn;
-    fftw_complex *fftComplexOut;
-
-    // FFT plans
-    fftw_plan forwardPlan, inversePlan;
+    // FFT buffers and plans; only the one for the selected precision is allocated
+    std::unique_ptr<FFTBatch<double>> doubleBatch;
+    std::unique_ptr<FFTBatch<float>> floatBatch;
 
     // The combined result of all the FFT processing for each input field.
     // Inverse-FFT results are accumulated into these buffers.
+    // There are HALFZTILE extra buffers at the end, holding the results for
+    // the first fields of the next batch from the last tile position of this
+    // one; see filterFields.
     QVector<QVector<double>> chromaBuf;
+
+    // The input fields covered by the last tile position of the previous
+    // batch (or empty if the next batch can't reuse its results)
+    QVector<SourceField> carriedFields;
 };
 
 #endif
@@ -36,8 +36,8 @@ void Stacker::run()
     qint32 frameNumber;
     QVector<qint32> firstFieldSeqNo;
     QVector<qint32> secondFieldSeqNo;
-    QVector<SourceVideo::Data> firstSourceField;
-    QVector<SourceVideo::Data> secondSourceField;
+    QVector<SourceVideo::DataView> firstSourceField;
+    QVector<SourceVideo::DataView> secondSourceField;
     QVector<LdDecodeMetaData::Field> firstFieldMetadata;
     QVector<LdDecodeMetaData::Field> secondFieldMetadata;
     qint32 mode;
@@ -75,7 +75,7 @@ void Stacker::run()
 }
 
 // Method to stack fields
-void Stacker::stackField(const qint32 frameNumber,const QVector<SourceVideo::Data>& inputFields,
+void Stacker::stackField(const qint32 frameNumber,const QVector<SourceVideo::DataView>& inputFields,
                                       const LdDecodeMetaData::VideoParameters& videoParameters,
                                       const QVector<LdDecodeMetaData::Field>& fieldMetadata,
                                       const QVector<qint32> availableSourcesForFrame,
@@ -91,6 +91,15 @@ void Stacker::stackField(const qint32 frameNumber,const QVector<SourceVideo::Dat
     QVector<QVector<quint16>> tmpField(videoParameters.fieldHeight * videoParameters.fieldWidth);
     
     if (availableSourcesForFrame.size() > 0) {
+        // When looking at one sample at a time, map out each source's dropouts
+        // first so they can be looked up directly
+        QVector<QVector<quint8>> dropOutMaps(fieldMetadata.size());
+        if (mode < 3) {
+            for (qint32 source : availableSourcesForFrame) {
+                dropOutMaps[source] = fieldMetadata[source].dropOuts.rasterise(videoParameters.fieldWidth, videoParameters.fieldHeight);
+            }
+        }
+
         // Sources available - process field
         for (qint32 y = 0; y < videoParameters.fieldHeight; y++) {
             for (qint32 x = 0; x < videoParameters.fieldWidth; x++) {
@@ -111,7 +120,7 @@ void Stacker::stackField(const qint32 frameNumber,const QVector<SourceVideo::Dat
                     for (qint32 i = 0; i < availableSourcesForFrame.size(); i++){
                         //read pixel
                         const quint16 pixelValue = inputFields[availableSourcesForFrame[i]][(videoParameters.fieldWidth * y) + x];
-                        const bool sampleIsDropout = isDropout(fieldMetadata[availableSourcesForFrame[i]].dropOuts, x, y);
+                        const bool sampleIsDropout = dropOutMaps[availableSourcesForFrame[i]][(videoParameters.fieldWidth * y) + x] != 0;
                         
                         // Include the source's pixel data if it's not marked as a dropout
                         if (!sampleIsDropout) {
@@ -444,7 +453,7 @@ inline quint16 Stacker::closest(const QVector<quint16>& elements, const qint32 t
 }
 
 // get value that are unprocessed and reuse processed one for mode >= 3
-void Stacker::getProcessedSample(const qint32 x, const qint32 y, const QVector<qint32>& availableSourcesForFrame, const QVector<SourceVideo::Data>& inputFields, QVector<QVector<quint16>>& tmpField, const LdDecodeMetaData::VideoParameters& videoParameters, const QVector<LdDecodeMetaData::Field>& fieldMetadata, QVector<quint16>& sample, QVector<quint16>& sampleN, QVector<quint16>& sampleS, QVector<quint16>& sampleE, QVector<quint16>& sampleW, QVector<bool>& isAllDropout, const bool& noDiffDod, const bool& verbose)
+void Stacker::getProcessedSample(const qint32 x, const qint32 y, const QVector<qint32>& availableSourcesForFrame, const QVector<SourceVideo::DataView>& inputFields, QVector<QVector<quint16>>& tmpField, const LdDecodeMetaData::VideoParameters& videoParameters, const QVector<LdDecodeMetaData::Field>& fieldMetadata, QVector<quint16>& sample, QVector<quint16>& sampleN, QVector<quint16>& sampleS, QVector<quint16>& sampleE, QVector<quint16>& sampleW, QVector<bool>& isAllDropout, const bool& noDiffDod, const bool& verbose)
 {
     quint16 pixelValue = 0;
     qint32 source = 0;
@@ -758,14 +767,8 @@ void Stacker::getProcessedSample(const qint32 x, const qint32 y, const QVector<q
 // Method returns true if specified pixel is a dropout
 inline bool Stacker::isDropout(const DropOuts& dropOuts, const qint32 fieldX, const qint32 fieldY)
 {
-    for (qint32 i = 0; i < dropOuts.size(); i++) {
-        if ((dropOuts.fieldLine(i) - 1) == fieldY) {
-            if ((fieldX >= dropOuts.startx(i)) && (fieldX <= dropOuts.endx(i)))
-                return true;
-        }
-    }
-
-    return false;
+    // DropOuts numbers field lines from 1
+    return dropOuts.isDropout(fieldX, fieldY + 1);
 }
 
 // Method returns true if specified pixel is a dropout
@@ -32,6 +32,7 @@
 
 #include "logging.h"
 #include "correctorpool.h"
+#include "metadataloader.h"
 
 int main(int argc, char *argv[])
 {
@@ -220,17 +221,24 @@ int main(int argc, char *argv[])
         ldDecodeMetaData[i] = new LdDecodeMetaData;
     }
 
+    // Read the metadata files in parallel
+    MetaDataLoader metaDataLoader(maxThreads);
     for (qint32 i = 0; i < totalNumberOfInputFiles; i++) {
         // Work out the metadata filename
         QString jsonFilename = inputFilenames[i] + ".json";
         if (parser.isSet(inputJsonOption) && i == 0) jsonFilename = parser.value(inputJsonOption);
         qInfo().nospace().noquote() << "Reading input #" << i << " JSON metadata from " << jsonFilename;
 
-        // Open it
-        if (!ldDecodeMetaData[i]->read(jsonFilename)) {
-            qCritical() << "Unable to open TBC JSON metadata file - cannot continue";
+        metaDataLoader.add(*ldDecodeMetaData[i], jsonFilename);
+    }
+    metaDataLoader.load();
+
+    for (qint32 i = 0; i < totalNumberOfInputFiles; i++) {
+        if (!metaDataLoader.isLoaded(i)) {
+            qCritical().nospace() << "Unable to open TBC JSON metadata file for input #" << i << " - cannot continue";
             return -1;
         }
+        qInfo().nospace() << "Read input #" << i << " JSON metadata in " << metaDataLoader.getLoadTime(i) << " ms";
     }
 
     // Reverse field order if required
@@ -265,6 +273,9 @@ int main(int argc, char *argv[])
         qInfo().nospace() << "Opening input #" << i << ": " << videoParameters.fieldWidth << "x" << videoParameters.fieldHeight <<
                     " - input filename is " << inputFilenames[i];
 
+        // Read ahead enough fields to keep all the worker threads busy
+        sourceVideos[i]->setReadAhead(4 * maxThreads);
+
         // Open the source TBC
         if (!sourceVideos[i]->open(inputFilenames[i], videoParameters.fieldWidth * videoParameters.fieldHeight)) {
             // Could not open source video file
@@ -55,9 +55,18 @@ bool DecoderPool::process()
     // Show some information for the user
     qInfo() << "Using" << maxThreads << "threads to process" << ldDecodeMetaData.getNumberOfFields() << "fields";
 
+    // Journal the updates to the metadata as we go, so that if this run is
+    // interrupted, the next one can resume from where it stopped
+    if (!ldDecodeMetaData.openJournal(outputJsonFilename)) {
+        sourceVideo.close();
+        return false;
+    }
+
     // Initialise processing state
-    inputFieldNumber = 1;
+    inputFieldNumber = ldDecodeMetaData.getFirstIncompleteJournalField();
     lastFieldNumber = ldDecodeMetaData.getNumberOfFields();
+    batchFieldNumber = inputFieldNumber;
+    batchFieldData.clear();
     totalTimer.start();
 
     // Start a vector of decoding threads to process the video
@@ -87,7 +96,14 @@ bool DecoderPool::process()
 
     // Write the JSON metadata file
     qInfo() << "Writing JSON metadata file...";
-    ldDecodeMetaData.write(outputJsonFilename);
+    if (!ldDecodeMetaData.write(outputJsonFilename)) {
+        qCritical() << "Writing JSON metadata file failed";
+        sourceVideo.close();
+        return false;
+    }
+
+    // The journal isn't needed now the output is complete
+    ldDecodeMetaData.closeJournal();
     qInfo() << "VBI processing complete";
 
     // Close the source video
@@ -116,8 +132,16 @@ bool DecoderPool::getInputField(qint32 &fieldNumber, SourceVideo::Data &fieldVid
     // Show what we are about to process
     qDebug() << "DecoderPool::process(): Processing field number" << fieldNumber;
 
+    // If we've used up the last batch of input data, read the lines we need
+    // from the next batch of fields in one go
+    if (fieldNumber >= batchFieldNumber + batchFieldData.size()) {
+        batchFieldNumber = fieldNumber;
+        batchFieldData = sourceVideo.getVideoFieldLines(fieldNumber, qMin(BATCH_SIZE, lastFieldNumber + 1 - fieldNumber),
+                                                        VbiLineDecoder::startFieldLine, VbiLineDecoder::endFieldLine);
+    }
+
     // Fetch the input data
-    fieldVideoData = sourceVideo.getVideoField(fieldNumber, VbiLineDecoder::startFieldLine, VbiLineDecoder::endFieldLine);
+    fieldVideoData = batchFieldData[fieldNumber - batchFieldNumber];
     fieldMetadata = ldDecodeMetaData.getField(fieldNumber);
     videoParameters = ldDecodeMetaData.getVideoParameters();
 
@@ -136,6 +160,7 @@ bool DecoderPool::setOutputField(qint32 fieldNumber, const LdDecodeMetaData::Fie
     ldDecodeMetaData.updateFieldNtsc(fieldMetadata.ntsc, fieldNumber);
     ldDecodeMetaData.updateFieldVitc(fieldMetadata.vitc, fieldNumber);
     ldDecodeMetaData.updateFieldClosedCaption(fieldMetadata.closedCaption, fieldNumber);
+    ldDecodeMetaData.completeJournalField(fieldNumber);
 
     return true;
 }
@@ -63,6 +63,11 @@ private:
     LdDecodeMetaData &ldDecodeMetaData;
     SourceVideo sourceVideo;
 
+    // Field lines read from the input in advance, starting at batchFieldNumber
+    static constexpr qint32 BATCH_SIZE = 64;
+    qint32 batchFieldNumber;
+    QVector<SourceVideo::Data> batchFieldData;
+
     // Output stream information (all guarded by outputMutex while threads are running)
     QMutex outputMutex;
     QFile targetJson;
@@ -138,8 +138,10 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    // If we're overwriting the input JSON file, back it up first
-    if (inputJsonFilename == outputJsonFilename && !noBackup) {
+    // If we're overwriting the input JSON file, back it up first (unless we're
+    // resuming an interrupted run, which will already have done so)
+    const bool isResuming = metaData.canResumeJournal(outputJsonFilename);
+    if (inputJsonFilename == outputJsonFilename && !noBackup && !isResuming) {
         qInfo().nospace().noquote() << "Backing up JSON metadata to " << inputJsonFilename << ".vbup";
         if (!QFile::copy(inputJsonFilename, inputJsonFilename + ".vbup")) {
             qCritical() << "Unable to back-up input JSON metadata file - back-up already exists?";
@@ -55,9 +55,18 @@ bool ProcessingPool::process()
     // Show some information for the user
     qInfo() << "Using" << maxThreads << "threads to process" << ldDecodeMetaData.getNumberOfFields() << "fields";
 
+    // Journal the updates to the metadata as we go, so that if this run is
+    // interrupted, the next one can resume from where it stopped
+    if (!ldDecodeMetaData.openJournal(outputJsonFilename)) {
+        sourceVideo.close();
+        return false;
+    }
+
     // Initialise processing state
-    inputFieldNumber = 1;
+    inputFieldNumber = ldDecodeMetaData.getFirstIncompleteJournalField();
     lastFieldNumber = ldDecodeMetaData.getNumberOfFields();
+    batchFieldNumber = inputFieldNumber;
+    batchFieldData.clear();
     totalTimer.start();
 
     // Start a vector of decoding threads to process the video
@@ -87,7 +96,14 @@ bool ProcessingPool::process()
 
     // Write the JSON metadata file
     qInfo() << "Writing JSON metadata file...";
-    ldDecodeMetaData.write(outputJsonFilename);
+    if (!ldDecodeMetaData.write(outputJsonFilename)) {
+        qCritical() << "Writing JSON metadata file failed";
+        sourceVideo.close();
+        return false;
+    }
+
+    // The journal isn't needed now the output is complete
+    ldDecodeMetaData.closeJournal();
     qInfo() << "VITS processing complete";
 
     // Close the source video
@@ -115,8 +131,16 @@ bool ProcessingPool::getInputField(qint32 &fieldNumber, SourceVideo::Data &field
     // Show what we are about to process
     //qDebug() << "Processing field number" << fieldNumber;
 
+    // If we've used up the last batch of input data, read the lines we need
+    // from the next batch of fields in one go
+    if (fieldNumber >= batchFieldNumber + batchFieldData.size()) {
+        batchFieldNumber = fieldNumber;
+        batchFieldData = sourceVideo.getVideoFieldLines(fieldNumber, qMin(BATCH_SIZE, lastFieldNumber + 1 - fieldNumber),
+                                                        VitsAnalyser::startFieldLine, VitsAnalyser::endFieldLine);
+    }
+
     // Fetch the input data
-    fieldVideoData = sourceVideo.getVideoField(fieldNumber);
+    fieldVideoData = batchFieldData[fieldNumber - batchFieldNumber];
     fieldMetadata = ldDecodeMetaData.getField(fieldNumber);
     videoParameters = ldDecodeMetaData.getVideoParameters();
 
@@ -132,6 +156,7 @@ bool ProcessingPool::setOutputField(qint32 fieldNumber, LdDecodeMetaData::Field
 
     // Save the field data to the metadata (only VITS metrics metadata is affected)
     ldDecodeMetaData.updateFieldVitsMetrics(fieldMetadata.vitsMetrics, fieldNumber);
+    ldDecodeMetaData.completeJournalField(fieldNumber);
 
     return true;
 }
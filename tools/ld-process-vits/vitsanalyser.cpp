@@ -112,13 +112,13 @@ void VitsAnalyser::run()
 QVector<double> VitsAnalyser::getFieldLineSlice(const SourceVideo::Data &sourceField, qint32 fieldLine, qint32 startUs, qint32 lengthUs)
 {
     QVector<double> returnData;
-    fieldLine--; // Adjust for field offset
 
     // Range-check the field line
-    if (fieldLine < 0 || fieldLine >= videoParameters.fieldHeight) {
+    if (fieldLine < startFieldLine || fieldLine > endFieldLine) {
         qWarning() << "Cannot generate field-line data, line number is out of bounds! Scan line =" << fieldLine;
         return returnData;
     }
+    fieldLine -= startFieldLine; // Adjust for field offset
 
     // Calculate the number of samples per uS for the field
     double samplesPerUs = 0;
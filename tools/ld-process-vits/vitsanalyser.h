@@ -43,6 +43,10 @@ class VitsAnalyser : public QThread {
 public:
     explicit VitsAnalyser(QAtomicInt& _abort, ProcessingPool& _processingPool, QObject *parent = nullptr);
 
+    // The range of field lines needed from the input file (1-based, inclusive)
+    static constexpr qint32 startFieldLine = 1;
+    static constexpr qint32 endFieldLine = 22;
+
 protected:
     void run() override;
 
@@ -0,0 +1,161 @@
+/************************************************************************
+
+    binaryio.cpp
+
+    ld-decode-tools TBC library
+    Copyright (C) 2026 agent
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "binaryio.h"
+
+#include <cstring>
+
+// Size of the BinaryWriter's buffer
+static constexpr size_t WRITE_BUFFER_SIZE = 64 * 1024;
+
+BinaryReader::BinaryReader(const char *_data, qint64 _size)
+    : data(_data), size(_size), position(0)
+{
+}
+
+void BinaryReader::read(qint32 &value)
+{
+    readBytes(&value, sizeof(value));
+}
+
+void BinaryReader::read(quint32 &value)
+{
+    readBytes(&value, sizeof(value));
+}
+
+void BinaryReader::read(qint64 &value)
+{
+    readBytes(&value, sizeof(value));
+}
+
+void BinaryReader::read(double &value)
+{
+    readBytes(&value, sizeof(value));
+}
+
+void BinaryReader::read(bool &value)
+{
+    quint8 byte;
+    readBytes(&byte, sizeof(byte));
+    if (byte > 1) throwError("invalid boolean value");
+    value = (byte != 0);
+}
+
+// Strings are stored as a length in bytes, followed by UTF-8 data
+void BinaryReader::read(QString &value)
+{
+    qint32 length;
+    read(length);
+    if (length < 0 || length > size - position) throwError("invalid string length");
+
+    value = QString::fromUtf8(data + position, length);
+    position += length;
+}
+
+// Arrays are stored as a count, followed by the values
+void BinaryReader::read(QVector<qint32> &values)
+{
+    qint32 count;
+    read(count);
+    if (count < 0 || count > (size - position) / static_cast<qint64>(sizeof(qint32))) {
+        throwError("invalid array length");
+    }
+
+    values.resize(count);
+    readBytes(values.data(), count * static_cast<qint64>(sizeof(qint32)));
+}
+
+void BinaryReader::readBytes(void *buffer, qint64 length)
+{
+    if (length > size - position) throwError("unexpected end of input");
+
+    if (length > 0) memcpy(buffer, data + position, length);
+    position += length;
+}
+
+BinaryWriter::BinaryWriter(QIODevice &_output)
+    : output(_output), failed(false)
+{
+    buf.reserve(WRITE_BUFFER_SIZE);
+}
+
+BinaryWriter::~BinaryWriter()
+{
+    flush();
+}
+
+void BinaryWriter::write(qint32 value)
+{
+    writeBytes(&value, sizeof(value));
+}
+
+void BinaryWriter::write(quint32 value)
+{
+    writeBytes(&value, sizeof(value));
+}
+
+void BinaryWriter::write(qint64 value)
+{
+    writeBytes(&value, sizeof(value));
+}
+
+void BinaryWriter::write(double value)
+{
+    writeBytes(&value, sizeof(value));
+}
+
+void BinaryWriter::write(bool value)
+{
+    const quint8 byte = value ? 1 : 0;
+    writeBytes(&byte, sizeof(byte));
+}
+
+void BinaryWriter::write(const QString &value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    write(static_cast<qint32>(utf8.size()));
+    writeBytes(utf8.constData(), utf8.size());
+}
+
+void BinaryWriter::write(const QVector<qint32> &values)
+{
+    write(static_cast<qint32>(values.size()));
+    writeBytes(values.constData(), values.size() * static_cast<qint64>(sizeof(qint32)));
+}
+
+bool BinaryWriter::flush()
+{
+    if (!buf.empty()) {
+        if (output.write(buf.data(), static_cast<qint64>(buf.size())) != static_cast<qint64>(buf.size())) failed = true;
+        buf.clear();
+    }
+
+    return !failed;
+}
+
+void BinaryWriter::writeBytes(const void *buffer, qint64 length)
+{
+    buf.append(static_cast<const char *>(buffer), length);
+    if (buf.size() >= WRITE_BUFFER_SIZE) flush();
+}
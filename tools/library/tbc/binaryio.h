@@ -0,0 +1,128 @@
+/************************************************************************
+
+    binaryio.h
+
+    ld-decode-tools TBC library
+    Copyright (C) 2026 agent
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef BINARYIO_H
+#define BINARYIO_H
+
+#include <QIODevice>
+#include <QString>
+#include <QVector>
+#include <stdexcept>
+#include <string>
+
+// Reader and writer for the compact binary metadata format.
+//
+// Values are stored in the host's native byte order, with no padding or
+// type information; the reader must read exactly the sequence of values that
+// the writer wrote. Files carry a byte-order marker in their header, so that
+// a file written on a different kind of machine is detected and ignored.
+
+class BinaryReader
+{
+public:
+    // Read from a block of memory (e.g. a memory-mapped file)
+    BinaryReader(const char *_data, qint64 _size);
+
+    // Exception class to be thrown when reading fails
+    class Error : public std::runtime_error
+    {
+    public:
+        Error(std::string message) : std::runtime_error(message) {}
+    };
+
+    // Throw an Error exception with the given message
+    [[noreturn]] void throwError(std::string message) {
+        throw Error(message + " at byte " + std::to_string(position));
+    }
+
+    // Numbers
+    void read(qint32 &value);
+    void read(quint32 &value);
+    void read(qint64 &value);
+    void read(double &value);
+
+    // Booleans
+    void read(bool &value);
+
+    // Strings
+    void read(QString &value);
+
+    // Arrays of integers
+    void read(QVector<qint32> &values);
+
+    // Return the current position in the input
+    qint64 getPosition() const {
+        return position;
+    }
+
+    // Return true if all the input has been read
+    bool atEnd() const {
+        return position == size;
+    }
+
+private:
+    void readBytes(void *buffer, qint64 length);
+
+    const char *data;
+    qint64 size;
+    qint64 position;
+};
+
+class BinaryWriter
+{
+public:
+    BinaryWriter(QIODevice &_output);
+    ~BinaryWriter();
+
+    // Numbers
+    void write(qint32 value);
+    void write(quint32 value);
+    void write(qint64 value);
+    void write(double value);
+
+    // Booleans
+    void write(bool value);
+
+    // Strings
+    void write(const QString &value);
+
+    // Arrays of integers
+    void write(const QVector<qint32> &values);
+
+    // Write any buffered data to the output.
+    // Returns false if writing failed.
+    bool flush();
+
+private:
+    void writeBytes(const void *buffer, qint64 length);
+
+    // The output device
+    QIODevice &output;
+
+    // Buffer for output, to minimise the number of writes to the device
+    std::string buf;
+    bool failed;
+};
+
+#endif
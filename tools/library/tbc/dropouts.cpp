@@ -24,8 +24,10 @@
 
 #include "dropouts.h"
 
+#include "binaryio.h"
 #include "jsonio.h"
 
+#include <algorithm>
 #include <cassert>
 
 DropOuts::DropOuts(const QVector<qint32> &startx, const QVector<qint32> &endx, const QVector<qint32> &fieldLine)
@@ -33,6 +35,12 @@ DropOuts::DropOuts(const QVector<qint32> &startx, const QVector<qint32> &endx, c
 {
 }
 
+DropOuts::DropOuts(const DropOuts &inDropouts)
+    : m_startx(inDropouts.m_startx), m_endx(inDropouts.m_endx), m_fieldLine(inDropouts.m_fieldLine),
+      m_index(std::atomic_load(&inDropouts.m_index))
+{
+}
+
 DropOuts::DropOuts(int reserve_size)
     : m_startx(), m_endx(), m_fieldLine()
 {
@@ -47,7 +55,9 @@ DropOuts& DropOuts::operator=(const DropOuts &inDropouts)
         // Copy the object's data
         m_startx = inDropouts.m_startx;
         m_endx = inDropouts.m_endx;
-        m_fieldLine = inDropouts.m_fieldLine;;
+        m_fieldLine = inDropouts.m_fieldLine;
+
+        m_index = std::atomic_load(&inDropouts.m_index);
     }
 
     return *this;
@@ -59,6 +69,7 @@ void DropOuts::append(const qint32 startx, const qint32 endx, const qint32 field
     m_startx.append(startx);
     m_endx.append(endx);
     m_fieldLine.append(fieldLine);
+    clearIndex();
 }
 
 void DropOuts::reserve(int size)
@@ -74,6 +85,7 @@ void DropOuts::resize(qint32 size)
     m_startx.resize(size);
     m_endx.resize(size);
     m_fieldLine.resize(size);
+    clearIndex();
 }
 
 // Clear the DropOuts record
@@ -82,6 +94,7 @@ void DropOuts::clear()
     m_startx.clear();
     m_endx.clear();
     m_fieldLine.clear();
+    clearIndex();
 }
 
 // Method to concatenate dropouts on the same line that are close together
@@ -92,6 +105,7 @@ void DropOuts::clear()
 void DropOuts::concatenate(const bool verbose)
 {
     qint32 sizeAtStart = m_startx.size();
+    clearIndex();
 
     // This variable controls the minimum allowed gap between dropouts
     // if the gap between the end of the last dropout and the start of
@@ -123,6 +137,96 @@ void DropOuts::concatenate(const bool verbose)
     if(verbose){qDebug() << "Concatenated dropouts: was" << sizeAtStart << "now" << m_startx.size() << "dropouts";}
 }
 
+// Return true if the sample at x on fieldLine is part of a dropout
+bool DropOuts::isDropout(qint32 x, qint32 fieldLine) const
+{
+    // Build the index if this is the first call. If several threads get here
+    // at once, they'll each build the same index, and one of them is kept.
+    std::shared_ptr<const Index> index = std::atomic_load(&m_index);
+    if (index == nullptr) {
+        index = buildIndex();
+        std::atomic_store(&m_index, index);
+    }
+
+    // Find the line
+    const auto line = std::lower_bound(index->lines.cbegin(), index->lines.cend(), fieldLine);
+    if (line == index->lines.cend() || *line != fieldLine) return false;
+    const qint32 lineIndex = static_cast<qint32>(line - index->lines.cbegin());
+
+    // Find the last dropout on the line that starts at or before x. Since
+    // they don't overlap, that's the only one that can contain x.
+    const auto first = index->startx.cbegin() + index->offsets[lineIndex];
+    const auto last = index->startx.cbegin() + index->offsets[lineIndex + 1];
+    const auto next = std::upper_bound(first, last, x);
+    if (next == first) return false;
+
+    return x <= index->endx[static_cast<qint32>(next - index->startx.cbegin()) - 1];
+}
+
+// Build the per-line index
+std::shared_ptr<const DropOuts::Index> DropOuts::buildIndex() const
+{
+    auto index = std::make_shared<Index>();
+
+    // Sort the dropouts by line and position
+    QVector<qint32> order;
+    order.reserve(m_startx.size());
+    for (qint32 i = 0; i < m_startx.size(); i++) {
+        // Ignore any that can't contain a sample
+        if (m_endx[i] >= m_startx[i]) order.append(i);
+    }
+    std::sort(order.begin(), order.end(), [this](qint32 a, qint32 b) {
+        if (m_fieldLine[a] != m_fieldLine[b]) return m_fieldLine[a] < m_fieldLine[b];
+        return m_startx[a] < m_startx[b];
+    });
+
+    // Copy them into the index, merging any that overlap or touch
+    for (qint32 i : order) {
+        const qint32 fieldLine = m_fieldLine[i];
+        if (index->lines.empty() || index->lines.last() != fieldLine) {
+            // Start a new line
+            index->lines.append(fieldLine);
+            index->offsets.append(index->startx.size());
+        } else if (m_startx[i] <= index->endx.last() + 1) {
+            // Extend the previous dropout
+            index->endx.last() = qMax(index->endx.last(), m_endx[i]);
+            continue;
+        }
+
+        index->startx.append(m_startx[i]);
+        index->endx.append(m_endx[i]);
+    }
+    if (!index->lines.empty()) index->offsets.append(index->startx.size());
+
+    return index;
+}
+
+// Discard the per-line index
+void DropOuts::clearIndex()
+{
+    m_index.reset();
+}
+
+// Return a map of the dropouts in a field
+QVector<quint8> DropOuts::rasterise(qint32 fieldWidth, qint32 fieldHeight) const
+{
+    QVector<quint8> map(fieldWidth * fieldHeight, 0);
+
+    for (qint32 i = 0; i < m_startx.size(); i++) {
+        // Field lines are numbered from 1; ignore any parts outside the field
+        const qint32 y = m_fieldLine[i] - 1;
+        if (y < 0 || y >= fieldHeight) continue;
+        const qint32 startx = qMax(m_startx[i], 0);
+        const qint32 endx = qMin(m_endx[i], fieldWidth - 1);
+        if (endx < startx) continue;
+
+        quint8 *line = map.data() + (y * fieldWidth);
+        std::fill(line + startx, line + endx + 1, 1);
+    }
+
+    return map;
+}
+
 // Custom debug streaming operator
 QDebug operator<<(QDebug dbg, DropOuts &dropOuts)
 {
@@ -154,6 +258,8 @@ void DropOuts::read(JsonReader &reader)
     }
 
     reader.endObject();
+
+    clearIndex();
 }
 
 // Write DropOuts to JSON
@@ -174,6 +280,28 @@ void DropOuts::write(JsonWriter &writer) const
     writer.endObject();
 }
 
+// Read DropOuts from binary metadata
+void DropOuts::read(BinaryReader &reader)
+{
+    reader.read(m_startx);
+    reader.read(m_endx);
+    reader.read(m_fieldLine);
+
+    if (m_endx.size() != m_fieldLine.size() || m_endx.size() != m_startx.size()) {
+        reader.throwError("dropout array sizes do not match");
+    }
+
+    clearIndex();
+}
+
+// Write DropOuts to binary metadata
+void DropOuts::write(BinaryWriter &writer) const
+{
+    writer.write(m_startx);
+    writer.write(m_endx);
+    writer.write(m_fieldLine);
+}
+
 // Read an array of values from JSON
 void DropOuts::readArray(JsonReader &reader, QVector<qint32> &array)
 {
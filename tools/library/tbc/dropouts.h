@@ -28,7 +28,10 @@
 #include <QDebug>
 #include <QtGlobal>
 #include <QMetaType>
+#include <memory>
 
+class BinaryReader;
+class BinaryWriter;
 class JsonReader;
 class JsonWriter;
 
@@ -38,7 +41,7 @@ public:
     DropOuts() = default;
     DropOuts(int reserve);
     ~DropOuts() = default;
-    DropOuts(const DropOuts &) = default;
+    DropOuts(const DropOuts &inDropouts);
 
     DropOuts(const QVector<qint32> &startx, const QVector<qint32> &endx, const QVector<qint32> &fieldLine);
     DropOuts &operator=(const DropOuts &);
@@ -70,14 +73,49 @@ public:
         return m_fieldLine[index];
     }
 
+    // Return true if the sample at x on fieldLine is part of a dropout.
+    // The first call builds a per-line index, which is used until the
+    // dropouts are changed. This is safe to call from several threads.
+    bool isDropout(qint32 x, qint32 fieldLine) const;
+
+    // Return true if the per-line index has been built
+    bool hasIndex() const {
+        return std::atomic_load(&m_index) != nullptr;
+    }
+
+    // Return a map of the dropouts in a field, with one byte per sample (in
+    // the same layout as the field's data), set to 1 for samples in dropouts
+    QVector<quint8> rasterise(qint32 fieldWidth, qint32 fieldHeight) const;
+
     void read(JsonReader &reader);
     void write(JsonWriter &writer) const;
+    void read(BinaryReader &reader);
+    void write(BinaryWriter &writer) const;
 
 private:
     QVector<qint32> m_startx;
     QVector<qint32> m_endx;
     QVector<qint32> m_fieldLine;
 
+    // Per-line index: lines lists the field lines that have dropouts, in
+    // order. The dropouts on lines[i] are merged and sorted by position, and
+    // stored in startx/endx from offsets[i] up to (but not including)
+    // offsets[i + 1].
+    struct Index {
+        QVector<qint32> lines;
+        QVector<qint32> offsets;
+        QVector<qint32> startx;
+        QVector<qint32> endx;
+    };
+
+    // The index, or nullptr if it hasn't been built yet. Once built it isn't
+    // changed, so copies can share it; it's only read and set through
+    // std::atomic_load/atomic_store, so const methods can build it.
+    mutable std::shared_ptr<const Index> m_index;
+
+    std::shared_ptr<const Index> buildIndex() const;
+    void clearIndex();
+
     void readArray(JsonReader &reader, QVector<qint32> &array);
     void writeArray(JsonWriter &writer, const QVector<qint32> &array) const;
 };
@@ -0,0 +1,124 @@
+/************************************************************************
+
+    fieldcache.cpp
+
+    ld-decode-tools TBC library
+    Copyright (C) 2026 agent
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "fieldcache.h"
+
+#include <climits>
+
+FieldCache::FieldCache(qint64 _maxBytes)
+    : hits(0), misses(0)
+{
+    setMaxBytes(_maxBytes);
+}
+
+bool FieldCache::lookup(qint32 fieldNumber, Data &data)
+{
+    Shard &shard = shardFor(fieldNumber);
+    QMutexLocker locker(&shard.mutex);
+
+    const Data *cached = shard.cache.object(fieldNumber);
+    if (cached == nullptr) {
+        misses.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    data = *cached;
+    hits.fetchAndAddRelaxed(1);
+    return true;
+}
+
+bool FieldCache::contains(qint32 fieldNumber) const
+{
+    const Shard &shard = shardFor(fieldNumber);
+    QMutexLocker locker(&shard.mutex);
+
+    return shard.cache.contains(fieldNumber);
+}
+
+void FieldCache::insert(qint32 fieldNumber, const Data &data)
+{
+    Shard &shard = shardFor(fieldNumber);
+    QMutexLocker locker(&shard.mutex);
+
+    // The cost of each entry is its size in bytes. If it's too big for the
+    // shard, QCache will discard it.
+    shard.cache.insert(fieldNumber, new Data(data), data.size() * static_cast<qint32>(sizeof(quint16)));
+}
+
+void FieldCache::clear()
+{
+    for (Shard &shard : shards) {
+        QMutexLocker locker(&shard.mutex);
+        shard.cache.clear();
+    }
+}
+
+// Get the size limit, in bytes
+qint64 FieldCache::getMaxBytes() const
+{
+    return maxBytes;
+}
+
+// Set the size limit, in bytes. If the cache is already bigger than this,
+// the least recently used fields will be evicted.
+void FieldCache::setMaxBytes(qint64 _maxBytes)
+{
+    maxBytes = qMax(static_cast<qint64>(0), _maxBytes);
+
+    // Each shard gets an equal share of the limit (and QCache's cost is an int)
+    const qint32 shardBytes = static_cast<qint32>(qMin(maxBytes / NUM_SHARDS, static_cast<qint64>(INT_MAX)));
+    for (Shard &shard : shards) {
+        QMutexLocker locker(&shard.mutex);
+        shard.cache.setMaxCost(shardBytes);
+    }
+}
+
+// Get the number of lookups that found the field in the cache
+qint64 FieldCache::getHits() const
+{
+    return hits;
+}
+
+// Get the number of lookups that didn't find the field in the cache
+qint64 FieldCache::getMisses() const
+{
+    return misses;
+}
+
+void FieldCache::resetStatistics()
+{
+    hits = 0;
+    misses = 0;
+}
+
+FieldCache::Shard &FieldCache::shardFor(qint32 fieldNumber)
+{
+    // Consecutive fields go to different shards
+    return shards[static_cast<quint32>(fieldNumber) % NUM_SHARDS];
+}
+
+const FieldCache::Shard &FieldCache::shardFor(qint32 fieldNumber) const
+{
+    return shards[static_cast<quint32>(fieldNumber) % NUM_SHARDS];
+}
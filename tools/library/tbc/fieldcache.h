@@ -0,0 +1,95 @@
+/************************************************************************
+
+    fieldcache.h
+
+    ld-decode-tools TBC library
+    Copyright (C) 2026 agent
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef FIELDCACHE_H
+#define FIELDCACHE_H
+
+#include <QtGlobal>
+#include <QAtomicInteger>
+#include <QCache>
+#include <QMutex>
+#include <QVector>
+
+// A thread-safe cache of video fields, indexed by field number, with a
+// limit on the total size of the cached data in bytes.
+//
+// The cache is split into shards by field number, each with its own lock, so
+// threads working on different fields don't contend with each other. Since
+// fields are stored as implicitly-shared QVectors, lookups don't copy the
+// sample data.
+class FieldCache
+{
+public:
+    using Data = QVector<quint16>;
+
+    // Default size limit, in bytes
+    static constexpr qint64 DEFAULT_MAX_BYTES = 128 * 1024 * 1024;
+
+    explicit FieldCache(qint64 _maxBytes = DEFAULT_MAX_BYTES);
+
+    // Prevent copying or assignment
+    FieldCache(const FieldCache &) = delete;
+    FieldCache& operator=(const FieldCache &) = delete;
+
+    // Look up a field. If it's present, set data to it and return true.
+    // This updates the hit/miss statistics.
+    bool lookup(qint32 fieldNumber, Data &data);
+
+    // Return true if a field is present (without updating the statistics)
+    bool contains(qint32 fieldNumber) const;
+
+    // Add a field to the cache, replacing any existing entry, and evicting
+    // the least recently used fields if necessary
+    void insert(qint32 fieldNumber, const Data &data);
+
+    // Remove all fields from the cache
+    void clear();
+
+    // Get and set methods
+    qint64 getMaxBytes() const;
+    void setMaxBytes(qint64 _maxBytes);
+    qint64 getHits() const;
+    qint64 getMisses() const;
+    void resetStatistics();
+
+private:
+    // Number of independently-locked shards
+    static constexpr qint32 NUM_SHARDS = 8;
+
+    struct Shard {
+        mutable QMutex mutex;
+        QCache<qint32, Data> cache;
+    };
+
+    qint64 maxBytes;
+    Shard shards[NUM_SHARDS];
+
+    QAtomicInteger<qint64> hits;
+    QAtomicInteger<qint64> misses;
+
+    Shard &shardFor(qint32 fieldNumber);
+    const Shard &shardFor(qint32 fieldNumber) const;
+};
+
+#endif // FIELDCACHE_H
@@ -24,15 +24,22 @@
 
 #include "jsonio.h"
 
+#include <charconv>
+#include <cstring>
 #include <limits>
+// Floating-point from_chars arrived later than the integer version
 #if (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || (defined(__GNUC__) && __GNUC__ >= 11 && __cplusplus >= 201703L)
 #define USE_CHARCONV
 #endif
-#ifdef USE_CHARCONV
-#include <charconv>
-#else
+#ifndef USE_CHARCONV
 #include <sstream>
 #endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Size of the blocks read from an input stream
+static constexpr size_t READ_BLOCK_SIZE = 64 * 1024;
 
 // Recognise JSON space characters
 static bool isAsciiSpace(char c)
@@ -46,8 +53,54 @@ static bool isAsciiDigit(char c)
     return c >= '0' && c <= '9';
 }
 
+// Recognise characters that can appear in a JSON number
+static bool isNumberChar(char c)
+{
+    return isAsciiDigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+// Skip over JSON space characters, returning a pointer to the first
+// non-space character (or end)
+static const char *skipSpaces(const char *p, const char *end)
+{
+    // Most values are preceded by at most one space, so check that first
+    if (p == end || !isAsciiSpace(*p)) return p;
+    ++p;
+
+#ifdef __SSE2__
+    // Check 16 characters at a time, for indented JSON
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    while (end - p >= 16) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i spaces = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, space), _mm_cmpeq_epi8(chars, tab)),
+                                            _mm_or_si128(_mm_cmpeq_epi8(chars, newline), _mm_cmpeq_epi8(chars, cr)));
+        const unsigned int notSpaces = ~static_cast<unsigned int>(_mm_movemask_epi8(spaces)) & 0xFFFF;
+        if (notSpaces != 0) {
+            // Find the first non-space character
+            unsigned int offset = 0;
+            while ((notSpaces & (1u << offset)) == 0) ++offset;
+            return p + offset;
+        }
+        p += 16;
+    }
+#endif
+
+    while (p != end && isAsciiSpace(*p)) ++p;
+    return p;
+}
+
 JsonReader::JsonReader(std::istream &_input)
-    : input(_input), position(0), atStart(true)
+    : input(&_input), storage(READ_BLOCK_SIZE), blockStart(storage.data()), cur(blockStart), end(blockStart),
+      blockPosition(0), atEof(false), atStart(true)
+{
+}
+
+JsonReader::JsonReader(const char *_data, size_t _size)
+    : input(nullptr), blockStart(_data), cur(_data), end(_data + _size),
+      blockPosition(0), atEof(false), atStart(true)
 {
 }
 
@@ -201,33 +254,70 @@ void JsonReader::discard()
     }
 }
 
-// Get the next input character, returning 0 on EOF or error
-char JsonReader::get()
-{
-    char c;
-    input.get(c);
-    if (!input.good()) return 0;
-    ++position;
-    return c;
-}
-
 // Get the next input character, discarding spaces before it
 char JsonReader::spaceGet()
 {
-    char c;
-    do {
-        c = get();
-    } while (isAsciiSpace(c));
-    return c;
+    while (true) {
+        cur = skipSpaces(cur, end);
+        if (cur != end) break;
+        if (!fill(1)) {
+            atEof = true;
+            return 0;
+        }
+    }
+
+    atEof = false;
+    return *cur++;
 }
 
 // Put back an input character to be read again
 void JsonReader::unget()
 {
-    // We assume the input stream supports unget.
-    // (If this becomes a problem in the future, we could simulate it.)
-    input.unget();
-    --position;
+    if (atEof) {
+        // The last get() didn't consume anything
+        atEof = false;
+    } else {
+        // fill() always keeps the previous character in the block
+        --cur;
+    }
+}
+
+// Try to make at least wanted characters available after cur, reading
+// another block from the input stream if necessary.
+// Returns false if there are none available.
+bool JsonReader::fill(size_t wanted)
+{
+    if (static_cast<size_t>(end - cur) >= wanted) return true;
+    if (input == nullptr) return cur != end;
+
+    // Move the unread part of the block to the start of the storage, keeping
+    // the previous character so it can be ungot
+    const char *keep = (cur == blockStart) ? cur : cur - 1;
+    const size_t kept = end - keep;
+    const size_t offset = cur - keep;
+    blockPosition += keep - blockStart;
+    if (storage.size() < kept + wanted) {
+        // Make room for an unusually long token
+        std::vector<char> newStorage(kept + wanted + READ_BLOCK_SIZE);
+        memcpy(newStorage.data(), keep, kept);
+        storage.swap(newStorage);
+    } else {
+        memmove(storage.data(), keep, kept);
+    }
+
+    // Read as much as will fit. This uses the streambuf directly, so the
+    // stream's state isn't changed by reading to the end.
+    std::streamsize count = 0;
+    std::streambuf *source = input->rdbuf();
+    if (source != nullptr) {
+        count = source->sgetn(storage.data() + kept, static_cast<std::streamsize>(storage.size() - kept));
+    }
+
+    blockStart = storage.data();
+    cur = blockStart + offset;
+    end = blockStart + kept + qMax(count, static_cast<std::streamsize>(0));
+
+    return cur != end;
 }
 
 // Read a JSON string. The result is unescaped and doesn't include the quotes.
@@ -239,6 +329,12 @@ void JsonReader::readString(std::string &value)
     value.clear();
 
     while (true) {
+        // Copy any run of ordinary characters in one go
+        const char *run = cur;
+        while (run != end && *run != '"' && *run != '\\' && *run != 0) ++run;
+        value.append(cur, run - cur);
+        cur = run;
+
         c = get();
         switch (c) {
         case 0:
@@ -283,75 +379,95 @@ void JsonReader::readString(std::string &value)
     }
 }
 
-// Read a JSON number
-void JsonReader::readNumber(double &value)
+// Find the JSON number at the start of the input, and make sure the whole of
+// it is in the block. Returns its length, and sets isInteger to true if it
+// has no fraction or exponent part.
+size_t JsonReader::scanNumber(bool &isInteger)
 {
-    // JSON only has "numbers"; it doesn't distinguish between floating point
-    // and integers. This means we have to parse as a double, since a value
-    // we're expecting to use as an integer might be written as 1.234e3 or
-    // similar.
-
-    // Check that the number matches JSON's number syntax, which is more
-    // restrictive than the C/C++ parsers accept.
-
-    // XXX could track if we only saw the int part, and parse straight to int
+    // Skip spaces before the number
+    spaceGet();
+    unget();
 
-    buf.clear();
+    // Find the characters that could be part of the number, reading more
+    // input if they reach the end of the block
+    size_t length = 0;
+    while (true) {
+        const char *p = cur + length;
+        while (p != end && isNumberChar(*p)) ++p;
+        length = p - cur;
 
-    char c = spaceGet();
-    if (c == '-') {
-        buf.push_back(c);
-        c = get();
+        if (p != end) break;
+        if (!fill(length + 1) || static_cast<size_t>(end - cur) <= length) break;
     }
-    if (!isAsciiDigit(c)) throwError("expected - or digit");
-    buf.push_back(c);
-    c = get();
 
-    while (isAsciiDigit(c)) {
-        buf.push_back(c);
-        c = get();
+    // Check that the number matches JSON's number syntax, which is more
+    // restrictive than the C/C++ parsers accept
+    const char *p = cur;
+    isInteger = true;
+
+    if (charAt(p) == '-') ++p;
+    if (!isAsciiDigit(charAt(p))) throwErrorAt(p, "expected - or digit");
+    while (isAsciiDigit(charAt(p))) ++p;
+
+    if (charAt(p) == '.') {
+        isInteger = false;
+        ++p;
+        if (!isAsciiDigit(charAt(p))) throwErrorAt(p, "expected digit after .");
+        while (isAsciiDigit(charAt(p))) ++p;
     }
 
-    if (c == '.') {
-        buf.push_back(c);
-        c = get();
-        if (!isAsciiDigit(c)) throwError("expected digit after .");
-        buf.push_back(c);
-        while (true) {
-            c = get();
-            if (!isAsciiDigit(c)) break;
-            buf.push_back(c);
-        }
+    if (charAt(p) == 'e') {
+        isInteger = false;
+        ++p;
+        if (charAt(p) == '-' || charAt(p) == '+') ++p;
+        if (!isAsciiDigit(charAt(p))) throwErrorAt(p, "expected digit after e");
+        while (isAsciiDigit(charAt(p))) ++p;
     }
 
-    if (c == 'e') {
-        buf.push_back(c);
-        c = get();
-        if (c == '-' || c == '+') {
-            buf.push_back(c);
-            c = get();
-        }
-        if (!isAsciiDigit(c)) throwError("expected digit after e");
-        buf.push_back(c);
-        while (true) {
-            c = get();
-            if (!isAsciiDigit(c)) break;
-            buf.push_back(c);
-        }
-    }
+    return p - cur;
+}
+
+// Read a JSON number
+void JsonReader::readNumber(double &value)
+{
+    bool isInteger;
+    const size_t length = scanNumber(isInteger);
 
 #ifdef USE_CHARCONV
     // Use the faster C++17 method if available. 
     // (Skip if clang is detected since it was late to implement, and thus not available on macos yet.)
-    std::from_chars(buf.data(), buf.data() + buf.size(), value);
+    std::from_chars(cur, cur + length, value);
 #else
+    buf.assign(cur, length);
     std::istringstream(buf) >> value;
 #endif
 
+    cur += length;
+}
 
-    // We've read one character beyond the end of the number (there's no way to
-    // tell where the end is otherwise), so we must unget the last char
-    unget();
+// Read a JSON number as an integer
+void JsonReader::readInteger(qint64 &value)
+{
+    // JSON only has "numbers"; it doesn't distinguish between floating point
+    // and integers. Most integers are written as just an integer part, which
+    // we can parse directly.
+    bool isInteger;
+    const size_t length = scanNumber(isInteger);
+    if (isInteger) {
+        long long i;
+        const std::from_chars_result result = std::from_chars(cur, cur + length, i);
+        if (result.ec == std::errc()) {
+            value = i;
+            cur += length;
+            return;
+        }
+    }
+
+    // Otherwise, it might be written as 1.234e3 or similar (or be too big
+    // for an integer), so parse it as a double and round to the nearest integer
+    double d;
+    readNumber(d);
+    value = static_cast<qint64>(std::llround(d));
 }
 
 JsonWriter::JsonWriter(std::ostream &_output)
@@ -32,13 +32,23 @@
 #include <stdexcept>
 #include <string>
 #include <stack>
+#include <vector>
 #include <cmath>
 
+// Parser for JSON input.
+//
+// Input is scanned in blocks, either directly from memory or from blocks read
+// from a stream, so the reader may consume input beyond the end of the value
+// it's parsing.
 class JsonReader
 {
 public:
+    // Read from a stream
     JsonReader(std::istream &_input);
 
+    // Read from a block of memory (e.g. a memory-mapped file)
+    JsonReader(const char *_data, size_t _size);
+
     // Exception class to be thrown when parsing fails
     class Error : public std::runtime_error
     {
@@ -48,7 +58,7 @@ public:
 
     // Throw an Error exception with the given message
     [[noreturn]] void throwError(std::string message) {
-        throw Error(message + " at byte " + std::to_string(position));
+        throw Error(message + " at byte " + std::to_string(getPosition()));
     }
 
     // Numbers
@@ -76,23 +86,63 @@ public:
     // Read and discard the next value, whatever type it is
     void discard();
 
+    // Return the number of bytes of input consumed so far
+    unsigned long getPosition() const {
+        return static_cast<unsigned long>(blockPosition + (cur - blockStart));
+    }
+
 private:
-    char get();
+    // Get the next input character, returning 0 on EOF or error
+    char get() {
+        if (cur == end && !fill(1)) {
+            atEof = true;
+            return 0;
+        }
+        atEof = false;
+        return *cur++;
+    }
     char spaceGet();
     void unget();
+    bool fill(size_t wanted);
+
+    // Return the character at p in the block, or 0 if p is at the end
+    char charAt(const char *p) const {
+        return (p == end) ? 0 : *p;
+    }
+
+    // Throw an Error exception for a problem with the character at p
+    [[noreturn]] void throwErrorAt(const char *p, std::string message) {
+        // Count the character as consumed, as get() would have done
+        cur = (p == end) ? p : p + 1;
+        throwError(message);
+    }
 
     void readString(std::string &value);
+    size_t scanNumber(bool &isInteger);
     void readNumber(double &value);
+    void readInteger(qint64 &value);
     template <typename T> void readSignedInteger(T& value) {
-        // Round to the nearest integer
-        double d;
-        readNumber(d);
-        value = static_cast<T>(std::llround(d));
+        qint64 i;
+        readInteger(i);
+        value = static_cast<T>(i);
     }
 
-    // The input stream
-    std::istream &input;
-    unsigned long position;
+    // The input stream, or nullptr if reading from memory
+    std::istream *input;
+
+    // Storage for blocks read from the input stream
+    std::vector<char> storage;
+
+    // The block of input being scanned: from blockStart to end, with cur
+    // pointing to the next character to read. blockPosition is the offset of
+    // blockStart in the input.
+    const char *blockStart;
+    const char *cur;
+    const char *end;
+    unsigned long long blockPosition;
+
+    // True if the last call to get() reached the end of the input
+    bool atEof;
 
     // True if we're at the start of a { or [ construct
     bool atStart;
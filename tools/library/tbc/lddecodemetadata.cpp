@@ -26,8 +26,14 @@
 
 #include "lddecodemetadata.h"
 
+#include "binaryio.h"
 #include "jsonio.h"
 
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
 #include <cassert>
 #include <fstream>
 
@@ -525,11 +531,236 @@ void LdDecodeMetaData::Field::write(JsonWriter &writer) const
     writer.endObject();
 }
 
+// Binary metadata format -------------------------------------------------------------------------------------------
+//
+// The binary metadata contains exactly the information that was parsed from
+// the JSON, so reading either produces the same result. Optional structures
+// are preceded by their inUse flag, and only written if it's true.
+
+// Read Vbi from binary metadata
+void LdDecodeMetaData::Vbi::read(BinaryReader &reader)
+{
+    for (auto &value : vbiData) reader.read(value);
+    inUse = true;
+}
+
+// Write Vbi to binary metadata
+void LdDecodeMetaData::Vbi::write(BinaryWriter &writer) const
+{
+    for (auto value : vbiData) writer.write(value);
+}
+
+// Read VideoParameters from binary metadata
+void LdDecodeMetaData::VideoParameters::read(BinaryReader &reader)
+{
+    qint32 systemValue;
+    reader.read(systemValue);
+    if (systemValue < PAL || systemValue > PAL_M) reader.throwError("unknown value for videoParameters.system");
+    system = static_cast<VideoSystem>(systemValue);
+
+    reader.read(numberOfSequentialFields);
+    reader.read(isSubcarrierLocked);
+    reader.read(isWidescreen);
+    reader.read(colourBurstStart);
+    reader.read(colourBurstEnd);
+    reader.read(activeVideoStart);
+    reader.read(activeVideoEnd);
+    reader.read(white16bIre);
+    reader.read(black16bIre);
+    reader.read(fieldWidth);
+    reader.read(fieldHeight);
+    reader.read(sampleRate);
+    reader.read(isMapped);
+    reader.read(gitBranch);
+    reader.read(gitCommit);
+
+    isValid = true;
+}
+
+// Write VideoParameters to binary metadata
+void LdDecodeMetaData::VideoParameters::write(BinaryWriter &writer) const
+{
+    assert(isValid);
+
+    writer.write(static_cast<qint32>(system));
+    writer.write(numberOfSequentialFields);
+    writer.write(isSubcarrierLocked);
+    writer.write(isWidescreen);
+    writer.write(colourBurstStart);
+    writer.write(colourBurstEnd);
+    writer.write(activeVideoStart);
+    writer.write(activeVideoEnd);
+    writer.write(white16bIre);
+    writer.write(black16bIre);
+    writer.write(fieldWidth);
+    writer.write(fieldHeight);
+    writer.write(sampleRate);
+    writer.write(isMapped);
+    writer.write(gitBranch);
+    writer.write(gitCommit);
+}
+
+// Read VitsMetrics from binary metadata
+void LdDecodeMetaData::VitsMetrics::read(BinaryReader &reader)
+{
+    reader.read(wSNR);
+    reader.read(bPSNR);
+    inUse = true;
+}
+
+// Write VitsMetrics to binary metadata
+void LdDecodeMetaData::VitsMetrics::write(BinaryWriter &writer) const
+{
+    writer.write(wSNR);
+    writer.write(bPSNR);
+}
+
+// Read Ntsc from binary metadata
+void LdDecodeMetaData::Ntsc::read(BinaryReader &reader)
+{
+    reader.read(isFmCodeDataValid);
+    reader.read(fmCodeData);
+    reader.read(fieldFlag);
+    reader.read(isVideoIdDataValid);
+    reader.read(videoIdData);
+    reader.read(whiteFlag);
+    inUse = true;
+}
+
+// Write Ntsc to binary metadata
+void LdDecodeMetaData::Ntsc::write(BinaryWriter &writer) const
+{
+    writer.write(isFmCodeDataValid);
+    writer.write(fmCodeData);
+    writer.write(fieldFlag);
+    writer.write(isVideoIdDataValid);
+    writer.write(videoIdData);
+    writer.write(whiteFlag);
+}
+
+// Read Vitc from binary metadata
+void LdDecodeMetaData::Vitc::read(BinaryReader &reader)
+{
+    for (auto &value : vitcData) reader.read(value);
+    inUse = true;
+}
+
+// Write Vitc to binary metadata
+void LdDecodeMetaData::Vitc::write(BinaryWriter &writer) const
+{
+    for (auto value : vitcData) writer.write(value);
+}
+
+// Read ClosedCaption from binary metadata
+void LdDecodeMetaData::ClosedCaption::read(BinaryReader &reader)
+{
+    reader.read(data0);
+    reader.read(data1);
+    inUse = true;
+}
+
+// Write ClosedCaption to binary metadata
+void LdDecodeMetaData::ClosedCaption::write(BinaryWriter &writer) const
+{
+    writer.write(data0);
+    writer.write(data1);
+}
+
+// Read PcmAudioParameters from binary metadata
+void LdDecodeMetaData::PcmAudioParameters::read(BinaryReader &reader)
+{
+    reader.read(sampleRate);
+    reader.read(isLittleEndian);
+    reader.read(isSigned);
+    reader.read(bits);
+    isValid = true;
+}
+
+// Write PcmAudioParameters to binary metadata
+void LdDecodeMetaData::PcmAudioParameters::write(BinaryWriter &writer) const
+{
+    assert(isValid);
+
+    writer.write(sampleRate);
+    writer.write(isLittleEndian);
+    writer.write(isSigned);
+    writer.write(bits);
+}
+
+// Read an optional structure from binary metadata
+template <typename T>
+static void readOptional(BinaryReader &reader, T &value)
+{
+    bool inUse;
+    reader.read(inUse);
+    if (inUse) value.read(reader);
+}
+
+// Write an optional structure to binary metadata
+template <typename T>
+static void writeOptional(BinaryWriter &writer, const T &value)
+{
+    writer.write(value.inUse);
+    if (value.inUse) value.write(writer);
+}
+
+// Read Field from binary metadata
+void LdDecodeMetaData::Field::read(BinaryReader &reader)
+{
+    reader.read(seqNo);
+    reader.read(isFirstField);
+    reader.read(syncConf);
+    reader.read(medianBurstIRE);
+    reader.read(fieldPhaseID);
+    reader.read(audioSamples);
+    readOptional(reader, vitsMetrics);
+    readOptional(reader, vbi);
+    readOptional(reader, ntsc);
+    readOptional(reader, vitc);
+    readOptional(reader, closedCaption);
+    dropOuts.read(reader);
+    reader.read(pad);
+    reader.read(diskLoc);
+    reader.read(fileLoc);
+    reader.read(decodeFaults);
+    reader.read(efmTValues);
+}
+
+// Write Field to binary metadata
+void LdDecodeMetaData::Field::write(BinaryWriter &writer) const
+{
+    writer.write(seqNo);
+    writer.write(isFirstField);
+    writer.write(syncConf);
+    writer.write(medianBurstIRE);
+    writer.write(fieldPhaseID);
+    writer.write(audioSamples);
+    writeOptional(writer, vitsMetrics);
+    writeOptional(writer, vbi);
+    writeOptional(writer, ntsc);
+    writeOptional(writer, vitc);
+    writeOptional(writer, closedCaption);
+    dropOuts.write(writer);
+    writer.write(pad);
+    writer.write(diskLoc);
+    writer.write(fileLoc);
+    writer.write(decodeFaults);
+    writer.write(efmTValues);
+}
+
 LdDecodeMetaData::LdDecodeMetaData()
+    : isLazy(false), lazyData(nullptr), sourceJsonSize(-1), sourceJsonModified(-1), firstIncompleteJournalField(1)
 {
+    lazyCache.setMaxCost(LAZY_CACHE_FIELDS);
+
     clear();
 }
 
+LdDecodeMetaData::~LdDecodeMetaData()
+{
+    // Any open journal is flushed and left in place, so the run can be resumed
+}
+
 // Reset the metadata to the defaults
 void LdDecodeMetaData::clear()
 {
@@ -541,21 +772,93 @@ void LdDecodeMetaData::clear()
     pcmAudioParameters = PcmAudioParameters();
 
     fields.clear();
+    closeLazy();
 }
 
-// Read all metadata from a JSON file
-bool LdDecodeMetaData::read(QString fileName)
+// Read all metadata from a JSON file.
+// If there's up-to-date binary metadata alongside the JSON file, it's read
+// instead; otherwise the JSON is parsed, and binary metadata is written to
+// speed up reading next time.
+//
+// If lazyFields is true, the metadata for each field is only decoded when it's
+// requested, and only the most recently used fields are kept in memory. This
+// requires binary metadata; if it can't be written, all the fields are read
+// as normal.
+bool LdDecodeMetaData::read(QString fileName, bool lazyFields)
 {
-    std::ifstream jsonFile(fileName.toStdString());
-    if (jsonFile.fail()) {
+    // Get the JSON file's size and modification time before reading it, so
+    // we can tell later if it's been changed
+    QFileInfo jsonInfo(fileName);
+    const qint64 jsonSize = jsonInfo.size();
+    const qint64 jsonModified = jsonInfo.lastModified().toMSecsSinceEpoch();
+
+    const bool isBinaryValid = readBinary(fileName, jsonSize, jsonModified, lazyFields);
+    if (!isBinaryValid && !readJson(fileName)) return false;
+
+    // Check we saw VideoParameters - if not, we can't do anything useful!
+    if (!videoParameters.isValid) {
+        qCritical("JSON file invalid: videoParameters object is not defined");
+        return false;
+    }
+
+    // Check numberOfSequentialFields is consistent
+    if (videoParameters.numberOfSequentialFields != getNumberOfFields()) {
+        qCritical("JSON file invalid: numberOfSequentialFields does not match fields array");
+        return false;
+    }
+
+    // Save binary metadata for next time (this doesn't matter if it fails)
+    if (!isBinaryValid && writeBinary(fileName, jsonSize, jsonModified) && lazyFields) {
+        // Switch to reading fields lazily from the binary metadata
+        if (!readBinary(fileName, jsonSize, jsonModified, true) && !readJson(fileName)) return false;
+    }
+
+    // Now we know the video system, initialise the rest of VideoParameters
+    initialiseVideoSystemParameters();
+
+    // Generate the PCM audio map based on the field metadata
+    generatePcmAudioMap();
+
+    // Remember which version of the file this was, for openJournal
+    sourceJsonSize = jsonSize;
+    sourceJsonModified = jsonModified;
+
+    return true;
+}
+
+// Parse metadata from a JSON file
+bool LdDecodeMetaData::readJson(QString fileName)
+{
+    QFile jsonFile(fileName);
+    if (!jsonFile.open(QIODevice::ReadOnly)) {
         qCritical("Opening JSON input file failed: JSON file cannot be opened/does not exist");
         return false;
     }
 
     clear();
 
-    JsonReader reader(jsonFile);
+    // Map the file into memory if possible, so the parser can scan it directly
+    const qint64 jsonSize = jsonFile.size();
+    const uchar *jsonData = (jsonSize > 0) ? jsonFile.map(0, jsonSize) : nullptr;
+    if (jsonData != nullptr) {
+        JsonReader reader(reinterpret_cast<const char *>(jsonData), static_cast<size_t>(jsonSize));
+        return readJson(reader);
+    }
+
+    // Otherwise read it as a stream
+    std::ifstream jsonStream(fileName.toStdString());
+    if (jsonStream.fail()) {
+        qCritical("Opening JSON input file failed: JSON file cannot be opened/does not exist");
+        return false;
+    }
+
+    JsonReader reader(jsonStream);
+    return readJson(reader);
+}
 
+// Parse metadata from a JsonReader
+bool LdDecodeMetaData::readJson(JsonReader &reader)
+{
     try {
         reader.beginObject();
 
@@ -573,26 +876,6 @@ bool LdDecodeMetaData::read(QString fileName)
         return false;
     }
 
-    jsonFile.close();
-
-    // Check we saw VideoParameters - if not, we can't do anything useful!
-    if (!videoParameters.isValid) {
-        qCritical("JSON file invalid: videoParameters object is not defined");
-        return false;
-    }
-
-    // Check numberOfSequentialFields is consistent
-    if (videoParameters.numberOfSequentialFields != fields.size()) {
-        qCritical("JSON file invalid: numberOfSequentialFields does not match fields array");
-        return false;
-    }
-
-    // Now we know the video system, initialise the rest of VideoParameters
-    initialiseVideoSystemParameters();
-
-    // Generate the PCM audio map based on the field metadata
-    generatePcmAudioMap();
-
     return true;
 }
 
@@ -623,6 +906,9 @@ bool LdDecodeMetaData::write(QString fileName) const
 
     jsonFile.close();
 
+    // Any existing binary metadata is now out of date
+    QFile::remove(getBinaryFileName(fileName));
+
     return true;
 }
 
@@ -645,14 +931,488 @@ void LdDecodeMetaData::writeFields(JsonWriter &writer) const
 {
     writer.beginArray();
 
-    for (const Field &field : fields) {
+    const qint32 numberOfFields = getNumberOfFields();
+    for (qint32 fieldNumber = 0; fieldNumber < numberOfFields; fieldNumber++) {
         writer.writeElement();
-        field.write(writer);
+        fieldAt(fieldNumber).write(writer);
     }
 
     writer.endArray();
 }
 
+// Binary metadata files start with this (in native byte order)
+static constexpr quint32 BINARY_MAGIC = 0x424d444c;
+
+// Version of the binary metadata format; change this whenever the format changes
+static constexpr qint32 BINARY_VERSION = 1;
+
+// Return the name of the binary metadata file for a JSON file
+QString LdDecodeMetaData::getBinaryFileName(QString fileName)
+{
+    return fileName + ".bin";
+}
+
+// Read all metadata from the binary metadata file for a JSON file, if it
+// exists and matches the given JSON size and modification time.
+// If lazyFields is true, just build an index of where each field is, and
+// keep the file open so fields can be decoded later by fieldAt.
+// Returns false if the binary metadata isn't usable.
+bool LdDecodeMetaData::readBinary(QString fileName, qint64 jsonSize, qint64 jsonModified, bool lazyFields)
+{
+    clear();
+
+    lazyFile.setFileName(getBinaryFileName(fileName));
+    if (!lazyFile.open(QIODevice::ReadOnly)) return false;
+
+    // Map the file into memory if possible; otherwise read it
+    lazySize = lazyFile.size();
+    lazyData = reinterpret_cast<const char *>(lazyFile.map(0, lazySize));
+    if (lazyData == nullptr) {
+        lazyBuffer = lazyFile.readAll();
+        lazyData = lazyBuffer.constData();
+    }
+
+    BinaryReader reader(lazyData, lazySize);
+
+    try {
+        quint32 magic;
+        qint32 version;
+        qint64 binaryJsonSize, binaryJsonModified;
+        reader.read(magic);
+        reader.read(version);
+        if (magic != BINARY_MAGIC || version != BINARY_VERSION) {
+            qDebug() << "LdDecodeMetaData::readBinary(): Binary metadata has the wrong format, ignoring it";
+            clear();
+            return false;
+        }
+        reader.read(binaryJsonSize);
+        reader.read(binaryJsonModified);
+        if (binaryJsonSize != jsonSize || binaryJsonModified != jsonModified) {
+            qDebug() << "LdDecodeMetaData::readBinary(): Binary metadata is out of date, ignoring it";
+            clear();
+            return false;
+        }
+
+        videoParameters.read(reader);
+
+        bool isPcmAudioValid;
+        reader.read(isPcmAudioValid);
+        if (isPcmAudioValid) pcmAudioParameters.read(reader);
+
+        qint32 numberOfFields;
+        reader.read(numberOfFields);
+        if (numberOfFields < 0) reader.throwError("invalid number of fields");
+        if (lazyFields) {
+            // Decode each field once to find where the next one starts
+            lazyFieldOffsets.resize(numberOfFields);
+            lazyAudioSamples.resize(numberOfFields);
+            for (qint32 fieldNumber = 0; fieldNumber < numberOfFields; fieldNumber++) {
+                lazyFieldOffsets[fieldNumber] = reader.getPosition();
+                Field field;
+                field.read(reader);
+                lazyAudioSamples[fieldNumber] = field.audioSamples;
+            }
+        } else {
+            fields.resize(numberOfFields);
+            for (Field &field : fields) field.read(reader);
+        }
+
+        if (!reader.atEnd()) reader.throwError("unexpected data after fields");
+    } catch (BinaryReader::Error &error) {
+        qWarning() << "Reading binary metadata failed, ignoring it:" << error.what();
+        clear();
+        return false;
+    }
+
+    if (lazyFields) isLazy = true;
+    else closeLazy();
+
+    return true;
+}
+
+// Write all metadata to the binary metadata file for a JSON file, recording
+// the JSON file's size and modification time.
+// Returns true on success.
+bool LdDecodeMetaData::writeBinary(QString fileName, qint64 jsonSize, qint64 jsonModified) const
+{
+    // Use QSaveFile, so other processes will never see a partly-written file
+    QSaveFile binaryFile(getBinaryFileName(fileName));
+    if (!binaryFile.open(QIODevice::WriteOnly)) {
+        qDebug() << "LdDecodeMetaData::writeBinary(): Cannot create binary metadata file";
+        return false;
+    }
+
+    BinaryWriter writer(binaryFile);
+
+    writer.write(BINARY_MAGIC);
+    writer.write(BINARY_VERSION);
+    writer.write(jsonSize);
+    writer.write(jsonModified);
+
+    videoParameters.write(writer);
+
+    writer.write(pcmAudioParameters.isValid);
+    if (pcmAudioParameters.isValid) pcmAudioParameters.write(writer);
+
+    const qint32 numberOfFields = getNumberOfFields();
+    writer.write(numberOfFields);
+    for (qint32 fieldNumber = 0; fieldNumber < numberOfFields; fieldNumber++) fieldAt(fieldNumber).write(writer);
+
+    if (!writer.flush() || !binaryFile.commit()) {
+        qDebug() << "LdDecodeMetaData::writeBinary(): Writing binary metadata file failed";
+        return false;
+    }
+
+    return true;
+}
+
+// Journal files start with this (in native byte order)
+static constexpr quint32 JOURNAL_MAGIC = 0x4a4d444c;
+
+// Version of the journal format; change this whenever the format changes
+static constexpr qint32 JOURNAL_VERSION = 1;
+
+// Size of the header: magic, version, JSON size, JSON modification time, and
+// number of fields
+static constexpr qint64 JOURNAL_HEADER_SIZE = 4 + 4 + 8 + 8 + 4;
+
+// Types of journal record. Each record is the type, the field number (from
+// 0), then (except for JOURNAL_COMPLETE) the new value.
+static constexpr qint32 JOURNAL_FIELD = 1;
+static constexpr qint32 JOURNAL_VITS_METRICS = 2;
+static constexpr qint32 JOURNAL_VBI = 3;
+static constexpr qint32 JOURNAL_NTSC = 4;
+static constexpr qint32 JOURNAL_VITC = 5;
+static constexpr qint32 JOURNAL_CLOSED_CAPTION = 6;
+static constexpr qint32 JOURNAL_DROPOUTS = 7;
+static constexpr qint32 JOURNAL_APPEND_FIELD = 8;
+static constexpr qint32 JOURNAL_COMPLETE = 9;
+
+// Return the name of the journal file for a JSON file
+QString LdDecodeMetaData::getJournalFileName(QString fileName)
+{
+    return fileName + ".journal";
+}
+
+// Return true if there's a journal for the given JSON file that openJournal
+// would resume from, i.e. one left by an interrupted run on the same input
+// metadata. (Stale journals are discarded by openJournal.)
+bool LdDecodeMetaData::canResumeJournal(QString fileName) const
+{
+    QFile file(getJournalFileName(fileName));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QByteArray headerData = file.read(JOURNAL_HEADER_SIZE);
+
+    BinaryReader reader(headerData.constData(), headerData.size());
+    try {
+        return readJournalHeader(reader);
+    } catch (BinaryReader::Error &) {
+        return false;
+    }
+}
+
+// Start journalling updates to the fields, for metadata that will eventually
+// be written to the given JSON file.
+//
+// If there's already a journal for the same input metadata (left by a run
+// that was interrupted), the updates in it are applied first, and
+// getFirstIncompleteJournalField tells you where to resume processing.
+//
+// Returns false if the journal can't be written.
+bool LdDecodeMetaData::openJournal(QString fileName)
+{
+    journalWriter.reset();
+    if (journalFile.isOpen()) journalFile.close();
+    firstIncompleteJournalField = 1;
+
+    journalFile.setFileName(getJournalFileName(fileName));
+    const qint64 validSize = journalFile.exists() ? replayJournal() : 0;
+
+    if (!journalFile.open(QIODevice::ReadWrite)) {
+        qCritical() << "Cannot open journal file" << journalFile.fileName();
+        return false;
+    }
+
+    // Discard anything after the last complete record, or the whole file if
+    // it's not usable
+    if (!journalFile.resize(validSize) || !journalFile.seek(validSize)) {
+        qCritical() << "Cannot truncate journal file" << journalFile.fileName();
+        journalFile.close();
+        return false;
+    }
+
+    journalWriter.reset(new BinaryWriter(journalFile));
+
+    if (validSize == 0) {
+        journalWriter->write(JOURNAL_MAGIC);
+        journalWriter->write(JOURNAL_VERSION);
+        journalWriter->write(sourceJsonSize);
+        journalWriter->write(sourceJsonModified);
+        journalWriter->write(getNumberOfFields());
+        if (!journalWriter->flush() || !journalFile.flush()) {
+            qCritical() << "Cannot write journal file" << journalFile.fileName();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Record in the journal that all the updates for a field have been made, so
+// it won't need to be processed again if the run is resumed
+void LdDecodeMetaData::completeJournalField(qint32 sequentialFieldNumber)
+{
+    BinaryWriter *writer = beginJournalRecord(JOURNAL_COMPLETE, sequentialFieldNumber - 1);
+    if (writer == nullptr) return;
+
+    // Push the journal out to the OS, so it survives the process being killed
+    if (!writer->flush() || !journalFile.flush()) {
+        qWarning() << "Writing journal file failed";
+    }
+}
+
+// Get the sequential field number to resume processing from: the first field
+// that a replayed journal didn't record as complete (or 1 if there was no
+// journal to replay)
+qint32 LdDecodeMetaData::getFirstIncompleteJournalField() const
+{
+    return firstIncompleteJournalField;
+}
+
+// Stop journalling updates, and remove the journal file.
+// Call this once the metadata has been written successfully.
+void LdDecodeMetaData::closeJournal()
+{
+    if (!journalWriter) return;
+
+    journalWriter.reset();
+    journalFile.close();
+    journalFile.remove();
+}
+
+// Read a journal's header, and check that it was written for the same input
+// metadata as this.
+// Throws BinaryReader::Error if the header is incomplete.
+bool LdDecodeMetaData::readJournalHeader(BinaryReader &reader) const
+{
+    quint32 magic;
+    qint32 version;
+    qint64 journalJsonSize, journalJsonModified;
+    qint32 journalNumberOfFields;
+    reader.read(magic);
+    reader.read(version);
+    reader.read(journalJsonSize);
+    reader.read(journalJsonModified);
+    reader.read(journalNumberOfFields);
+
+    return magic == JOURNAL_MAGIC && version == JOURNAL_VERSION && journalJsonSize == sourceJsonSize
+           && journalJsonModified == sourceJsonModified && journalNumberOfFields == getNumberOfFields();
+}
+
+// Apply the updates recorded in an existing journal file, if it was written
+// for the same input metadata.
+// Returns the size of the valid part of the journal, or 0 if it isn't usable.
+qint64 LdDecodeMetaData::replayJournal()
+{
+    if (!journalFile.open(QIODevice::ReadOnly)) return 0;
+    const QByteArray journalData = journalFile.readAll();
+    journalFile.close();
+
+    BinaryReader reader(journalData.constData(), journalData.size());
+    qint64 validSize = 0;
+    qint32 numberOfFields = getNumberOfFields();
+    QVector<bool> completeFields(numberOfFields, false);
+
+    try {
+        if (!readJournalHeader(reader)) {
+            qInfo() << "Ignoring journal file" << journalFile.fileName() << "as it is for different metadata";
+            return 0;
+        }
+        validSize = reader.getPosition();
+
+        // Apply each complete record in turn. If the previous run was killed
+        // while writing a record, the last one may be incomplete.
+        while (!reader.atEnd()) {
+            qint32 type, fieldNumber;
+            reader.read(type);
+            reader.read(fieldNumber);
+            if (type == JOURNAL_APPEND_FIELD) {
+                if (fieldNumber != numberOfFields) reader.throwError("appended field out of sequence");
+            } else if (fieldNumber < 0 || fieldNumber >= numberOfFields) {
+                reader.throwError("field number out of range");
+            }
+            const qint32 sequentialFieldNumber = fieldNumber + 1;
+
+            switch (type) {
+            case JOURNAL_FIELD: {
+                Field field;
+                field.read(reader);
+                updateField(field, sequentialFieldNumber);
+                break;
+            }
+            case JOURNAL_VITS_METRICS: {
+                VitsMetrics vitsMetrics;
+                vitsMetrics.read(reader);
+                updateFieldVitsMetrics(vitsMetrics, sequentialFieldNumber);
+                break;
+            }
+            case JOURNAL_VBI: {
+                Vbi vbi;
+                vbi.read(reader);
+                updateFieldVbi(vbi, sequentialFieldNumber);
+                break;
+            }
+            case JOURNAL_NTSC: {
+                Ntsc ntsc;
+                ntsc.read(reader);
+                updateFieldNtsc(ntsc, sequentialFieldNumber);
+                break;
+            }
+            case JOURNAL_VITC: {
+                Vitc vitc;
+                vitc.read(reader);
+                updateFieldVitc(vitc, sequentialFieldNumber);
+                break;
+            }
+            case JOURNAL_CLOSED_CAPTION: {
+                ClosedCaption closedCaption;
+                closedCaption.read(reader);
+                updateFieldClosedCaption(closedCaption, sequentialFieldNumber);
+                break;
+            }
+            case JOURNAL_DROPOUTS: {
+                DropOuts dropOuts;
+                dropOuts.read(reader);
+                updateFieldDropOuts(dropOuts, sequentialFieldNumber);
+                break;
+            }
+            case JOURNAL_APPEND_FIELD: {
+                Field field;
+                field.read(reader);
+                appendField(field);
+                numberOfFields++;
+                completeFields.append(false);
+                break;
+            }
+            case JOURNAL_COMPLETE:
+                completeFields[fieldNumber] = true;
+                break;
+            default:
+                reader.throwError("unknown record type");
+            }
+
+            validSize = reader.getPosition();
+        }
+    } catch (BinaryReader::Error &error) {
+        qWarning() << "Journal file" << journalFile.fileName() << "is incomplete, ignoring the rest of it:" << error.what();
+    }
+
+    // Fields may have been completed out of order, so resume from the first
+    // one that wasn't
+    firstIncompleteJournalField = completeFields.indexOf(false) + 1;
+    if (firstIncompleteJournalField == 0) firstIncompleteJournalField = numberOfFields + 1;
+
+    qInfo() << "Replayed journal file" << journalFile.fileName() << "- resuming from field" << firstIncompleteJournalField;
+
+    return validSize;
+}
+
+// If a journal is open, start writing a record to it, and return the writer
+// to write the rest of the record with; otherwise, return nullptr
+BinaryWriter *LdDecodeMetaData::beginJournalRecord(qint32 type, qint32 fieldNumber)
+{
+    if (!journalWriter) return nullptr;
+
+    journalWriter->write(type);
+    journalWriter->write(fieldNumber);
+    return journalWriter.get();
+}
+
+// Stop reading fields lazily, and close the binary metadata file
+void LdDecodeMetaData::closeLazy()
+{
+    QMutexLocker locker(&lazyMutex);
+
+    isLazy = false;
+    lazyCache.clear();
+    lazyUpdatedFields.clear();
+    lazyFieldOffsets.clear();
+    lazyAudioSamples.clear();
+
+    if (lazyFile.isOpen()) {
+        if (lazyBuffer.isEmpty() && lazyData != nullptr) {
+            lazyFile.unmap(reinterpret_cast<uchar *>(const_cast<char *>(lazyData)));
+        }
+        lazyFile.close();
+    }
+    lazyBuffer.clear();
+    lazyData = nullptr;
+}
+
+// Return the metadata for a field (indexed from 0).
+// When reading fields lazily, this decodes the field if it's not already
+// in memory.
+const LdDecodeMetaData::Field &LdDecodeMetaData::fieldAt(qint32 fieldNumber) const
+{
+    if (!isLazy) return fields[fieldNumber];
+
+    QMutexLocker locker(&lazyMutex);
+
+    // Has the field been changed?
+    auto it = lazyUpdatedFields.constFind(fieldNumber);
+    if (it != lazyUpdatedFields.constEnd()) return it.value();
+
+    // Is it in the cache?
+    Field *field = lazyCache.object(fieldNumber);
+    if (field != nullptr) return *field;
+
+    // Decode it from the binary metadata
+    field = new Field;
+    decodeLazyField(fieldNumber, *field);
+    lazyCache.insert(fieldNumber, field);
+    return *field;
+}
+
+// Return a modifiable reference to the metadata for a field (indexed from 0)
+LdDecodeMetaData::Field &LdDecodeMetaData::mutableFieldAt(qint32 fieldNumber)
+{
+    if (!isLazy) return fields[fieldNumber];
+
+    QMutexLocker locker(&lazyMutex);
+
+    // Fields that have been changed are kept in lazyUpdatedFields, and never
+    // evicted, so the changes will be written out later
+    auto it = lazyUpdatedFields.find(fieldNumber);
+    if (it == lazyUpdatedFields.end()) {
+        Field *cachedField = lazyCache.take(fieldNumber);
+        if (cachedField != nullptr) {
+            it = lazyUpdatedFields.insert(fieldNumber, *cachedField);
+            delete cachedField;
+        } else {
+            Field field;
+            decodeLazyField(fieldNumber, field);
+            it = lazyUpdatedFields.insert(fieldNumber, field);
+        }
+    }
+
+    return it.value();
+}
+
+// Decode a field's metadata from the binary metadata file.
+// You must hold lazyMutex to call this.
+void LdDecodeMetaData::decodeLazyField(qint32 fieldNumber, Field &field) const
+{
+    const qint64 offset = lazyFieldOffsets[fieldNumber];
+    BinaryReader reader(lazyData + offset, lazySize - offset);
+
+    try {
+        field.read(reader);
+    } catch (BinaryReader::Error &error) {
+        // This shouldn't be possible, since we've read it once already
+        qFatal("Reading field from binary metadata failed: %s", error.what());
+    }
+}
+
 // This method returns the videoParameters metadata
 const LdDecodeMetaData::VideoParameters &LdDecodeMetaData::getVideoParameters()
 {
@@ -781,7 +1541,7 @@ const LdDecodeMetaData::Field &LdDecodeMetaData::getField(qint32 sequentialField
         qCritical() << "LdDecodeMetaData::getField(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    return fields[fieldNumber];
+    return fieldAt(fieldNumber);
 }
 
 // This method gets the VITS metrics metadata for the specified sequential field number
@@ -792,7 +1552,7 @@ const LdDecodeMetaData::VitsMetrics &LdDecodeMetaData::getFieldVitsMetrics(qint3
         qCritical() << "LdDecodeMetaData::getFieldVitsMetrics(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    return fields[fieldNumber].vitsMetrics;
+    return fieldAt(fieldNumber).vitsMetrics;
 }
 
 // This method gets the VBI metadata for the specified sequential field number
@@ -803,7 +1563,7 @@ const LdDecodeMetaData::Vbi &LdDecodeMetaData::getFieldVbi(qint32 sequentialFiel
         qCritical() << "LdDecodeMetaData::getFieldVbi(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    return fields[fieldNumber].vbi;
+    return fieldAt(fieldNumber).vbi;
 }
 
 // This method gets the NTSC metadata for the specified sequential field number
@@ -814,7 +1574,7 @@ const LdDecodeMetaData::Ntsc &LdDecodeMetaData::getFieldNtsc(qint32 sequentialFi
         qCritical() << "LdDecodeMetaData::getFieldNtsc(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    return fields[fieldNumber].ntsc;
+    return fieldAt(fieldNumber).ntsc;
 }
 
 // This method gets the VITC metadata for the specified sequential field number
@@ -825,7 +1585,7 @@ const LdDecodeMetaData::Vitc &LdDecodeMetaData::getFieldVitc(qint32 sequentialFi
         qCritical() << "LdDecodeMetaData::getFieldVitc(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    return fields[fieldNumber].vitc;
+    return fieldAt(fieldNumber).vitc;
 }
 
 // This method gets the Closed Caption metadata for the specified sequential field number
@@ -836,7 +1596,7 @@ const LdDecodeMetaData::ClosedCaption &LdDecodeMetaData::getFieldClosedCaption(q
         qCritical() << "LdDecodeMetaData::getFieldClosedCaption(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    return fields[fieldNumber].closedCaption;
+    return fieldAt(fieldNumber).closedCaption;
 }
 
 // This method gets the drop-out metadata for the specified sequential field number
@@ -847,7 +1607,7 @@ const DropOuts &LdDecodeMetaData::getFieldDropOuts(qint32 sequentialFieldNumber)
         qCritical() << "LdDecodeMetaData::getFieldDropOuts(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    return fields[fieldNumber].dropOuts;
+    return fieldAt(fieldNumber).dropOuts;
 }
 
 // This method sets the field metadata for a field
@@ -858,7 +1618,9 @@ void LdDecodeMetaData::updateField(const LdDecodeMetaData::Field &field, qint32
         qCritical() << "LdDecodeMetaData::updateFieldVitsMetrics(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    fields[fieldNumber] = field;
+    mutableFieldAt(fieldNumber) = field;
+
+    if (BinaryWriter *journal = beginJournalRecord(JOURNAL_FIELD, fieldNumber)) field.write(*journal);
 }
 
 // This method sets the field VBI metadata for a field
@@ -869,7 +1631,9 @@ void LdDecodeMetaData::updateFieldVitsMetrics(const LdDecodeMetaData::VitsMetric
         qCritical() << "LdDecodeMetaData::updateFieldVitsMetrics(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    fields[fieldNumber].vitsMetrics = vitsMetrics;
+    mutableFieldAt(fieldNumber).vitsMetrics = vitsMetrics;
+
+    if (BinaryWriter *journal = beginJournalRecord(JOURNAL_VITS_METRICS, fieldNumber)) vitsMetrics.write(*journal);
 }
 
 // This method sets the field VBI metadata for a field
@@ -880,7 +1644,9 @@ void LdDecodeMetaData::updateFieldVbi(const LdDecodeMetaData::Vbi &vbi, qint32 s
         qCritical() << "LdDecodeMetaData::updateFieldVbi(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    fields[fieldNumber].vbi = vbi;
+    mutableFieldAt(fieldNumber).vbi = vbi;
+
+    if (BinaryWriter *journal = beginJournalRecord(JOURNAL_VBI, fieldNumber)) vbi.write(*journal);
 }
 
 // This method sets the field NTSC metadata for a field
@@ -891,7 +1657,9 @@ void LdDecodeMetaData::updateFieldNtsc(const LdDecodeMetaData::Ntsc &ntsc, qint3
         qCritical() << "LdDecodeMetaData::updateFieldNtsc(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    fields[fieldNumber].ntsc = ntsc;
+    mutableFieldAt(fieldNumber).ntsc = ntsc;
+
+    if (BinaryWriter *journal = beginJournalRecord(JOURNAL_NTSC, fieldNumber)) ntsc.write(*journal);
 }
 
 // This method sets the VITC metadata for a field
@@ -902,7 +1670,9 @@ void LdDecodeMetaData::updateFieldVitc(const LdDecodeMetaData::Vitc &vitc, qint3
         qCritical() << "LdDecodeMetaData::updateFieldVitc(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    fields[fieldNumber].vitc = vitc;
+    mutableFieldAt(fieldNumber).vitc = vitc;
+
+    if (BinaryWriter *journal = beginJournalRecord(JOURNAL_VITC, fieldNumber)) vitc.write(*journal);
 }
 
 // This method sets the Closed Caption metadata for a field
@@ -913,7 +1683,9 @@ void LdDecodeMetaData::updateFieldClosedCaption(const LdDecodeMetaData::ClosedCa
         qCritical() << "LdDecodeMetaData::updateFieldClosedCaption(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    fields[fieldNumber].closedCaption = closedCaption;
+    mutableFieldAt(fieldNumber).closedCaption = closedCaption;
+
+    if (BinaryWriter *journal = beginJournalRecord(JOURNAL_CLOSED_CAPTION, fieldNumber)) closedCaption.write(*journal);
 }
 
 // This method sets the field dropout metadata for a field
@@ -924,7 +1696,9 @@ void LdDecodeMetaData::updateFieldDropOuts(const DropOuts &dropOuts, qint32 sequ
         qCritical() << "LdDecodeMetaData::updateFieldDropOuts(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    fields[fieldNumber].dropOuts = dropOuts;
+    mutableFieldAt(fieldNumber).dropOuts = dropOuts;
+
+    if (BinaryWriter *journal = beginJournalRecord(JOURNAL_DROPOUTS, fieldNumber)) dropOuts.write(*journal);
 }
 
 // This method clears the field dropout metadata for a field
@@ -935,20 +1709,32 @@ void LdDecodeMetaData::clearFieldDropOuts(qint32 sequentialFieldNumber)
         qCritical() << "LdDecodeMetaData::clearFieldDropOuts(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
 
-    fields[fieldNumber].dropOuts.clear();
+    mutableFieldAt(fieldNumber).dropOuts.clear();
+
+    if (BinaryWriter *journal = beginJournalRecord(JOURNAL_DROPOUTS, fieldNumber)) DropOuts().write(*journal);
 }
 
 // This method appends a new field to the existing metadata
 void LdDecodeMetaData::appendField(const LdDecodeMetaData::Field &field)
 {
-    fields.append(field);
+    if (isLazy) {
+        QMutexLocker locker(&lazyMutex);
+        lazyUpdatedFields.insert(lazyFieldOffsets.size(), field);
+        lazyFieldOffsets.append(-1);
+        lazyAudioSamples.append(field.audioSamples);
+    } else {
+        fields.append(field);
+    }
+
+    videoParameters.numberOfSequentialFields = getNumberOfFields();
 
-    videoParameters.numberOfSequentialFields = fields.size();
+    if (BinaryWriter *journal = beginJournalRecord(JOURNAL_APPEND_FIELD, getNumberOfFields() - 1)) field.write(*journal);
 }
 
 // Method to get the available number of fields (according to the metadata)
-qint32 LdDecodeMetaData::getNumberOfFields()
+qint32 LdDecodeMetaData::getNumberOfFields() const
 {
+    if (isLazy) return lazyFieldOffsets.size();
     return fields.size();
 }
 
@@ -1218,7 +2004,9 @@ void LdDecodeMetaData::generatePcmAudioMap()
 
     for (qint32 fieldNo = 0; fieldNo < numberOfFields; fieldNo++) {
         // Each audio sample is 16 bit - and there are 2 samples per stereo pair
-        pcmAudioFieldLengthMap[fieldNo] = static_cast<qint32>(getField(fieldNo+1).audioSamples);
+        // (Use the lengths found when indexing, if reading fields lazily)
+        if (isLazy) pcmAudioFieldLengthMap[fieldNo] = lazyAudioSamples[fieldNo];
+        else pcmAudioFieldLengthMap[fieldNo] = static_cast<qint32>(fields[fieldNo].audioSamples);
 
         if (fieldNo == 0) {
             // First field starts at 0 units
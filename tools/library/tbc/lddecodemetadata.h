@@ -27,14 +27,21 @@
 #ifndef LDDECODEMETADATA_H
 #define LDDECODEMETADATA_H
 
+#include <QCache>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
 #include <QString>
 #include <QVector>
 #include <QTemporaryFile>
 #include <QDebug>
 #include <array>
+#include <memory>
 
 #include "dropouts.h"
 
+class BinaryReader;
+class BinaryWriter;
 class JsonReader;
 class JsonWriter;
 
@@ -59,6 +66,8 @@ public:
 
         void read(JsonReader &reader);
         void write(JsonWriter &writer) const;
+        void read(BinaryReader &reader);
+        void write(BinaryWriter &writer) const;
     };
 
     // Video metadata definition
@@ -109,6 +118,8 @@ public:
 
         void read(JsonReader &reader);
         void write(JsonWriter &writer) const;
+        void read(BinaryReader &reader);
+        void write(BinaryWriter &writer) const;
     };
 
     // Specification for customising the range of active lines in VideoParameters.
@@ -130,6 +141,8 @@ public:
 
         void read(JsonReader &reader);
         void write(JsonWriter &writer) const;
+        void read(BinaryReader &reader);
+        void write(BinaryWriter &writer) const;
     };
 
     // NTSC Specific metadata definition
@@ -145,6 +158,8 @@ public:
 
         void read(JsonReader &reader, ClosedCaption &closedCaption);
         void write(JsonWriter &writer) const;
+        void read(BinaryReader &reader);
+        void write(BinaryWriter &writer) const;
     };
 
     // VITC timecode definition
@@ -157,6 +172,8 @@ public:
 
         void read(JsonReader &reader);
         void write(JsonWriter &writer) const;
+        void read(BinaryReader &reader);
+        void write(BinaryWriter &writer) const;
     };
 
     // Closed Caption definition
@@ -168,6 +185,8 @@ public:
 
         void read(JsonReader &reader);
         void write(JsonWriter &writer) const;
+        void read(BinaryReader &reader);
+        void write(BinaryWriter &writer) const;
     };
 
     // PCM sound metadata definition
@@ -182,6 +201,8 @@ public:
 
         void read(JsonReader &reader);
         void write(JsonWriter &writer) const;
+        void read(BinaryReader &reader);
+        void write(BinaryWriter &writer) const;
     };
 
     // Field metadata definition
@@ -208,6 +229,8 @@ public:
 
         void read(JsonReader &reader);
         void write(JsonWriter &writer) const;
+        void read(BinaryReader &reader);
+        void write(BinaryWriter &writer) const;
     };
 
     // CLV timecode (used by frame number conversion methods)
@@ -219,17 +242,32 @@ public:
     };
 
     LdDecodeMetaData();
+    ~LdDecodeMetaData();
 
     // Prevent copying or assignment
     LdDecodeMetaData(const LdDecodeMetaData &) = delete;
     LdDecodeMetaData& operator=(const LdDecodeMetaData &) = delete;
 
     void clear();
-    bool read(QString fileName);
+    bool read(QString fileName, bool lazyFields = false);
     bool write(QString fileName) const;
     void readFields(JsonReader &reader);
     void writeFields(JsonWriter &writer) const;
 
+    // Binary metadata: a compact copy of the JSON metadata, kept alongside it
+    // and used in preference to it by read() when it's up to date
+    static QString getBinaryFileName(QString fileName);
+
+    // Journalled updates: while a journal is open, every change to the fields
+    // is also appended to a journal file alongside the output JSON file, so a
+    // run that's interrupted can be resumed from where it stopped
+    static QString getJournalFileName(QString fileName);
+    bool canResumeJournal(QString fileName) const;
+    bool openJournal(QString fileName);
+    void completeJournalField(qint32 sequentialFieldNumber);
+    qint32 getFirstIncompleteJournalField() const;
+    void closeJournal();
+
     const VideoParameters &getVideoParameters();
     void setVideoParameters(const VideoParameters &videoParameters);
 
@@ -239,7 +277,9 @@ public:
     // Handle line parameters
     void processLineParameters(LdDecodeMetaData::LineParameters &_lineParameters);
 
-    // Get field metadata
+    // Get field metadata.
+    // If fields are being read lazily, the returned reference remains valid
+    // until at least LAZY_CACHE_FIELDS other fields have been requested.
     const Field &getField(qint32 sequentialFieldNumber);
     const VitsMetrics &getFieldVitsMetrics(qint32 sequentialFieldNumber);
     const Vbi &getFieldVbi(qint32 sequentialFieldNumber);
@@ -261,7 +301,7 @@ public:
     void appendField(const Field &field);
 
     void setNumberOfFields(qint32 numberOfFields);
-    qint32 getNumberOfFields();
+    qint32 getNumberOfFields() const;
     qint32 getNumberOfFrames();
     qint32 getFirstFieldNumber(qint32 frameNumber);
     qint32 getSecondFieldNumber(qint32 frameNumber);
@@ -279,14 +319,50 @@ public:
     // Video system helper methods
     QString getVideoSystemDescription() const;
 
+    // Number of decoded fields to keep in memory when reading fields lazily
+    static constexpr qint32 LAZY_CACHE_FIELDS = 1024;
+
 private:
     bool isFirstFieldFirst;
     VideoParameters videoParameters;
     PcmAudioParameters pcmAudioParameters;
     QVector<Field> fields;
+
+    // State for reading fields lazily (guarded by lazyMutex)
+    bool isLazy;
+    QFile lazyFile;
+    QByteArray lazyBuffer;
+    const char *lazyData;
+    qint64 lazySize;
+    QVector<qint64> lazyFieldOffsets;
+    QVector<qint32> lazyAudioSamples;
+    mutable QMutex lazyMutex;
+    mutable QCache<qint32, Field> lazyCache;
+    QMap<qint32, Field> lazyUpdatedFields;
+
+    // Size and modification time of the JSON file that was read
+    qint64 sourceJsonSize;
+    qint64 sourceJsonModified;
+
+    // State for journalled updates
+    QFile journalFile;
+    std::unique_ptr<BinaryWriter> journalWriter;
+    qint32 firstIncompleteJournalField;
+
     QVector<qint32> pcmAudioFieldStartSampleMap;
     QVector<qint32> pcmAudioFieldLengthMap;
 
+    bool readJson(QString fileName);
+    bool readJson(JsonReader &reader);
+    bool readBinary(QString fileName, qint64 jsonSize, qint64 jsonModified, bool lazyFields);
+    bool writeBinary(QString fileName, qint64 jsonSize, qint64 jsonModified) const;
+    void closeLazy();
+    bool readJournalHeader(BinaryReader &reader) const;
+    qint64 replayJournal();
+    BinaryWriter *beginJournalRecord(qint32 type, qint32 fieldNumber);
+    const Field &fieldAt(qint32 fieldNumber) const;
+    Field &mutableFieldAt(qint32 fieldNumber);
+    void decodeLazyField(qint32 fieldNumber, Field &field) const;
     void initialiseVideoSystemParameters();
     qint32 getFieldNumber(qint32 frameNumber, qint32 field);
     void generatePcmAudioMap();
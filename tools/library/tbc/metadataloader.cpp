@@ -0,0 +1,113 @@
+/************************************************************************
+
+    metadataloader.cpp
+
+    ld-decode-tools TBC library
+    Copyright (C) 2026 agent
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "metadataloader.h"
+
+#include <QElapsedTimer>
+
+class MetaDataLoader::LoaderThread : public QThread
+{
+public:
+    explicit LoaderThread(MetaDataLoader &_loader)
+        : loader(_loader) {}
+
+protected:
+    void run() override {
+        loader.runJobs();
+    }
+
+private:
+    MetaDataLoader &loader;
+};
+
+MetaDataLoader::MetaDataLoader(qint32 _maxThreads)
+    : maxThreads(qMax(_maxThreads, 1)), nextJob(0)
+{
+}
+
+qint32 MetaDataLoader::add(LdDecodeMetaData &metaData, QString fileName, bool lazyFields)
+{
+    Job job;
+    job.metaData = &metaData;
+    job.fileName = fileName;
+    job.lazyFields = lazyFields;
+    job.isLoaded = false;
+    job.loadTime = 0;
+    jobs.append(job);
+
+    return jobs.size() - 1;
+}
+
+bool MetaDataLoader::load()
+{
+    nextJob = 0;
+
+    // Start a thread per file, up to the limit
+    QVector<LoaderThread *> threads(qMin(maxThreads, jobs.size()));
+    for (LoaderThread *&thread : threads) {
+        thread = new LoaderThread(*this);
+        thread->start();
+    }
+
+    // Wait for them to finish
+    for (LoaderThread *thread : threads) {
+        thread->wait();
+        delete thread;
+    }
+
+    for (const Job &job : jobs) {
+        if (!job.isLoaded) return false;
+    }
+    return true;
+}
+
+// Return true if the file was read successfully
+bool MetaDataLoader::isLoaded(qint32 index) const
+{
+    return jobs[index].isLoaded;
+}
+
+// Get the time it took to read the file, in milliseconds
+qint64 MetaDataLoader::getLoadTime(qint32 index) const
+{
+    return jobs[index].loadTime;
+}
+
+// Read files until there are none left. This is called by each thread.
+void MetaDataLoader::runJobs()
+{
+    while (true) {
+        const qint32 index = nextJob.fetchAndAddRelaxed(1);
+        if (index >= jobs.size()) break;
+
+        // Each thread only touches its own job, so the vector isn't detached
+        // or reallocated while the threads are running
+        Job &job = jobs.data()[index];
+
+        QElapsedTimer timer;
+        timer.start();
+        job.isLoaded = job.metaData->read(job.fileName, job.lazyFields);
+        job.loadTime = timer.elapsed();
+    }
+}
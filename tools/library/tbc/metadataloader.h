@@ -0,0 +1,81 @@
+/************************************************************************
+
+    metadataloader.h
+
+    ld-decode-tools TBC library
+    Copyright (C) 2026 agent
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef METADATALOADER_H
+#define METADATALOADER_H
+
+#include <QtGlobal>
+#include <QAtomicInteger>
+#include <QString>
+#include <QThread>
+#include <QVector>
+
+#include "lddecodemetadata.h"
+
+// Read several metadata files in parallel, for tools that take multiple
+// sources.
+//
+// Add each file with add(), then call load(). Each LdDecodeMetaData object is
+// only used by one thread at a time, so no locking is needed.
+class MetaDataLoader
+{
+public:
+    explicit MetaDataLoader(qint32 _maxThreads = QThread::idealThreadCount());
+
+    // Prevent copying or assignment
+    MetaDataLoader(const MetaDataLoader &) = delete;
+    MetaDataLoader& operator=(const MetaDataLoader &) = delete;
+
+    // Add a file to be read into metaData (see LdDecodeMetaData::read).
+    // Returns the index of the file.
+    qint32 add(LdDecodeMetaData &metaData, QString fileName, bool lazyFields = false);
+
+    // Read all the files, and wait for them to finish.
+    // Returns true if all of them were read successfully.
+    bool load();
+
+    // Get the results for a file, by index
+    bool isLoaded(qint32 index) const;
+    qint64 getLoadTime(qint32 index) const;
+
+private:
+    class LoaderThread;
+
+    struct Job {
+        LdDecodeMetaData *metaData;
+        QString fileName;
+        bool lazyFields;
+
+        bool isLoaded;
+        qint64 loadTime;
+    };
+
+    qint32 maxThreads;
+    QVector<Job> jobs;
+    QAtomicInteger<qint32> nextJob;
+
+    void runJobs();
+};
+
+#endif // METADATALOADER_H
@@ -24,8 +24,16 @@
 
 #include "sourcevideo.h"
 
+#include <algorithm>
 #include <cstdio>
 
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <climits>
+#include <vector>
+#include <sys/uio.h>
+#endif
+
 // Class constructor
 SourceVideo::SourceVideo()
 {
@@ -36,14 +44,18 @@ SourceVideo::SourceVideo()
     fieldLength = -1;
     fieldByteLength = -1;
     fieldLineLength = -1;
+    mappedData = nullptr;
 
-    // Set up the cache
-    fieldCache.setMaxCost(100);
+    // Read-ahead is disabled by default
+    readAheadFields = 0;
+    readAheadThread = nullptr;
+    readAheadWindow = 0;
+    readAheadInProgress = -1;
 }
 
 SourceVideo::~SourceVideo()
 {
-    if (isSourceVideoOpen) inputFile.close();
+    if (isSourceVideoOpen) close();
 }
 
 // Source Video file manipulation methods -----------------------------------------------------------------------------
@@ -87,6 +99,16 @@ bool SourceVideo::open(QString filename, qint32 _fieldLength, qint32 _fieldLineL
         qint64 tAvailableFields = (inputFile.size() / fieldByteLength);
         availableFields = static_cast<qint32>(tAvailableFields);
         qDebug() << "SourceVideo::open(): Successful -" << availableFields << "fields available";
+
+        // Try to map the whole file into memory, so fields can be accessed
+        // without copying. If this fails (e.g. the file is too large for the
+        // address space, or is a device), fall back to reading the file.
+        if (inputFile.size() > 0) {
+            mappedData = inputFile.map(0, inputFile.size());
+            if (mappedData == nullptr) {
+                qDebug() << "SourceVideo::open(): Unable to memory-map input file, falling back to reading";
+            }
+        }
     }
 
     // Initialise cache
@@ -95,6 +117,8 @@ bool SourceVideo::open(QString filename, qint32 _fieldLength, qint32 _fieldLineL
     isSourceVideoOpen = true;
     inputFilePos = 0;
 
+    if (readAheadFields > 0) startReadAhead();
+
     return true;
 }
 
@@ -107,7 +131,15 @@ void SourceVideo::close()
     }
 
     qDebug() << "SourceVideo::close(): Called, closing the source video file and emptying the frame cache";
+    stopReadAhead();
+    if (mappedData != nullptr) {
+        inputFile.unmap(const_cast<uchar *>(mappedData));
+        mappedData = nullptr;
+    }
     inputFile.close();
+    qDebug() << "SourceVideo::close(): Field cache hits =" << fieldCache.getHits() << "misses =" << fieldCache.getMisses();
+    fieldCache.clear();
+    fieldCache.resetStatistics();
     isSourceVideoOpen = false;
     inputFilePos = -1;
 
@@ -133,112 +165,470 @@ qint32 SourceVideo::getFieldLength()
     return fieldLength;
 }
 
+// Returns true if the source video file is memory-mapped (and so
+// getVideoFieldView will return views directly into the file)
+bool SourceVideo::isMemoryMapped()
+{
+    return mappedData != nullptr;
+}
+
+// Set the maximum amount of field data to cache, in bytes. The cache is only
+// used when the input file isn't memory-mapped.
+void SourceVideo::setCacheSize(qint64 bytes)
+{
+    fieldCache.setMaxBytes(bytes);
+}
+
+// Set the number of fields to read ahead when the input is being accessed
+// sequentially. This can be changed while the file is open; 0 disables
+// read-ahead.
+void SourceVideo::setReadAhead(qint32 fields)
+{
+    fields = qMax(0, fields);
+
+    if (fields == readAheadFields) return;
+
+    if (isSourceVideoOpen) stopReadAhead();
+    readAheadFields = fields;
+    if (isSourceVideoOpen && readAheadFields > 0) startReadAhead();
+}
+
 // Frame data retrieval methods ---------------------------------------------------------------------------------------
 
 // Method to retrieve a range of field lines from a single video field.
 // If startFieldLine and endFieldLine are both -1, read the whole field.
 SourceVideo::Data SourceVideo::getVideoField(qint32 fieldNumber, qint32 startFieldLine, qint32 endFieldLine)
 {
+    if (startFieldLine != -1 || endFieldLine != -1) {
+        // Read a range of lines
+        return getVideoFieldLines(fieldNumber, 1, startFieldLine, endFieldLine)[0];
+    }
+
     // Adjust the field number to index from zero
     fieldNumber--;
 
     // Ensure source video is open
     if (!isSourceVideoOpen) qFatal("Application requested TBC field before opening TBC file - Fatal error");
 
-    // Calculate the position of the require field line data
-    qint64 requiredStartPosition = static_cast<qint64>(fieldByteLength) * static_cast<qint64>(fieldNumber);
-    qint64 requiredReadLength;
+    // Calculate the position of the required field data
+    const qint64 requiredStartPosition = static_cast<qint64>(fieldByteLength) * static_cast<qint64>(fieldNumber);
+    const qint64 requiredReadLength = static_cast<qint64>(fieldByteLength);
 
-    if (startFieldLine == -1 && endFieldLine == -1) {
-        // Read the whole field
+    // Check the requested field is valid
+    if (fieldNumber < 0 || (availableFields != -1 && fieldNumber >= availableFields)) {
+        qFatal("Application requested field line range that exceeds the boundaries of the input TBC file");
+    }
+
+    Data fieldData;
 
-        // Check the cache (we only cache whole fields)
-        if (fieldCache.contains(fieldNumber)) {
-            return *fieldCache.object(fieldNumber);
+    if (mappedData != nullptr) {
+        // Copy the data straight out of the mapping (no need to cache it)
+        if (readAheadThread != nullptr) {
+            QMutexLocker readAheadLocker(&readAheadMutex);
+            noteFieldRequest(fieldNumber);
         }
 
-        requiredReadLength = static_cast<qint64>(fieldByteLength);
+        const quint16 *mappedStart = reinterpret_cast<const quint16 *>(mappedData + requiredStartPosition);
+        fieldData.resize(fieldLength);
+        std::copy(mappedStart, mappedStart + fieldLength, fieldData.begin());
+        return fieldData;
+    }
+
+    if (readAheadThread != nullptr) {
+        QMutexLocker readAheadLocker(&readAheadMutex);
+        noteFieldRequest(fieldNumber);
+
+        // If the read-ahead thread is loading this field, wait for it
+        while (readAheadInProgress == fieldNumber) fieldReadyCondition.wait(&readAheadMutex);
+
+        // Check the cache
+        if (fieldCache.lookup(fieldNumber, fieldData)) return fieldData;
+
+        // We'll need to read the field ourselves. Take the input file before
+        // letting the read-ahead thread continue, so it can't read the
+        // following fields first -- if the input is unseekable (e.g. a pipe),
+        // we wouldn't be able to go back for this one.
+        fileMutex.lock();
     } else {
-        // Read a range of lines
+        // Check the cache
+        if (fieldCache.lookup(fieldNumber, fieldData)) return fieldData;
+
+        fileMutex.lock();
+    }
+
+    // Read the field from the input
+    const bool success = readFromFile(requiredStartPosition, requiredReadLength, fieldData);
+    fileMutex.unlock();
+    if (!success) {
+        qFatal("Could not seek to or read field data from input TBC file");
+    }
 
-        // Adjust the field line range to index from zero
-        startFieldLine--;
-        endFieldLine--;
+    // Insert the field data into the cache
+    fieldCache.insert(fieldNumber, fieldData);
+
+    // Return the data
+    return fieldData;
+}
+
+// Method to retrieve the same range of field lines from a number of
+// consecutive video fields, starting at firstFieldNumber. This is much more
+// efficient than reading the fields one at a time, or reading whole fields,
+// when only a few lines of each field are needed (e.g. for VBI decoding).
+//
+// If the source video file is memory-mapped, the lines are gathered directly
+// from the mapping, so only the pages containing them are read from disc.
+// Otherwise, fields that are already in the cache are sliced from there, and
+// the rest are read while holding the input file for the whole batch.
+QVector<SourceVideo::Data> SourceVideo::getVideoFieldLines(qint32 firstFieldNumber, qint32 numberOfFields,
+                                                           qint32 startFieldLine, qint32 endFieldLine)
+{
+    // Ensure source video is open
+    if (!isSourceVideoOpen) qFatal("Application requested TBC field before opening TBC file - Fatal error");
 
-        // Verify the required range
-        if (fieldLineLength == -1) qFatal("Application did not set field line length when opening TBC file");
-        if (startFieldLine < 0) qFatal("Application requested out-of-bounds field line");
+    // Adjust the field number and field line range to index from zero
+    firstFieldNumber--;
+    startFieldLine--;
+    endFieldLine--;
 
-        requiredStartPosition += static_cast<qint64>(fieldLineLength) * static_cast<qint64>(startFieldLine);
-        requiredReadLength = static_cast<qint64>(endFieldLine - startFieldLine + 1) * static_cast<qint64>(fieldLineLength);
+    // Verify the required range
+    if (fieldLineLength == -1) qFatal("Application did not set field line length when opening TBC file");
+    if (startFieldLine < 0 || endFieldLine < startFieldLine) qFatal("Application requested out-of-bounds field line");
+
+    const qint64 lineOffset = static_cast<qint64>(fieldLineLength) * static_cast<qint64>(startFieldLine);
+    const qint64 requiredReadLength = static_cast<qint64>(endFieldLine - startFieldLine + 1) * static_cast<qint64>(fieldLineLength);
+    if (lineOffset + requiredReadLength > fieldByteLength) qFatal("Application requested out-of-bounds field line");
+
+    // Check the requested fields are valid
+    if (firstFieldNumber < 0 || numberOfFields < 0
+        || (availableFields != -1 && firstFieldNumber + numberOfFields > availableFields)) {
+        qFatal("Application requested field line range that exceeds the boundaries of the input TBC file");
     }
 
-    // Check the requested field and lines are valid
-    if (availableFields != -1
-        && (requiredStartPosition < 0
-            || requiredStartPosition + requiredReadLength > (static_cast<qint64>(fieldByteLength) * availableFields))) {
+    const qint32 lineSamples = static_cast<qint32>(requiredReadLength) / 2;
+    const qint32 lineStart = static_cast<qint32>(lineOffset) / 2;
+
+    QVector<Data> fieldsData(numberOfFields);
+
+    if (mappedData != nullptr) {
+        // Gather the lines from the mapping
+        for (qint32 i = 0; i < numberOfFields; i++) {
+            const qint64 requiredStartPosition = (static_cast<qint64>(fieldByteLength) * static_cast<qint64>(firstFieldNumber + i)) + lineOffset;
+            const quint16 *mappedStart = reinterpret_cast<const quint16 *>(mappedData + requiredStartPosition);
+            fieldsData[i].resize(lineSamples);
+            std::copy(mappedStart, mappedStart + lineSamples, fieldsData[i].begin());
+        }
+        return fieldsData;
+    }
+
+    // If we already have the whole field, slice the lines from it; otherwise
+    // note that it needs reading
+    QVector<qint32> fieldsToRead;
+    for (qint32 i = 0; i < numberOfFields; i++) {
+        Data wholeField;
+        if (fieldCache.contains(firstFieldNumber + i) && fieldCache.lookup(firstFieldNumber + i, wholeField)) {
+            fieldsData[i] = wholeField.mid(lineStart, lineSamples);
+        } else {
+            fieldsToRead.append(i);
+        }
+    }
+    if (fieldsToRead.isEmpty()) return fieldsData;
+
+    // Read the lines from the input, holding the file for the whole batch
+    QMutexLocker fileLocker(&fileMutex);
+
+#ifdef Q_OS_UNIX
+    if (!inputFile.isSequential()) {
+        if (!readFieldLinesVectored(firstFieldNumber, fieldsToRead, lineOffset, requiredReadLength, fieldsData)) {
+            qFatal("Could not read field data from input TBC file");
+        }
+        return fieldsData;
+    }
+#endif
+
+    // Since the fields are in order, this only ever seeks (or skips) forwards
+    for (qint32 i : fieldsToRead) {
+        const qint64 requiredStartPosition = (static_cast<qint64>(fieldByteLength) * static_cast<qint64>(firstFieldNumber + i)) + lineOffset;
+        if (!readFromFile(requiredStartPosition, requiredReadLength, fieldsData[i])) {
+            qFatal("Could not seek to or read field data from input TBC file");
+        }
+    }
+
+    return fieldsData;
+}
+
+// Method to retrieve a read-only view of a single video field.
+// If the source video file is memory-mapped, the view points into the mapping
+// and no data is copied; it remains valid until the file is closed.
+// Otherwise, the field is read (or fetched from the cache) as with getVideoField.
+SourceVideo::DataView SourceVideo::getVideoFieldView(qint32 fieldNumber)
+{
+    if (mappedData == nullptr) {
+        return DataView(getVideoField(fieldNumber));
+    }
+
+    // Check the requested field is valid
+    if (fieldNumber < 1 || fieldNumber > availableFields) {
         qFatal("Application requested field line range that exceeds the boundaries of the input TBC file");
     }
 
+    if (readAheadThread != nullptr) {
+        QMutexLocker readAheadLocker(&readAheadMutex);
+        noteFieldRequest(fieldNumber - 1);
+    }
+
+    const qint64 requiredStartPosition = static_cast<qint64>(fieldByteLength) * static_cast<qint64>(fieldNumber - 1);
+    return DataView(reinterpret_cast<const quint16 *>(mappedData + requiredStartPosition), fieldLength);
+}
+
+// Read data from the input file into data, seeking (or skipping forwards, for
+// unseekable input) to the required position. You must hold fileMutex to call this.
+// Returns false if the data could not be read, or if the input is unseekable
+// and has already been read past the required position.
+bool SourceVideo::readFromFile(qint64 startPosition, qint64 readLength, Data &data)
+{
     // Resize the output buffer
-    outputFieldData.resize(static_cast<qint32>(requiredReadLength) / 2);
+    data.resize(static_cast<qint32>(readLength) / 2);
 
     // Seek to the correct file position (if not already there)
-    if (inputFilePos != requiredStartPosition) {
-        if (!inputFile.seek(requiredStartPosition)) {
+    if (inputFilePos != startPosition) {
+        if (!inputFile.seek(startPosition)) {
             // Seek failed
 
-            if (inputFilePos > requiredStartPosition) {
-                qFatal("Could not seek backwards to required field position in input TBC file");
+            if (inputFilePos > startPosition) {
+                // Can't seek backwards
+                return false;
             } else {
                 // Seeking forwards -- try reading and discarding data instead
-                qint64 discardBytes = requiredStartPosition - inputFilePos;
+                qint64 discardBytes = startPosition - inputFilePos;
                 while (discardBytes > 0) {
-                    qint64 readBytes = inputFile.read(reinterpret_cast<char *>(outputFieldData.data()),
-                                                      qMin(discardBytes, static_cast<qint64>(outputFieldData.size() * 2)));
+                    qint64 readBytes = inputFile.read(reinterpret_cast<char *>(data.data()),
+                                                      qMin(discardBytes, static_cast<qint64>(data.size() * 2)));
                     if (readBytes <= 0) {
-                        qFatal("Could not seek or read forwards to required field position in input TBC file");
+                        return false;
                     }
                     discardBytes -= readBytes;
+                    inputFilePos += readBytes;
                 }
             }
         }
-        inputFilePos = requiredStartPosition;
+        inputFilePos = startPosition;
     }
 
-    // Read the field lines from the input
+    // Read the data from the input
     qint64 totalReceivedBytes = 0;
     qint64 receivedBytes = 0;
     do {
-        receivedBytes = inputFile.read(reinterpret_cast<char *>(outputFieldData.data()) + totalReceivedBytes,
-                                       requiredReadLength - totalReceivedBytes);
+        receivedBytes = inputFile.read(reinterpret_cast<char *>(data.data()) + totalReceivedBytes,
+                                       readLength - totalReceivedBytes);
         if (receivedBytes > 0) {
             totalReceivedBytes += receivedBytes;
             inputFilePos += receivedBytes;
         }
-    } while (receivedBytes > 0 && totalReceivedBytes < requiredReadLength);
+    } while (receivedBytes > 0 && totalReceivedBytes < readLength);
 
     // Verify read was ok
-    if (totalReceivedBytes != requiredReadLength) qFatal("Could not read field data from input TBC file");
+    return totalReceivedBytes == readLength;
+}
 
-    if (startFieldLine == -1 && endFieldLine == -1) {
-        // Insert the field data into the cache
-        fieldCache.insert(fieldNumber, new Data(outputFieldData), 1);
+#ifdef Q_OS_UNIX
+// Read the same range of bytes from each of a set of fields (given as
+// indexes from firstFieldNumber, in order) using preadv, which doesn't need
+// the file position. Each run of consecutive fields is read in one call,
+// with the bytes between one field's range and the next going into a
+// scratch buffer, so the run is read as one sequential request.
+bool SourceVideo::readFieldLinesVectored(qint32 firstFieldNumber, const QVector<qint32> &fieldIndexes,
+                                         qint64 rangeOffset, qint64 rangeLength, QVector<Data> &fieldsData)
+{
+    // Each field needs two iovecs (apart from the first in a run)
+    const qint32 maxRunFields = IOV_MAX / 2;
+
+    const qint64 gapLength = fieldByteLength - rangeLength;
+    std::vector<char> gapBuffer(gapLength);
+    std::vector<struct iovec> iov;
+
+    qint32 i = 0;
+    while (i < fieldIndexes.size()) {
+        // Build the iovecs for the next run of consecutive fields
+        const qint32 runStart = fieldIndexes[i];
+        qint32 runEnd = runStart;
+        iov.clear();
+        while (i < fieldIndexes.size() && fieldIndexes[i] == runEnd && runEnd - runStart < maxRunFields) {
+            if (runEnd != runStart && gapLength != 0) {
+                iov.push_back({gapBuffer.data(), static_cast<size_t>(gapLength)});
+            }
+
+            Data &fieldData = fieldsData[runEnd];
+            fieldData.resize(static_cast<qint32>(rangeLength) / 2);
+            iov.push_back({fieldData.data(), static_cast<size_t>(rangeLength)});
+
+            i++;
+            runEnd++;
+        }
+
+        // Read the run, continuing after short reads
+        qint64 position = (static_cast<qint64>(fieldByteLength) * static_cast<qint64>(firstFieldNumber + runStart)) + rangeOffset;
+        struct iovec *nextIov = iov.data();
+        qint32 iovCount = static_cast<qint32>(iov.size());
+        while (iovCount > 0) {
+            const ssize_t count = preadv(inputFile.handle(), nextIov, iovCount, position);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            if (count == 0) {
+                // Unexpected end of file
+                return false;
+            }
+            position += count;
+
+            // Skip over the data that has been read
+            size_t remaining = static_cast<size_t>(count);
+            while (iovCount > 0 && remaining >= nextIov->iov_len) {
+                remaining -= nextIov->iov_len;
+                nextIov++;
+                iovCount--;
+            }
+            if (iovCount > 0) {
+                nextIov->iov_base = static_cast<char *>(nextIov->iov_base) + remaining;
+                nextIov->iov_len -= remaining;
+            }
+        }
     }
 
-    // Return the data
-    return outputFieldData;
+    return true;
 }
+#endif
 
+// Read-ahead methods -------------------------------------------------------------------------------------------------
 
+// Background thread that keeps the fields after the most recently requested
+// one loaded, so that requests for them don't block on I/O.
+class SourceVideo::ReadAheadThread : public QThread
+{
+public:
+    explicit ReadAheadThread(SourceVideo &_sourceVideo)
+        : sourceVideo(_sourceVideo) {}
 
+protected:
+    void run() override {
+        sourceVideo.runReadAhead();
+    }
+
+private:
+    SourceVideo &sourceVideo;
+};
 
+// Start the read-ahead thread
+void SourceVideo::startReadAhead()
+{
+    readAheadWindow = readAheadFields;
+    if (mappedData == nullptr) {
+        // Read-ahead fields are held in the cache, so leave room there for
+        // the fields that have already been requested
+        readAheadWindow = qMin(readAheadWindow, static_cast<qint32>(fieldCache.getMaxBytes() / 2 / fieldByteLength));
+    }
+    if (readAheadWindow <= 0) return;
+
+    lastRequestedField = -1;
+    nextReadAheadField = 0;
+    readAheadInProgress = -1;
+    readAheadStop = false;
+
+    readAheadThread = new ReadAheadThread(*this);
+    readAheadThread->start(QThread::LowPriority);
+}
+
+// Stop the read-ahead thread, and wait for it to finish
+void SourceVideo::stopReadAhead()
+{
+    if (readAheadThread == nullptr) return;
 
+    {
+        QMutexLocker readAheadLocker(&readAheadMutex);
+        readAheadStop = true;
+        readAheadCondition.wakeAll();
+    }
 
+    readAheadThread->wait();
+    delete readAheadThread;
+    readAheadThread = nullptr;
+}
 
+// Record that a whole field (indexed from zero) has been requested, and let
+// the read-ahead thread know if it should load more fields. You must hold
+// readAheadMutex to call this.
+//
+// Access is considered sequential as long as each request is within the
+// read-ahead window of the last one; anything else is a seek, and restarts
+// read-ahead from the new position.
+void SourceVideo::noteFieldRequest(qint32 fieldIndex)
+{
+    if (fieldIndex < lastRequestedField - readAheadWindow || fieldIndex > lastRequestedField + readAheadWindow) {
+        // Seek
+        nextReadAheadField = fieldIndex + 1;
+    } else if (fieldIndex <= lastRequestedField) {
+        // Looking back at a field we've already passed
+        return;
+    }
+    lastRequestedField = fieldIndex;
+    nextReadAheadField = qMax(nextReadAheadField, fieldIndex + 1);
 
+    readAheadCondition.wakeAll();
+}
 
+// Main loop for the read-ahead thread
+void SourceVideo::runReadAhead()
+{
+    QMutexLocker readAheadLocker(&readAheadMutex);
+
+    while (!readAheadStop) {
+        // Is there another field within the window to load?
+        const qint32 fieldIndex = nextReadAheadField;
+        if (lastRequestedField == -1
+            || fieldIndex > lastRequestedField + readAheadWindow
+            || (availableFields != -1 && fieldIndex >= availableFields)) {
+            readAheadCondition.wait(&readAheadMutex);
+            continue;
+        }
+        nextReadAheadField++;
+
+        const qint64 startPosition = static_cast<qint64>(fieldByteLength) * static_cast<qint64>(fieldIndex);
+
+        if (mappedData != nullptr) {
+            // Touch each page of the field, so it's faulted in by this
+            // thread rather than the one that wants to use it
+            readAheadLocker.unlock();
+            const uchar *fieldStart = mappedData + startPosition;
+            quint32 sum = 0;
+            for (qint32 i = 0; i < fieldByteLength; i += 4096) {
+                sum += *static_cast<const volatile uchar *>(fieldStart + i);
+            }
+            Q_UNUSED(sum);
+            readAheadLocker.relock();
+            continue;
+        }
 
+        if (fieldCache.contains(fieldIndex)) continue;
 
+        // Load the field into the cache
+        readAheadInProgress = fieldIndex;
+        readAheadLocker.unlock();
 
+        Data fieldData;
+        fileMutex.lock();
+        const bool success = readFromFile(startPosition, fieldByteLength, fieldData);
+        fileMutex.unlock();
 
+        // If the read failed (e.g. because we reached the end of unseekable
+        // input), leave it to the application to report the error if it
+        // needs the data
+        readAheadLocker.relock();
+        if (success) {
+            fieldCache.insert(fieldIndex, fieldData);
+        }
+        readAheadInProgress = -1;
+        fieldReadyCondition.wakeAll();
+    }
+}
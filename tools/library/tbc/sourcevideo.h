@@ -26,9 +26,15 @@
 #define SOURCEVIDEO_H
 
 #include <QFile>
-#include <QCache>
 #include <QDebug>
+#include <QMutex>
+#include <QThread>
 #include <QVector>
+#include <QWaitCondition>
+
+#include <algorithm>
+
+#include "fieldcache.h"
 
 class SourceVideo
 {
@@ -39,6 +45,51 @@ public:
     // yourself).
     using Data = QVector<quint16>;
 
+    // A read-only view of timebase-corrected video samples.
+    // When the source file is memory-mapped, this points directly into the
+    // mapping and is valid until the SourceVideo is closed; otherwise it holds
+    // a (shared) reference to a Data buffer that owns the samples.
+    class DataView
+    {
+    public:
+        DataView()
+            : ptr(nullptr), length(0) {}
+        DataView(const quint16 *_ptr, qint32 _length)
+            : ptr(_ptr), length(_length) {}
+        DataView(const Data &data)
+            : owner(data), ptr(owner.constData()), length(owner.size()) {}
+
+        const quint16 *data() const { return ptr; }
+        const quint16 *constData() const { return ptr; }
+        qint32 size() const { return length; }
+        bool empty() const { return length == 0; }
+        bool isEmpty() const { return length == 0; }
+
+        const quint16 &operator[](qint32 index) const { return ptr[index]; }
+        const quint16 *begin() const { return ptr; }
+        const quint16 *end() const { return ptr + length; }
+
+        // Return a view of part of this view, sharing the same storage
+        DataView mid(qint32 position, qint32 count) const {
+            DataView result(*this);
+            result.ptr += position;
+            result.length = count;
+            return result;
+        }
+
+        // Return a copy of the samples that the caller can modify
+        Data toData() const {
+            Data result(length);
+            std::copy(begin(), end(), result.begin());
+            return result;
+        }
+
+    private:
+        Data owner;
+        const quint16 *ptr;
+        qint32 length;
+    };
+
     SourceVideo();
     ~SourceVideo();
 
@@ -52,14 +103,28 @@ public:
 
     // Field handling methods
     Data getVideoField(qint32 fieldNumber, qint32 startFieldLine = -1, qint32 endFieldLine = -1);
+    DataView getVideoFieldView(qint32 fieldNumber);
+    QVector<Data> getVideoFieldLines(qint32 firstFieldNumber, qint32 numberOfFields,
+                                     qint32 startFieldLine, qint32 endFieldLine);
+
+    // Read-ahead: when the input is accessed sequentially, keep up to this
+    // many upcoming fields loaded by a background thread (0 to disable)
+    void setReadAhead(qint32 fields);
+
+    // Limit the amount of field data cached, in bytes
+    void setCacheSize(qint64 bytes);
 
     // Get and set methods
     bool isSourceValid();
     qint32 getNumberOfAvailableFields();
     qint32 getFieldLength();
+    bool isMemoryMapped();
 
 private:
-    // File handling globals
+    class ReadAheadThread;
+
+    // File handling globals (guarded by fileMutex)
+    QMutex fileMutex;
     QFile inputFile;
     qint64 inputFilePos;
     bool isSourceVideoOpen;
@@ -68,10 +133,33 @@ private:
     qint32 fieldByteLength;
     qint32 fieldLineLength;
 
-    Data outputFieldData;
+    // Memory mapping of the whole input file (or nullptr if not mapped)
+    const uchar *mappedData;
 
     // Field caching
-    QCache<qint32, Data> fieldCache;
+    FieldCache fieldCache;
+
+    // Read-ahead state (guarded by readAheadMutex)
+    QMutex readAheadMutex;
+    qint32 readAheadFields;
+    qint32 readAheadWindow;
+    ReadAheadThread *readAheadThread;
+    QWaitCondition readAheadCondition;
+    QWaitCondition fieldReadyCondition;
+    qint32 lastRequestedField;
+    qint32 nextReadAheadField;
+    qint32 readAheadInProgress;
+    bool readAheadStop;
+
+    void startReadAhead();
+    void stopReadAhead();
+    void noteFieldRequest(qint32 fieldIndex);
+    void runReadAhead();
+    bool readFromFile(qint64 startPosition, qint64 readLength, Data &data);
+#ifdef Q_OS_UNIX
+    bool readFieldLinesVectored(qint32 firstFieldNumber, const QVector<qint32> &fieldIndexes,
+                                qint64 rangeOffset, qint64 rangeLength, QVector<Data> &fieldsData);
+#endif
 };
 
 #endif // SOURCEVIDEO_H
@@ -0,0 +1,145 @@
+/************************************************************************
+
+    testfieldcache.cpp
+
+    Unit tests for FieldCache
+    Copyright (C) 2026 agent
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include <cassert>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "fieldcache.h"
+
+// Make a field of the given size, filled with a value derived from fieldNumber
+static FieldCache::Data makeField(qint32 fieldNumber, qint32 samples)
+{
+    FieldCache::Data data(samples);
+    data.fill(static_cast<quint16>(fieldNumber));
+    return data;
+}
+
+void testBasic()
+{
+    printf("Testing basic operations\n");
+
+    FieldCache cache;
+    FieldCache::Data data;
+
+    // Empty cache
+    assert(!cache.lookup(1, data));
+    assert(!cache.contains(1));
+    assert(cache.getHits() == 0);
+    assert(cache.getMisses() == 1);
+
+    // Insert and find a field
+    cache.insert(1, makeField(1, 100));
+    assert(cache.contains(1));
+    assert(cache.lookup(1, data));
+    assert(data.size() == 100 && data[0] == 1);
+    assert(cache.getHits() == 1);
+    assert(cache.getMisses() == 1);
+
+    // Replace it
+    cache.insert(1, makeField(2, 50));
+    assert(cache.lookup(1, data));
+    assert(data.size() == 50 && data[0] == 2);
+
+    // Clear
+    cache.clear();
+    assert(!cache.contains(1));
+
+    cache.resetStatistics();
+    assert(cache.getHits() == 0);
+    assert(cache.getMisses() == 0);
+}
+
+void testByteLimit()
+{
+    printf("Testing byte limit\n");
+
+    // Room for 4 fields of 1000 samples in each shard
+    const qint32 fieldBytes = 1000 * sizeof(quint16);
+    FieldCache cache(8 * 4 * fieldBytes);
+    for (qint32 i = 0; i < 1000; i++) {
+        cache.insert(i, makeField(i, 1000));
+    }
+
+    // Only the most recent 32 fields should remain
+    qint32 present = 0;
+    for (qint32 i = 0; i < 1000; i++) {
+        if (cache.contains(i)) {
+            assert(i >= 1000 - 32);
+            present++;
+        }
+    }
+    assert(present == 32);
+
+    // Shrinking the limit evicts fields
+    cache.setMaxBytes(8 * fieldBytes);
+    present = 0;
+    for (qint32 i = 0; i < 1000; i++) {
+        if (cache.contains(i)) present++;
+    }
+    assert(present == 8);
+
+    // A field bigger than the limit isn't cached
+    cache.insert(5000, makeField(5000, 100000));
+    assert(!cache.contains(5000));
+}
+
+void testThreads()
+{
+    printf("Testing concurrent access\n");
+
+    FieldCache cache(1024 * 1024);
+    const qint32 numThreads = 4;
+    const qint32 numFields = 200;
+
+    std::vector<std::thread> threads;
+    for (qint32 t = 0; t < numThreads; t++) {
+        threads.emplace_back([&cache, t] {
+            FieldCache::Data data;
+            for (qint32 i = 0; i < numFields; i++) {
+                const qint32 fieldNumber = (i + t * 7) % numFields;
+                if (cache.lookup(fieldNumber, data)) {
+                    assert(data[0] == fieldNumber);
+                } else {
+                    cache.insert(fieldNumber, makeField(fieldNumber, 100));
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    assert(cache.getHits() + cache.getMisses() == numThreads * numFields);
+}
+
+int main()
+{
+    testBasic();
+    testByteLimit();
+    testThreads();
+
+    return 0;
+}
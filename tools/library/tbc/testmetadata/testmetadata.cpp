@@ -24,13 +24,18 @@
 
 #include <QCoreApplication>
 #include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
 #include <cmath>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 
 #include "jsonio.h"
 #include "lddecodemetadata.h"
+#include "metadataloader.h"
 
 // Run unit tests for the JSON parser
 void testJsonReader()
@@ -227,6 +232,449 @@ void testVideoSystem() {
     assert(!b);
 }
 
+// Run unit tests for DropOuts
+void testDropOuts()
+{
+    std::cerr << "Testing DropOuts\n";
+
+    const qint32 fieldWidth = 100;
+    const qint32 fieldHeight = 10;
+
+    // Make dropouts that overlap, touch, are out of order, and are partly
+    // outside the field
+    DropOuts dropOuts;
+    dropOuts.append(10, 20, 1);
+    dropOuts.append(15, 30, 1);
+    dropOuts.append(31, 35, 1);
+    dropOuts.append(50, 50, 1);
+    dropOuts.append(5, 8, 3);
+    dropOuts.append(90, 120, 3);
+    dropOuts.append(-5, 2, 5);
+    dropOuts.append(40, 45, 11);
+    dropOuts.append(60, 55, 7);
+    assert(!dropOuts.hasIndex());
+
+    // Work out the expected map by checking each dropout
+    QVector<quint8> expected(fieldWidth * fieldHeight, 0);
+    for (qint32 y = 0; y < fieldHeight; y++) {
+        for (qint32 x = 0; x < fieldWidth; x++) {
+            for (qint32 i = 0; i < dropOuts.size(); i++) {
+                if (dropOuts.fieldLine(i) == y + 1 && x >= dropOuts.startx(i) && x <= dropOuts.endx(i)) {
+                    expected[(y * fieldWidth) + x] = 1;
+                }
+            }
+        }
+    }
+
+    assert(dropOuts.rasterise(fieldWidth, fieldHeight) == expected);
+
+    // The first lookup should build the index
+    assert(!dropOuts.hasIndex());
+    for (qint32 y = 0; y < fieldHeight; y++) {
+        for (qint32 x = 0; x < fieldWidth; x++) {
+            assert(dropOuts.isDropout(x, y + 1) == (expected[(y * fieldWidth) + x] != 0));
+        }
+    }
+    assert(dropOuts.hasIndex());
+    assert(dropOuts.isDropout(100, 3));
+    assert(dropOuts.isDropout(40, 11));
+    assert(!dropOuts.isDropout(40, 12));
+
+    // Copies should keep the index, and changing them should discard it
+    DropOuts copiedDropOuts = dropOuts;
+    assert(copiedDropOuts.hasIndex());
+    copiedDropOuts.append(9, 9, 3);
+    assert(!copiedDropOuts.hasIndex());
+    assert(copiedDropOuts.isDropout(9, 3));
+    assert(dropOuts.hasIndex() && !dropOuts.isDropout(9, 3));
+
+    // Reading dropouts shouldn't build the index until it's needed
+    std::istringstream input("{\"endx\": [20, 8], \"fieldLine\": [1, 3], \"startx\": [10, 5]}");
+    JsonReader reader(input);
+    DropOuts readDropOuts;
+    readDropOuts.read(reader);
+    assert(!readDropOuts.hasIndex());
+    assert(readDropOuts.isDropout(10, 1) && readDropOuts.isDropout(8, 3) && !readDropOuts.isDropout(9, 3));
+    assert(readDropOuts.hasIndex());
+}
+
+// Make some metadata with numFields fields. If optionalData is set, the
+// fields have a mix of all the optional structures, as in ld-decode's
+// output; otherwise they just have their sequence numbers.
+static void makeMetaData(LdDecodeMetaData &metaData, VideoSystem system, qint32 numFields, bool optionalData)
+{
+    LdDecodeMetaData::VideoParameters videoParameters;
+    videoParameters.system = system;
+    if (system == NTSC) {
+        videoParameters.fieldWidth = 910;
+        videoParameters.fieldHeight = 263;
+        videoParameters.sampleRate = 14318181.0;
+    } else {
+        videoParameters.fieldWidth = 1135;
+        videoParameters.fieldHeight = 313;
+        videoParameters.sampleRate = 17734375.0;
+    }
+    videoParameters.numberOfSequentialFields = numFields;
+    videoParameters.gitBranch = "main";
+    metaData.setVideoParameters(videoParameters);
+
+    for (qint32 i = 0; i < numFields; i++) {
+        LdDecodeMetaData::Field field;
+        field.seqNo = i + 1;
+        field.isFirstField = (i % 2) == 0;
+
+        if (optionalData) {
+            field.syncConf = 100;
+            field.medianBurstIRE = 20.0 + (i % 100) / 37.0;
+            field.fieldPhaseID = (i % 8) + 1;
+            field.audioSamples = 882;
+            field.diskLoc = i * 1.000123;
+            field.fileLoc = static_cast<qint64>(i) * videoParameters.fieldWidth * videoParameters.fieldHeight;
+            field.decodeFaults = 0;
+            field.efmTValues = 1862;
+            if (i % 4 == 0) {
+                field.vitsMetrics.inUse = true;
+                field.vitsMetrics.wSNR = 40.0 + (i % 1000) / 123.0;
+                field.vitsMetrics.bPSNR = 38.0 + (i % 1000) / 321.0;
+            }
+            field.vbi.inUse = true;
+            field.vbi.vbiData = { 0x8BA000 + (i % 100), 0xF00000 + i / 2, 0xF00000 + i / 2 };
+            if (i % 7 == 0) {
+                field.ntsc.inUse = true;
+                field.ntsc.isVideoIdDataValid = true;
+                field.ntsc.videoIdData = i;
+            }
+            if (i % 11 == 0) {
+                field.vitc.inUse = true;
+                field.vitc.vitcData = { 1, 2, 3, 4, 5, 6, 7, i };
+            }
+            if (i % 13 == 0) {
+                field.closedCaption.inUse = true;
+                field.closedCaption.data0 = i;
+            }
+            for (qint32 j = 0; j < i % 3; j++) {
+                field.dropOuts.append(100 + j * 200, 150 + j * 200, 20 + (i % 280));
+            }
+        }
+
+        metaData.appendField(field);
+    }
+}
+
+// Write the fields of metaData to a JSON string
+static std::string fieldsToJson(LdDecodeMetaData &metaData)
+{
+    std::ostringstream output;
+    JsonWriter writer(output);
+    metaData.writeFields(writer);
+    return output.str();
+}
+
+// Run unit tests for binary metadata
+void testBinaryMetadata()
+{
+    std::cerr << "Testing binary metadata\n";
+
+    QTemporaryDir tempDir;
+    assert(tempDir.isValid());
+    const QString jsonFileName = tempDir.path() + "/test.tbc.json";
+    const QString binaryFileName = LdDecodeMetaData::getBinaryFileName(jsonFileName);
+    bool ok;
+
+    // Make some metadata, using all the optional structures
+    {
+        LdDecodeMetaData metaData;
+        makeMetaData(metaData, PAL, 100, true);
+        ok = metaData.write(jsonFileName);
+        assert(ok);
+    }
+    assert(!QFile::exists(binaryFileName));
+
+    // Reading the JSON should create binary metadata
+    LdDecodeMetaData jsonMetaData;
+    ok = jsonMetaData.read(jsonFileName);
+    assert(ok);
+    assert(QFile::exists(binaryFileName));
+
+    // Reading again should use the binary metadata, and give the same result
+    LdDecodeMetaData binaryMetaData;
+    ok = binaryMetaData.read(jsonFileName);
+    assert(ok);
+    assert(binaryMetaData.getNumberOfFields() == 100);
+    assert(binaryMetaData.getVideoParameters().gitBranch == "main");
+    assert(fieldsToJson(binaryMetaData) == fieldsToJson(jsonMetaData));
+
+    // Reading fields lazily should give the same result
+    LdDecodeMetaData lazyMetaData;
+    ok = lazyMetaData.read(jsonFileName, true);
+    assert(ok);
+    assert(lazyMetaData.getNumberOfFields() == 100);
+    assert(lazyMetaData.getField(45).dropOuts.size() == 2);
+    assert(fieldsToJson(lazyMetaData) == fieldsToJson(jsonMetaData));
+
+    // ... and changes to lazily-read fields should be kept
+    LdDecodeMetaData::Field field = lazyMetaData.getField(10);
+    field.syncConf = 42;
+    lazyMetaData.updateField(field, 10);
+    lazyMetaData.clearFieldDropOuts(45);
+    lazyMetaData.appendField(field);
+    assert(lazyMetaData.getNumberOfFields() == 101);
+    assert(lazyMetaData.getField(10).syncConf == 42);
+    assert(lazyMetaData.getField(45).dropOuts.empty());
+    assert(lazyMetaData.getField(101).syncConf == 42);
+
+    // Writing the JSON should remove the out-of-date binary metadata
+    ok = lazyMetaData.write(jsonFileName);
+    assert(ok);
+    assert(!QFile::exists(binaryFileName));
+
+    // Reading lazily without binary metadata should create it
+    ok = lazyMetaData.read(jsonFileName, true);
+    assert(ok);
+    assert(QFile::exists(binaryFileName));
+    assert(lazyMetaData.getNumberOfFields() == 101);
+    assert(lazyMetaData.getField(10).syncConf == 42);
+    assert(lazyMetaData.getField(45).dropOuts.empty());
+    ok = binaryMetaData.read(jsonFileName);
+    assert(ok);
+    assert(fieldsToJson(lazyMetaData) == fieldsToJson(binaryMetaData));
+    ok = binaryMetaData.write(jsonFileName);
+    assert(ok);
+
+    // Corrupt binary metadata should be ignored
+    ok = jsonMetaData.read(jsonFileName);
+    assert(ok);
+    {
+        QFile binaryFile(binaryFileName);
+        ok = binaryFile.open(QIODevice::ReadWrite) && binaryFile.resize(binaryFile.size() / 2);
+        assert(ok);
+    }
+    LdDecodeMetaData corruptMetaData;
+    ok = corruptMetaData.read(jsonFileName);
+    assert(ok);
+    assert(fieldsToJson(corruptMetaData) == fieldsToJson(jsonMetaData));
+}
+
+// Run unit tests for journalled updates
+void testJournal()
+{
+    std::cerr << "Testing journal\n";
+
+    QTemporaryDir tempDir;
+    assert(tempDir.isValid());
+    const QString jsonFileName = tempDir.path() + "/test.tbc.json";
+    const QString journalFileName = LdDecodeMetaData::getJournalFileName(jsonFileName);
+    bool ok;
+
+    // Make some metadata
+    {
+        LdDecodeMetaData metaData;
+        makeMetaData(metaData, NTSC, 20, false);
+        ok = metaData.write(jsonFileName);
+        assert(ok);
+    }
+
+    LdDecodeMetaData::Vbi vbi;
+    vbi.inUse = true;
+
+    // Start a run, and stop it part of the way through
+    {
+        LdDecodeMetaData metaData;
+        ok = metaData.read(jsonFileName);
+        assert(ok);
+        assert(!metaData.canResumeJournal(jsonFileName));
+        ok = metaData.openJournal(jsonFileName);
+        assert(ok);
+        assert(metaData.getFirstIncompleteJournalField() == 1);
+
+        for (qint32 fieldNumber : { 1, 2, 3, 5, 4, 6, 8 }) {
+            vbi.vbiData = { fieldNumber, 0, 0 };
+            metaData.updateFieldVbi(vbi, fieldNumber);
+            if (fieldNumber != 6) metaData.completeJournalField(fieldNumber);
+        }
+        metaData.clearFieldDropOuts(7);
+        metaData.completeJournalField(7);
+    }
+    assert(QFile::exists(journalFileName));
+
+    // Simulate a partly-written record at the end
+    {
+        QFile journalFile(journalFileName);
+        const qint32 partial = 3;
+        ok = journalFile.open(QIODevice::Append)
+             && journalFile.write(reinterpret_cast<const char *>(&partial), sizeof(partial)) == sizeof(partial);
+        assert(ok);
+    }
+
+    // Resume the run; the updates should be replayed
+    {
+        LdDecodeMetaData metaData;
+        ok = metaData.read(jsonFileName);
+        assert(ok);
+        assert(metaData.canResumeJournal(jsonFileName));
+        ok = metaData.openJournal(jsonFileName);
+        assert(ok);
+        assert(metaData.getFirstIncompleteJournalField() == 6);
+        assert(metaData.getFieldVbi(5).vbiData[0] == 5);
+        assert(metaData.getFieldVbi(6).vbiData[0] == 6);
+        assert(metaData.getFieldVbi(8).vbiData[0] == 8);
+        assert(!metaData.getFieldVbi(9).inUse);
+
+        for (qint32 fieldNumber = 6; fieldNumber <= 20; fieldNumber++) {
+            vbi.vbiData = { fieldNumber, 0, 0 };
+            metaData.updateFieldVbi(vbi, fieldNumber);
+            metaData.completeJournalField(fieldNumber);
+        }
+
+        // Writing the output and closing the journal should remove it
+        ok = metaData.write(jsonFileName);
+        assert(ok);
+        metaData.closeJournal();
+    }
+    assert(!QFile::exists(journalFileName));
+
+    // All the updates should be in the output
+    LdDecodeMetaData metaData;
+    ok = metaData.read(jsonFileName);
+    assert(ok);
+    for (qint32 fieldNumber = 1; fieldNumber <= 20; fieldNumber++) {
+        assert(metaData.getFieldVbi(fieldNumber).vbiData[0] == fieldNumber);
+    }
+
+    // A journal for different input metadata should be ignored
+    ok = metaData.openJournal(jsonFileName);
+    assert(ok);
+    metaData.updateFieldVbi(vbi, 1);
+    metaData.completeJournalField(1);
+    metaData.appendField(LdDecodeMetaData::Field());
+    ok = metaData.write(jsonFileName);
+    assert(ok);
+    {
+        LdDecodeMetaData changedMetaData;
+        ok = changedMetaData.read(jsonFileName);
+        assert(ok);
+        assert(!changedMetaData.canResumeJournal(jsonFileName));
+        ok = changedMetaData.openJournal(jsonFileName);
+        assert(ok);
+        assert(changedMetaData.getFirstIncompleteJournalField() == 1);
+        assert(changedMetaData.getNumberOfFields() == 21);
+        assert(changedMetaData.getFieldVbi(1).vbiData[0] == 20);
+    }
+}
+
+// Test reading several files in parallel
+void testMetaDataLoader()
+{
+    std::cerr << "Testing MetaDataLoader\n";
+
+    QTemporaryDir tempDir;
+    assert(tempDir.isValid());
+    bool ok;
+
+    // Make some files with different numbers of fields
+    constexpr qint32 numFiles = 6;
+    for (qint32 i = 0; i < numFiles; i++) {
+        LdDecodeMetaData metaData;
+        makeMetaData(metaData, PAL, 10 + i, false);
+        ok = metaData.write(tempDir.path() + "/" + QString::number(i) + ".json");
+        assert(ok);
+    }
+
+    // Read them back, plus one that doesn't exist
+    LdDecodeMetaData metaData[numFiles + 1];
+    MetaDataLoader loader(3);
+    for (qint32 i = 0; i <= numFiles; i++) {
+        const qint32 index = loader.add(metaData[i], tempDir.path() + "/" + QString::number(i) + ".json");
+        assert(index == i);
+    }
+    ok = loader.load();
+    assert(!ok);
+
+    for (qint32 i = 0; i < numFiles; i++) {
+        assert(loader.isLoaded(i));
+        assert(loader.getLoadTime(i) >= 0);
+        assert(metaData[i].getNumberOfFields() == 10 + i);
+    }
+    assert(!loader.isLoaded(numFiles));
+}
+
+// Parse the fields from a metadata JSON file, as LdDecodeMetaData::read does
+static void parseFields(JsonReader &reader, LdDecodeMetaData &metaData)
+{
+    reader.beginObject();
+
+    std::string member;
+    while (reader.readMember(member)) {
+        if (member == "fields") metaData.readFields(reader);
+        else reader.discard();
+    }
+
+    reader.endObject();
+}
+
+// Show how long a parse took, and the throughput
+static void showSpeed(const char *name, qint64 bytes, qint64 nsecs)
+{
+    const double seconds = nsecs / 1e9;
+    std::cout << name << ": " << seconds << " s, " << (bytes / (1024.0 * 1024.0)) / seconds << " MB/s\n";
+}
+
+// Measure the JSON parser's speed on a synthetic metadata file
+void benchmarkJsonReader(qint32 numFields)
+{
+    std::cout << "Generating metadata with " << numFields << " fields\n";
+
+    QTemporaryDir tempDir;
+    assert(tempDir.isValid());
+    const QString jsonFileName = tempDir.path() + "/benchmark.tbc.json";
+
+    // Make metadata that looks like ld-decode's output
+    {
+        LdDecodeMetaData metaData;
+        makeMetaData(metaData, PAL, numFields, true);
+        const bool ok = metaData.write(jsonFileName);
+        assert(ok);
+    }
+
+    QFile jsonFile(jsonFileName);
+    const bool opened = jsonFile.open(QIODevice::ReadOnly);
+    assert(opened);
+    const qint64 jsonSize = jsonFile.size();
+    std::cout << "JSON size: " << jsonSize / (1024.0 * 1024.0) << " MB\n";
+
+    // Scan the whole file from memory, without storing anything
+    const char *jsonData = reinterpret_cast<const char *>(jsonFile.map(0, jsonSize));
+    assert(jsonData != nullptr);
+    QElapsedTimer timer;
+    {
+        timer.start();
+        JsonReader reader(jsonData, jsonSize);
+        reader.discard();
+        showSpeed("Discard from memory", jsonSize, timer.nsecsElapsed());
+    }
+
+    // Parse the fields from memory
+    {
+        LdDecodeMetaData metaData;
+        timer.start();
+        JsonReader reader(jsonData, jsonSize);
+        parseFields(reader, metaData);
+        showSpeed("Parse from memory", jsonSize, timer.nsecsElapsed());
+        assert(metaData.getNumberOfFields() == numFields);
+    }
+
+    // Parse the fields from a stream
+    {
+        LdDecodeMetaData metaData;
+        timer.start();
+        std::ifstream jsonStream(jsonFileName.toStdString());
+        JsonReader reader(jsonStream);
+        parseFields(reader, metaData);
+        showSpeed("Parse from stream", jsonSize, timer.nsecsElapsed());
+        assert(metaData.getNumberOfFields() == numFields);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     // Initialise Qt
@@ -247,6 +695,9 @@ int main(int argc, char *argv[])
     QCommandLineOption exitOption(QStringList() << "x" << "exit",
                                   "call exit(0) after parsing, to analyse memory usage");
     parser.addOption(exitOption);
+    QCommandLineOption benchmarkOption(QStringList() << "b" << "benchmark",
+                                       "measure JSON parsing speed on a synthetic file with 1M fields");
+    parser.addOption(benchmarkOption);
 
     // Positional argument to specify input video file
     parser.addPositionalArgument("input", "Input JSON file (omit to run unit tests)");
@@ -259,10 +710,18 @@ int main(int argc, char *argv[])
 
     // Process the positional args
     QStringList positionalArguments = parser.positionalArguments();
+    if (parser.isSet(benchmarkOption)) {
+        benchmarkJsonReader(1000000);
+        return 0;
+    }
     if (positionalArguments.count() == 0) {
         // Run unit tests
         testJsonReader();
         testVideoSystem();
+        testDropOuts();
+        testBinaryMetadata();
+        testJournal();
+        testMetaDataLoader();
         return 0;
     }
     if (positionalArguments.count() > 2) {